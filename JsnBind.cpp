@@ -0,0 +1,308 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnBind.h"
+#include "JsnUTF8.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <limits>
+
+/****************************************************************************************************************/
+
+JsnFieldIndex::JsnFieldIndex( const uint32_t* hashes, int count )
+: m_Slots( NULL )
+, m_Multiplier( 1 )
+, m_Shift( 31 )
+{
+  // Start at twice as many slots as names, and double until a multiplier is found that gives every hash its
+  // own slot. Names with the same hash as an earlier one are left out; only the first can be found.
+  int bits = 1;
+  while( ( 1 << bits ) < count * 2 )
+  {
+    bits += 1;
+  }
+  for( ;; ++bits )
+  {
+    int slot_count = 1 << bits;
+    delete[] m_Slots;
+    m_Slots = new int16_t[ slot_count ];
+    m_Shift = 32 - bits;
+    uint32_t multiplier = 0x9E3779B1;
+    for( int attempt = 0; attempt < 256; ++attempt, multiplier += 0x6A09E668 )
+    {
+      memset( m_Slots, 0xFF, slot_count * sizeof( int16_t ) );
+      bool perfect = true;
+      for( int i = 0; i < count && perfect; ++i )
+      {
+        uint32_t slot = ( hashes[ i ] * multiplier ) >> m_Shift;
+        if( m_Slots[ slot ] < 0 )
+        {
+          m_Slots[ slot ] = ( int16_t )i;
+        }
+        else
+        {
+          perfect = hashes[ m_Slots[ slot ] ] == hashes[ i ];
+        }
+      }
+      if( perfect )
+      {
+        m_Multiplier = multiplier;
+        return;
+      }
+    }
+  }
+}
+
+JsnFieldIndex::~JsnFieldIndex()
+{
+  delete[] m_Slots;
+}
+
+/****************************************************************************************************************/
+
+bool JsnReadMismatch( JsnReader* reader, const JsnFragment& value )
+{
+  switch( value.m_Type )
+  {
+    case kJsn_Null:
+      return true;
+    case kJsn_Undefined:
+      return false;
+    default:
+      reader->SetError( "Unexpected type" );
+      return false;
+  }
+}
+
+// Decode text that is nothing but decimal digits. Returns false if it is anything else, or if the value does not
+// fit in uint64_t.
+static bool DecodeDigits( const char* text, int64_t length, uint64_t* value )
+{
+  uint64_t u = 0;
+  for( int64_t i = 0; i < length; ++i )
+  {
+    if( text[ i ] < '0' || text[ i ] > '9' )
+    {
+      return false;
+    }
+    uint64_t digit = ( uint64_t )( text[ i ] - '0' );
+    if( u > ( UINT64_MAX - digit ) / 10 )
+    {
+      return false;
+    }
+    u = u * 10 + digit;
+  }
+  *value = u;
+  return length > 0;
+}
+
+// Value of a number as int64_t, with floats truncated toward zero. Returns false if it does not fit. The
+// parser decodes integers below INT64_MIN to the nearest double, which may be INT64_MIN itself, so those are
+// decoded again from the text.
+static bool GetSigned( const JsnFragment& number, int64_t* value )
+{
+  if( number.m_Type == kJsn_Float )
+  {
+    double f = number.AsFloat();
+    uint64_t u;
+    if( f <= -9223372036854775808.0 && number.m_Text && number.m_Length > 1 && number.m_Text[ 0 ] == '-' &&
+        DecodeDigits( number.m_Text + 1, number.m_Length - 1, &u ) )
+    {
+      if( u > 9223372036854775808ULL )
+      {
+        return false;
+      }
+      *value = ( int64_t )( 0 - u );
+      return true;
+    }
+    if( !( f >= -9223372036854775808.0 && f < 9223372036854775808.0 ) )
+    {
+      return false;
+    }
+  }
+  *value = number.AsInt();
+  return true;
+}
+
+// Value of a number as uint64_t, with floats truncated toward zero. Returns false if it does not fit. The
+// parser decodes integers above INT64_MAX to the nearest double, so those are decoded again from the text.
+static bool GetUnsigned( const JsnFragment& number, uint64_t* value )
+{
+  if( number.m_Type == kJsn_Int )
+  {
+    int64_t i = number.AsInt();
+    *value = ( uint64_t )i;
+    return i >= 0;
+  }
+  double f = number.AsFloat();
+  if( f >= 9223372036854775808.0 && number.m_Text && DecodeDigits( number.m_Text, number.m_Length, value ) )
+  {
+    return true;
+  }
+  if( !( f > -1.0 && f < 18446744073709551616.0 ) )
+  {
+    return false;
+  }
+  *value = ( uint64_t )f;
+  return true;
+}
+
+template< typename I >
+static bool ReadInt( JsnReader* reader, I* value )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type != kJsn_Int && fragment.m_Type != kJsn_Float )
+  {
+    return JsnReadMismatch( reader, fragment );
+  }
+  if( std::numeric_limits< I >::is_signed )
+  {
+    int64_t i;
+    if( !GetSigned( fragment, &i ) ||
+        i < ( int64_t )std::numeric_limits< I >::min() || i > ( int64_t )std::numeric_limits< I >::max() )
+    {
+      reader->SetError( "Number out of range" );
+      return false;
+    }
+    *value = ( I )i;
+  }
+  else
+  {
+    uint64_t u;
+    if( !GetUnsigned( fragment, &u ) || u > ( uint64_t )std::numeric_limits< I >::max() )
+    {
+      reader->SetError( "Number out of range" );
+      return false;
+    }
+    *value = ( I )u;
+  }
+  return true;
+}
+
+template< typename F >
+static bool ReadFloat( JsnReader* reader, F* value )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type != kJsn_Int && fragment.m_Type != kJsn_Float )
+  {
+    return JsnReadMismatch( reader, fragment );
+  }
+  *value = ( F )fragment.AsFloat();
+  return true;
+}
+
+bool JsnReadValue( JsnReader* reader, bool* value )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type != kJsn_True && fragment.m_Type != kJsn_False )
+  {
+    return JsnReadMismatch( reader, fragment );
+  }
+  *value = fragment.m_Type == kJsn_True;
+  return true;
+}
+
+bool JsnReadValue( JsnReader* reader, signed char* value )         { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, unsigned char* value )       { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, short* value )               { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, unsigned short* value )      { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, int* value )                 { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, unsigned int* value )        { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, long* value )                { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, unsigned long* value )       { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, long long* value )           { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, unsigned long long* value )  { return ReadInt( reader, value ); }
+bool JsnReadValue( JsnReader* reader, float* value )               { return ReadFloat( reader, value ); }
+bool JsnReadValue( JsnReader* reader, double* value )              { return ReadFloat( reader, value ); }
+
+bool JsnReadValue( JsnReader* reader, JsnFragment* value )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type == kJsn_Undefined )
+  {
+    return false;
+  }
+  *value = fragment;
+  return true;
+}
+
+bool JsnReadString( JsnReader* reader, char* buffer, int64_t size )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type != kJsn_String )
+  {
+    return JsnReadMismatch( reader, fragment );
+  }
+  if( size <= 0 )
+  {
+    return true;
+  }
+
+  int64_t length = fragment.m_Length;
+  if( !( fragment.m_Flags & kJsnFlag_Escaped ) || ( fragment.m_Flags & kJsnFlag_Unescaped ) )
+  {
+    length = length < size - 1 ? length : size - 1;
+    memcpy( buffer, fragment.m_Text, ( size_t )length );
+  }
+  else if( length < size )
+  {
+    // Decoding never makes the text longer, so decode in the buffer
+    memcpy( buffer, fragment.m_Text, ( size_t )length );
+    length = JsnUnescapeInPlace( buffer, length );
+  }
+  else
+  {
+    char* decoded = new char[ length ];
+    memcpy( decoded, fragment.m_Text, ( size_t )length );
+    length = JsnUnescapeInPlace( decoded, length );
+    length = length < size - 1 ? length : size - 1;
+    memcpy( buffer, decoded, ( size_t )length );
+    delete[] decoded;
+  }
+
+  // If the text was cut short in the middle of a UTF-8 character, drop the part that fits
+  if( length == size - 1 && length < fragment.m_Length )
+  {
+    int64_t start = length;
+    while( start > 0 && ( buffer[ start - 1 ] & 0xC0 ) == 0x80 )
+    {
+      start -= 1;
+    }
+    if( start > 0 )
+    {
+      uint8_t lead = ( uint8_t )buffer[ start - 1 ];
+      int64_t width = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+      if( start - 1 + width > length )
+      {
+        length = start - 1;
+      }
+    }
+  }
+  buffer[ length ] = 0;
+  return true;
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,349 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+
+ Read JSON objects straight into C++ structs. Declare the fields of a struct once, at global scope:
+ \code
+ struct Point
+ {
+   float x;
+   float y;
+ };
+ JSN_BIND( Point,
+   JSN_FIELD( x ),
+   JSN_FIELD( y ) )
+
+ struct Shape
+ {
+   char  name[ 32 ];
+   int   sides;
+   Point corners[ 8 ];
+   bool  closed;
+ };
+ JSN_BIND( Shape,
+   JSN_FIELD( name ),
+   JSN_FIELD_NAMED( sides, "side-count" ),
+   JSN_FIELD( corners ),
+   JSN_FIELD( closed ) )
+ \endcode
+ and read:
+ \code
+ Shape shape;
+ JsnParseOptions options;
+ options.m_HashKeys = true;
+ if( !JsnRead( &shape, &stream, options ) )
+ {
+   printf( "ERROR: %s\n", stream.GetError() );
+ }
+ \endcode
+
+ The field table is a constexpr array of names and read functions. Each read function is instantiated for
+ one member pointer, so the member is written directly, with no virtual call and no offset arithmetic. On
+ first use, the names are put in a perfect hash: a multiplier is searched for that maps the JsnHashKey() of
+ every name to its own slot. A property name then costs one multiply, one table load and one compare of the
+ name that was found. With JsnParseOptions::m_HashKeys set, the hash comes with the name from the parser.
+
+ Properties that are not in the table are skipped with JsnReader::SkipValue(): they are not decoded, and
+ nothing is built for them. Properties that are missing from the text leave their member unchanged, as does
+ null. A value of the wrong type is an error. So is a number that does not fit its integer member: a negative
+ number for an unsigned member, or 300 for a uint8_t, is not wrapped or clamped. Integers are read exactly over
+ the whole range of the member, up to UINT64_MAX for unsigned long long. A number with a fraction or exponent
+ is truncated toward zero.
+
+ Members can be bool, any integer type but char, float, double, char arrays (decoded, zero terminated, and
+ cut short to fit), JsnFragment (the value as returned by JsnReader::Next()), other bound structs, and fixed
+ size arrays of any of these. An array takes as many elements as it has room for, and skips the rest. To
+ support another type, declare a JsnReadValue() overload for it in its own namespace.
+ */
+#pragma once
+
+#include "JsnParse.h"
+#include "JsnReader.h"
+#include "JsnStream.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/****************************************************************************************************************/
+
+/**
+ One field of a bound struct: JSON name, and a function that reads a value into the member.
+ */
+template< class T >
+struct JsnField
+{
+  const char* m_Name;
+  int64_t     m_Length;
+  bool        ( *m_Read )( JsnReader* reader, T* object );
+
+  constexpr JsnField( const char* name, int64_t length, bool ( *read )( JsnReader* reader, T* object ) )
+  : m_Name( name )
+  , m_Length( length )
+  , m_Read( read )
+  {}
+};
+
+/**
+ Field table of a struct. Only the specializations made by JSN_BIND() are defined.
+ */
+template< class T >
+struct JsnBinding;
+
+/**
+ Bind a struct to its field table. Use at global scope, after the struct.
+ \param T Struct type.
+ \param ... JSN_FIELD() and JSN_FIELD_NAMED() entries, separated by commas.
+ */
+#define JSN_BIND( T, ... )                                                                                      \
+  template<>                                                                                                    \
+  struct JsnBinding< T >                                                                                        \
+  {                                                                                                             \
+    typedef T Type;                                                                                             \
+    static const JsnFieldTable< T >& GetTable()                                                                 \
+    {                                                                                                           \
+      static constexpr JsnField< T > fields[] = { __VA_ARGS__ };                                                \
+      static const JsnFieldTable< T > table( fields, ( int )( sizeof( fields ) / sizeof( fields[ 0 ] ) ) );     \
+      return table;                                                                                             \
+    }                                                                                                           \
+  };
+
+/**
+ Field with the same name in JSON as in C++.
+ */
+#define JSN_FIELD( member ) JSN_FIELD_NAMED( member, #member )
+
+/**
+ Field with a different name in JSON.
+ \param member Member name.
+ \param name JSON name, as a string literal, decoded.
+ */
+#define JSN_FIELD_NAMED( member, name )                                                                         \
+  JsnField< Type >( name, sizeof( name ) - 1, &JsnMember< Type, decltype( Type::member ), &Type::member >::Read )
+
+/****************************************************************************************************************/
+
+/**
+ Perfect hash from name hashes to small integers. Built once, and then read only.
+ */
+class JsnFieldIndex
+{
+public:
+
+  /**
+   Build the hash.
+   \param[ in ] hashes JsnHashKey() of each name.
+   \param[ in ] count Number of names.
+   */
+  JsnFieldIndex( const uint32_t* hashes, int count );
+  ~JsnFieldIndex();
+
+  /**
+   Look up a hash.
+   \param[ in ] hash JsnHashKey() of a name.
+   \return Index of the only name that can have this hash, or -1 if none. The caller must still compare the
+   name. If several names have the same hash, only the first is found.
+   */
+  int Find( uint32_t hash ) const { return m_Slots[ ( hash * m_Multiplier ) >> m_Shift ]; }
+
+private:
+
+  int16_t*        m_Slots;
+  uint32_t        m_Multiplier;
+  int             m_Shift;
+
+  JsnFieldIndex( const JsnFieldIndex& other );
+  JsnFieldIndex& operator=( const JsnFieldIndex& other );
+};
+
+/**
+ The fields of a struct, with their perfect hash.
+ */
+template< class T >
+class JsnFieldTable
+{
+public:
+
+  JsnFieldTable( const JsnField< T >* fields, int count )
+  : m_Fields( fields )
+  , m_Index( Hashes( fields, count ).m_Hashes, count )
+  {}
+
+  /**
+   Find the field for a property name.
+   \param[ in ] name Property name, as returned by JsnReader::GetName().
+   \return Field, or NULL if the struct does not have it.
+   */
+  const JsnField< T >* Find( const JsnFragment& name ) const
+  {
+    int index = m_Index.Find( name.GetKeyHash() );
+    if( index < 0 || !name.IsKey( m_Fields[ index ].m_Name, m_Fields[ index ].m_Length ) )
+    {
+      return NULL;
+    }
+    return &m_Fields[ index ];
+  }
+
+private:
+
+  struct Hashes
+  {
+    uint32_t*     m_Hashes;
+
+    Hashes( const JsnField< T >* fields, int count )
+    : m_Hashes( new uint32_t[ count ] )
+    {
+      for( int i = 0; i < count; ++i )
+      {
+        m_Hashes[ i ] = JsnHashKey( fields[ i ].m_Name, fields[ i ].m_Length );
+      }
+    }
+    ~Hashes() { delete[] m_Hashes; }
+  };
+
+  const JsnField< T >* m_Fields;
+  JsnFieldIndex   m_Index;
+};
+
+/****************************************************************************************************************/
+
+/**
+ \name Read a value
+ Read the next value from a JsnReader into a variable. Null leaves the variable unchanged, and returns true.
+ \param[ in ] reader Reader, positioned before the value.
+ \param[ out ] value Variable to read into.
+ \return true if a value was read, false at the end of the current object or array, and on error.
+ */
+///@{
+bool JsnReadValue( JsnReader* reader, bool* value );
+bool JsnReadValue( JsnReader* reader, signed char* value );
+bool JsnReadValue( JsnReader* reader, unsigned char* value );
+bool JsnReadValue( JsnReader* reader, short* value );
+bool JsnReadValue( JsnReader* reader, unsigned short* value );
+bool JsnReadValue( JsnReader* reader, int* value );
+bool JsnReadValue( JsnReader* reader, unsigned int* value );
+bool JsnReadValue( JsnReader* reader, long* value );
+bool JsnReadValue( JsnReader* reader, unsigned long* value );
+bool JsnReadValue( JsnReader* reader, long long* value );
+bool JsnReadValue( JsnReader* reader, unsigned long long* value );
+bool JsnReadValue( JsnReader* reader, float* value );
+bool JsnReadValue( JsnReader* reader, double* value );
+bool JsnReadValue( JsnReader* reader, JsnFragment* value );
+
+/**
+ Read a string into a buffer. The text is decoded and zero terminated. If it does not fit, it is cut short
+ at the last whole UTF-8 character that does.
+ \param[ in ] size Size of buffer, including the zero terminator.
+ */
+bool JsnReadString( JsnReader* reader, char* buffer, int64_t size );
+
+template< size_t N >
+bool JsnReadValue( JsnReader* reader, char ( *value )[ N ] ) { return JsnReadString( reader, *value, N ); }
+
+template< class E, size_t N >
+bool JsnReadValue( JsnReader* reader, E ( *value )[ N ] );
+
+template< class T >
+bool JsnReadValue( JsnReader* reader, T* object );
+///@}
+
+/**
+ Handle a value that does not fit the variable it is read into.
+ \param[ in ] reader Reader.
+ \param[ in ] value Value, as returned by JsnReader::Next().
+ \return true for null, false for the end of an object or array. Otherwise sets an error and returns false.
+ */
+bool JsnReadMismatch( JsnReader* reader, const JsnFragment& value );
+
+/**
+ Read function for one member of a bound struct. Used by JSN_FIELD().
+ */
+template< class T, class M, M T::*P >
+struct JsnMember
+{
+  static bool Read( JsnReader* reader, T* object ) { return JsnReadValue( reader, &( object->*P ) ); }
+};
+
+/**
+ Read a fixed size array. Extra elements in the text are skipped. Elements missing from the text leave the
+ end of the array unchanged.
+ */
+template< class E, size_t N >
+bool JsnReadValue( JsnReader* reader, E ( *value )[ N ] )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type != kJsn_Array )
+  {
+    return JsnReadMismatch( reader, fragment );
+  }
+  reader->EnterArray();
+  for( size_t i = 0; i < N && JsnReadValue( reader, &( *value )[ i ] ); ++i )
+  {}
+  reader->Leave();
+  return !reader->GetError();
+}
+
+/**
+ Read an object into a struct that has a JSN_BIND() field table.
+ */
+template< class T >
+bool JsnReadValue( JsnReader* reader, T* object )
+{
+  JsnFragment fragment = reader->Next();
+  if( fragment.m_Type != kJsn_Object )
+  {
+    return JsnReadMismatch( reader, fragment );
+  }
+  reader->EnterObject();
+  const JsnFieldTable< T >& table = JsnBinding< T >::GetTable();
+  while( reader->NextKey() )
+  {
+    const JsnField< T >* field = table.Find( reader->GetName() );
+    if( field )
+    {
+      field->m_Read( reader, object );
+    }
+    else
+    {
+      reader->SkipValue();
+    }
+  }
+  reader->Leave();
+  return !reader->GetError();
+}
+
+/************************************************************************************************************/ /**
+ Read a JSON text into a struct that has a JSN_BIND() field table.
+ \param[ out ] object Struct to read into. Members that are not in the text keep their values.
+ \param[ in ] stream Stream to read from.
+ \param[ in ] options Parse options. Set JsnParseOptions::m_HashKeys to have the parser hash the names.
+ \return true if successful. On error, the stream has the error string, and the struct may be partly read.
+ */
+template< class T >
+bool JsnRead( T* object, JsnStreamIn* stream, const JsnParseOptions& options = JsnParseOptions() )
+{
+  JsnReader reader( stream, options );
+  JsnReadValue( &reader, object );
+  return !reader.GetError();
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,325 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+
+ Internal helpers to classify JSON text 64 bytes at a time. Not part of the public interface.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#define JSN_AVX2 1
+#define JSN_SSE2 1
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define JSN_SSE2 1
+#endif
+
+#if defined( __PCLMUL__ )
+#include <wmmintrin.h>
+#endif
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+/************************************************************************************************************/ /**
+ \struct JsnBlock
+ Bit masks for one 64 byte block of text. Bit N of each mask corresponds to byte N of the block.
+ */
+struct JsnBlock
+{
+  uint64_t m_Quote;       /**< '"' */
+  uint64_t m_Backslash;   /**< '\\' */
+  uint64_t m_Structural;  /**< '{', '}', '[', ']', ':' and ',' */
+  uint64_t m_Whitespace;  /**< Anything at or below ' ', like JsnEatSpace */
+};
+
+static inline int JsnCountTrailingZeros( uint64_t x )
+{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+  unsigned long i;
+  _BitScanForward64( &i, x );
+  return ( int )i;
+#elif defined( _MSC_VER )
+  // No 64-bit bit scan outside x64. Scan the low half, then the high half.
+  unsigned long i;
+  if( _BitScanForward( &i, ( unsigned long )x ) )
+  {
+    return ( int )i;
+  }
+  _BitScanForward( &i, ( unsigned long )( x >> 32 ) );
+  return ( int )i + 32;
+#else
+  return __builtin_ctzll( x );
+#endif
+}
+
+static inline int JsnPopCount( uint64_t x )
+{
+#if defined( _MSC_VER ) && defined( _M_X64 )
+  return ( int )__popcnt64( x );
+#elif defined( _MSC_VER )
+  // __popcnt64 is x64 only
+  x = x - ( ( x >> 1 ) & 0x5555555555555555ULL );
+  x = ( x & 0x3333333333333333ULL ) + ( ( x >> 2 ) & 0x3333333333333333ULL );
+  x = ( x + ( x >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+  return ( int )( ( x * 0x0101010101010101ULL ) >> 56 );
+#else
+  return __builtin_popcountll( x );
+#endif
+}
+
+/**
+ Bit N of the result is the exclusive or of bits 0..N of the input.
+ */
+static inline uint64_t JsnPrefixXor( uint64_t x )
+{
+#if defined( __PCLMUL__ )
+  __m128i all_ones = _mm_set1_epi8( ( char )0xFF );
+  return ( uint64_t )_mm_cvtsi128_si64( _mm_clmulepi64_si128( _mm_set_epi64x( 0, ( int64_t )x ), all_ones, 0 ) );
+#else
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+#endif
+}
+
+#if defined( JSN_AVX2 )
+
+static inline void JsnClassify32( const uint8_t* p, int shift, JsnBlock* block )
+{
+  __m256i v     = _mm256_loadu_si256( ( const __m256i* )p );
+  __m256i lower = _mm256_or_si256( v, _mm256_set1_epi8( 0x20 ) ); // '[' -> '{', ']' -> '}'
+  __m256i s     = _mm256_or_si256(
+                  _mm256_or_si256( _mm256_cmpeq_epi8( lower, _mm256_set1_epi8( '{' ) ),
+                                   _mm256_cmpeq_epi8( lower, _mm256_set1_epi8( '}' ) ) ),
+                  _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ':' ) ),
+                                   _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ',' ) ) ) );
+  __m256i w     = _mm256_cmpeq_epi8( _mm256_min_epu8( v, _mm256_set1_epi8( ' ' ) ), v );
+  block->m_Quote      |= ( uint64_t )( uint32_t )_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '"' ) ) ) << shift;
+  block->m_Backslash  |= ( uint64_t )( uint32_t )_mm256_movemask_epi8( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\\' ) ) ) << shift;
+  block->m_Structural |= ( uint64_t )( uint32_t )_mm256_movemask_epi8( s ) << shift;
+  block->m_Whitespace |= ( uint64_t )( uint32_t )_mm256_movemask_epi8( w ) << shift;
+}
+
+#elif defined( JSN_SSE2 )
+
+static inline void JsnClassify16( const uint8_t* p, int shift, JsnBlock* block )
+{
+  __m128i v     = _mm_loadu_si128( ( const __m128i* )p );
+  __m128i lower = _mm_or_si128( v, _mm_set1_epi8( 0x20 ) ); // '[' -> '{', ']' -> '}'
+  __m128i s     = _mm_or_si128(
+                  _mm_or_si128( _mm_cmpeq_epi8( lower, _mm_set1_epi8( '{' ) ),
+                                _mm_cmpeq_epi8( lower, _mm_set1_epi8( '}' ) ) ),
+                  _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( ':' ) ),
+                                _mm_cmpeq_epi8( v, _mm_set1_epi8( ',' ) ) ) );
+  __m128i w     = _mm_cmpeq_epi8( _mm_min_epu8( v, _mm_set1_epi8( ' ' ) ), v );
+  block->m_Quote      |= ( uint64_t )_mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_set1_epi8( '"' ) ) ) << shift;
+  block->m_Backslash  |= ( uint64_t )_mm_movemask_epi8( _mm_cmpeq_epi8( v, _mm_set1_epi8( '\\' ) ) ) << shift;
+  block->m_Structural |= ( uint64_t )_mm_movemask_epi8( s ) << shift;
+  block->m_Whitespace |= ( uint64_t )_mm_movemask_epi8( w ) << shift;
+}
+
+#endif
+
+/**
+ Classify 64 bytes of text. The caller must make sure all 64 bytes are readable.
+ */
+static inline void JsnClassifyBlock( const uint8_t* p, JsnBlock* block )
+{
+  block->m_Quote      = 0;
+  block->m_Backslash  = 0;
+  block->m_Structural = 0;
+  block->m_Whitespace = 0;
+#if defined( JSN_AVX2 )
+  JsnClassify32( p,      0, block );
+  JsnClassify32( p + 32, 32, block );
+#elif defined( JSN_SSE2 )
+  JsnClassify16( p,      0, block );
+  JsnClassify16( p + 16, 16, block );
+  JsnClassify16( p + 32, 32, block );
+  JsnClassify16( p + 48, 48, block );
+#else
+  for( int i = 0; i < 64; ++i )
+  {
+    uint64_t bit = ( uint64_t )1 << i;
+    switch( p[ i ] )
+    {
+      case '"':  block->m_Quote      |= bit; break;
+      case '\\': block->m_Backslash  |= bit; break;
+      case '{':
+      case '}':
+      case '[':
+      case ']':
+      case ':':
+      case ',':  block->m_Structural |= bit; break;
+      default:
+        if( p[ i ] <= ' ' )
+        {
+          block->m_Whitespace |= bit;
+        }
+        break;
+    }
+  }
+#endif
+}
+
+/**
+ Classify the last, partial block of a text. Missing bytes are treated as whitespace.
+ */
+static inline void JsnClassifyPartialBlock( const uint8_t* p, int length, JsnBlock* block )
+{
+  uint8_t buf[ 64 ];
+  memset( buf, ' ', sizeof( buf ) );
+  memcpy( buf, p, length );
+  JsnClassifyBlock( buf, block );
+}
+
+/************************************************************************************************************/ /**
+ Find the first byte that cannot be copied into a JSON string as is: '"', '\\', or anything below ' '. If
+ escape_utf8 is set, also anything at or above 0x80.
+ \param[ in ] p Start of text.
+ \param[ in ] end End of text.
+ \param[ in ] escape_utf8 Flag to stop at non-ASCII bytes.
+ \return Pointer to the first such byte, or end if there is none.
+ */
+static inline const char* JsnFindEscape( const char* p, const char* end, bool escape_utf8 )
+{
+#if defined( JSN_AVX2 )
+  const __m256i high = escape_utf8 ? _mm256_set1_epi8( ( char )0x80 ) : _mm256_setzero_si256();
+  while( end - p >= 32 )
+  {
+    __m256i v = _mm256_loadu_si256( ( const __m256i* )p );
+    __m256i e = _mm256_or_si256(
+                _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '"' ) ),
+                                 _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\\' ) ) ),
+                _mm256_or_si256( _mm256_cmpeq_epi8( _mm256_min_epu8( v, _mm256_set1_epi8( 0x1F ) ), v ),
+                                 _mm256_and_si256( v, high ) ) );
+    uint32_t mask = ( uint32_t )_mm256_movemask_epi8( e );
+    if( mask )
+    {
+      return p + JsnCountTrailingZeros( mask );
+    }
+    p += 32;
+  }
+#elif defined( JSN_SSE2 )
+  const __m128i high = escape_utf8 ? _mm_set1_epi8( ( char )0x80 ) : _mm_setzero_si128();
+  while( end - p >= 16 )
+  {
+    __m128i v = _mm_loadu_si128( ( const __m128i* )p );
+    __m128i e = _mm_or_si128(
+                _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '"' ) ),
+                              _mm_cmpeq_epi8( v, _mm_set1_epi8( '\\' ) ) ),
+                _mm_or_si128( _mm_cmpeq_epi8( _mm_min_epu8( v, _mm_set1_epi8( 0x1F ) ), v ),
+                              _mm_and_si128( v, high ) ) );
+    uint32_t mask = ( uint32_t )_mm_movemask_epi8( e );
+    if( mask )
+    {
+      return p + JsnCountTrailingZeros( mask );
+    }
+    p += 16;
+  }
+#else
+  // Eight bytes at a time. A word only tells whether it has a byte of interest, not which one.
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t high = 0x8080808080808080ULL;
+  while( end - p >= 8 )
+  {
+    uint64_t v;
+    memcpy( &v, p, sizeof( v ) );
+    uint64_t quote     = v ^ ( ones * '"' );
+    uint64_t backslash = v ^ ( ones * '\\' );
+    uint64_t found = ( ( quote - ones ) & ~quote ) |
+                     ( ( backslash - ones ) & ~backslash ) |
+                     ( ( v - ones * 0x20 ) & ~v ) |
+                     ( escape_utf8 ? v : 0 );
+    if( found & high )
+    {
+      break;
+    }
+    p += 8;
+  }
+#endif
+  for( ; p < end; ++p )
+  {
+    uint8_t c = ( uint8_t )*p;
+    if( c == '"' || c == '\\' || c < 0x20 || ( escape_utf8 && c >= 0x80 ) )
+    {
+      break;
+    }
+  }
+  return p;
+}
+
+/************************************************************************************************************/ /**
+ \struct JsnStringMask
+ Tracks string state from one block to the next. Feed it blocks in order.
+ */
+struct JsnStringMask
+{
+  uint64_t m_PrevEscaped;   /**< 1 if the first byte of the next block is escaped by a trailing backslash */
+  uint64_t m_PrevInString;  /**< All ones if the previous block ended inside a string */
+
+  JsnStringMask()
+  : m_PrevEscaped( 0 )
+  , m_PrevInString( 0 )
+  {}
+
+  /**
+   Compute the string mask of the next block.
+   \param[ in ] block Classified block.
+   \param[ out ] quotes Quotes that are not escaped, i.e. those that open or close a string.
+   \return Mask of bytes inside strings. Includes the opening quote, excludes the closing quote.
+   */
+  uint64_t Next( const JsnBlock& block, uint64_t* quotes )
+  {
+    uint64_t escaped = 0;
+    uint64_t backslash = block.m_Backslash;
+    if( backslash || m_PrevEscaped )
+    {
+      // A run of backslashes escapes the byte after it if the run has odd length.
+      const uint64_t even_bits = 0x5555555555555555ULL;
+      backslash &= ~m_PrevEscaped;
+      uint64_t follows_escape = ( backslash << 1 ) | m_PrevEscaped;
+      uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+      uint64_t even_starts_carry = odd_starts + backslash;
+      m_PrevEscaped = even_starts_carry < odd_starts ? 1 : 0;
+      uint64_t invert = even_starts_carry << 1;
+      escaped = ( even_bits ^ invert ) & follows_escape;
+    }
+    *quotes = block.m_Quote & ~escaped;
+    uint64_t in_string = JsnPrefixXor( *quotes ) ^ m_PrevInString;
+    m_PrevInString = ( uint64_t )( ( int64_t )in_string >> 63 );
+    return in_string;
+  }
+};
+
+/****************************************************************************************************************/
@@ -0,0 +1,590 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnCbor.h"
+#include "JsnUTF8.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Major types, the top three bits of the initial byte of a data item
+enum
+{
+  kCbor_Unsigned,
+  kCbor_Negative,
+  kCbor_Bytes,
+  kCbor_Text,
+  kCbor_Array,
+  kCbor_Map,
+  kCbor_Tag,
+  kCbor_Simple
+};
+
+// Additional information, the low five bits of the initial byte
+enum
+{
+  kCbor_False       = 20,
+  kCbor_True        = 21,
+  kCbor_Null        = 22,
+  kCbor_Undefined   = 23,
+  kCbor_OneByte     = 24,
+  kCbor_Half        = 25,
+  kCbor_Single      = 26,
+  kCbor_Double      = 27,
+  kCbor_Indefinite  = 31
+};
+
+static const int kCborBreak = 0xFF;
+
+/****************************************************************************************************************/
+
+namespace
+{
+  // Consumes the contents of objects and arrays that the handler chose to skip
+  class SkipHandler final : public JsnHandler
+  {
+  public:
+    virtual void        AddProperty( const JsnFragment&, const JsnFragment& ) override {}
+    virtual JsnHandler* BeginObject( const JsnFragment& ) override { return this; }
+    virtual void        EndObject( JsnHandler* ) override {}
+    virtual JsnHandler* BeginArray( const JsnFragment& ) override { return this; }
+    virtual void        EndArray( JsnHandler* ) override {}
+  };
+
+  class CborParser
+  {
+  public:
+
+    CborParser( JsnStreamIn* stream )
+    : m_Stream( stream )
+    , m_Stop( false )
+    {}
+
+    void ParseItem( JsnHandler* reader, const JsnFragment& name );
+
+  private:
+
+    JsnStreamIn*  m_Stream;
+    bool          m_Stop;     // A handler called RequestStop()
+    SkipHandler   m_Skip;
+
+    bool        ReadHead( int* major, int* info, uint64_t* argument );
+    bool        ReadUntagged( int* major, int* info, uint64_t* argument );
+    JsnFragment ReadText( uint64_t length );
+    bool        CheckStop( JsnHandler* reader );
+    void        ParseArray( JsnHandler* reader, int info, uint64_t count );
+    void        ParseMap( JsnHandler* reader, int info, uint64_t count );
+  };
+}
+
+/****************************************************************************************************************/
+
+static double HalfToDouble( uint64_t half )
+{
+  int exponent = ( int )( half >> 10 ) & 0x1F;
+  int mantissa = ( int )half & 0x3FF;
+  double value;
+  if( exponent == 0 )
+  {
+    value = ldexp( mantissa, -24 );
+  }
+  else if( exponent != 31 )
+  {
+    value = ldexp( mantissa + 1024, exponent - 25 );
+  }
+  else
+  {
+    value = mantissa ? NAN : INFINITY;
+  }
+  return half & 0x8000 ? -value : value;
+}
+
+// Read the initial byte of a data item, and the argument that follows it. For items of indefinite length,
+// info is kCbor_Indefinite and the argument is zero.
+bool CborParser::ReadHead( int* major, int* info, uint64_t* argument )
+{
+  int c = m_Stream->Read();
+  if( c == -1 )
+  {
+    return false;
+  }
+  *major = c >> 5;
+  *info = c & 0x1F;
+  *argument = 0;
+  if( *info < kCbor_OneByte )
+  {
+    *argument = ( uint64_t )*info;
+  }
+  else if( *info <= kCbor_Double )
+  {
+    int count = 1 << ( *info - kCbor_OneByte );
+    for( int i = 0; i < count; ++i )
+    {
+      c = m_Stream->Read();
+      *argument = ( *argument << 8 ) | ( uint64_t )c;
+    }
+  }
+  else if( *info != kCbor_Indefinite || *major == kCbor_Unsigned || *major == kCbor_Negative ||
+           *major == kCbor_Tag )
+  {
+    m_Stream->SetError( "Invalid CBOR item" );
+  }
+  return !m_Stream->GetError();
+}
+
+// Tags add meaning to the item that follows them, but do not change its content. Skip them.
+bool CborParser::ReadUntagged( int* major, int* info, uint64_t* argument )
+{
+  while( ReadHead( major, info, argument ) )
+  {
+    if( *major != kCbor_Tag )
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+JsnFragment CborParser::ReadText( uint64_t length )
+{
+  if( length > ( uint64_t )m_Stream->GetRemaining() )
+  {
+    m_Stream->SetError( "Unexpected end of input data" );
+    return JsnFragment();
+  }
+  JsnFragment text( kJsn_String, m_Stream->GetCurrent(), ( int64_t )length );
+  text.m_Flags = kJsnFlag_Unescaped;
+  m_Stream->Seek( m_Stream->GetCount() + ( int64_t )length );
+  return text;
+}
+
+bool CborParser::CheckStop( JsnHandler* reader )
+{
+  if( reader->IsStopRequested() )
+  {
+    reader->ClearStopRequest();
+    m_Stop = true;
+  }
+  return m_Stop;
+}
+
+void CborParser::ParseArray( JsnHandler* reader, int info, uint64_t count )
+{
+  bool indefinite = info == kCbor_Indefinite;
+  for( uint64_t i = 0; ( indefinite || i < count ) && !m_Stream->GetError() && !m_Stop; ++i )
+  {
+    if( indefinite && m_Stream->Peek() == kCborBreak )
+    {
+      m_Stream->Read();
+      return;
+    }
+    ParseItem( reader, JsnFragment() );
+  }
+}
+
+void CborParser::ParseMap( JsnHandler* reader, int info, uint64_t count )
+{
+  bool indefinite = info == kCbor_Indefinite;
+  for( uint64_t i = 0; ( indefinite || i < count ) && !m_Stream->GetError() && !m_Stop; ++i )
+  {
+    if( indefinite && m_Stream->Peek() == kCborBreak )
+    {
+      m_Stream->Read();
+      return;
+    }
+    int major;
+    int key_info;
+    uint64_t length;
+    if( !ReadUntagged( &major, &key_info, &length ) )
+    {
+      return;
+    }
+    if( major != kCbor_Text || key_info == kCbor_Indefinite )
+    {
+      m_Stream->SetError( "Map key must be a text string" );
+      return;
+    }
+    JsnFragment name = ReadText( length );
+    if( !m_Stream->GetError() )
+    {
+      ParseItem( reader, name );
+    }
+  }
+}
+
+void CborParser::ParseItem( JsnHandler* reader, const JsnFragment& name )
+{
+  int major;
+  int info;
+  uint64_t argument;
+  if( !ReadUntagged( &major, &info, &argument ) )
+  {
+    return;
+  }
+  switch( major )
+  {
+    case kCbor_Unsigned:
+      reader->AddProperty( name, argument > INT64_MAX ? JsnFragment::FromFloat( ( double )argument )
+                                                      : JsnFragment::FromInt( ( int64_t )argument ) );
+      break;
+
+    case kCbor_Negative:
+      reader->AddProperty( name, argument > INT64_MAX ? JsnFragment::FromFloat( -1.0 - ( double )argument )
+                                                      : JsnFragment::FromInt( -1 - ( int64_t )argument ) );
+      break;
+
+    case kCbor_Bytes:
+      m_Stream->SetError( "CBOR byte strings are not supported" );
+      return;
+
+    case kCbor_Text:
+    {
+      if( info == kCbor_Indefinite )
+      {
+        m_Stream->SetError( "CBOR text strings of indefinite length are not supported" );
+        return;
+      }
+      JsnFragment value = ReadText( argument );
+      if( !m_Stream->GetError() )
+      {
+        reader->AddProperty( name, value );
+      }
+      break;
+    }
+
+    case kCbor_Array:
+    {
+      JsnHandler* child_reader = reader->BeginArray( name );
+      if( !child_reader )
+      {
+        if( !CheckStop( reader ) )
+        {
+          ParseArray( &m_Skip, info, argument );
+        }
+        return;
+      }
+      if( !CheckStop( reader ) )
+      {
+        ParseArray( child_reader, info, argument );
+      }
+      reader->EndArray( child_reader );
+      break;
+    }
+
+    case kCbor_Map:
+    {
+      JsnHandler* child_reader = reader->BeginObject( name );
+      if( !child_reader )
+      {
+        if( !CheckStop( reader ) )
+        {
+          ParseMap( &m_Skip, info, argument );
+        }
+        return;
+      }
+      if( !CheckStop( reader ) )
+      {
+        ParseMap( child_reader, info, argument );
+      }
+      reader->EndObject( child_reader );
+      break;
+    }
+
+    default:
+      switch( info )
+      {
+        case kCbor_False:
+          reader->AddProperty( name, JsnFragment( kJsn_False ) );
+          break;
+
+        case kCbor_True:
+          reader->AddProperty( name, JsnFragment( kJsn_True ) );
+          break;
+
+        case kCbor_Null:
+        case kCbor_Undefined:
+          reader->AddProperty( name, JsnFragment( kJsn_Null ) );
+          break;
+
+        case kCbor_Half:
+          reader->AddProperty( name, JsnFragment::FromFloat( HalfToDouble( argument ) ) );
+          break;
+
+        case kCbor_Single:
+        {
+          uint32_t bits = ( uint32_t )argument;
+          float f;
+          memcpy( &f, &bits, sizeof( f ) );
+          reader->AddProperty( name, JsnFragment::FromFloat( f ) );
+          break;
+        }
+
+        case kCbor_Double:
+        {
+          double d;
+          memcpy( &d, &argument, sizeof( d ) );
+          reader->AddProperty( name, JsnFragment::FromFloat( d ) );
+          break;
+        }
+
+        case kCbor_Indefinite:
+          m_Stream->SetError( "Unexpected CBOR break" );
+          return;
+
+        default:
+          m_Stream->SetError( "CBOR simple value not supported" );
+          return;
+      }
+      break;
+  }
+  CheckStop( reader );
+}
+
+/****************************************************************************************************************/
+
+bool JsnParseCbor( JsnHandler* reader, JsnStreamIn* stream )
+{
+  CborParser parser( stream );
+  parser.ParseItem( reader, JsnFragment() );
+  return !stream->GetError();
+}
+
+/****************************************************************************************************************/
+
+JsnCborWriter::JsnCborWriter( JsnStreamOut* stream )
+: m_Stream( stream )
+, m_Depth( 0 )
+{
+  m_InObject[ 0 ] = false;
+}
+
+// Write the initial byte of a data item, followed by count bytes of its argument, most significant first.
+static void WriteItem( JsnStreamOut* stream, int major, int info, uint64_t argument, int count )
+{
+  char buf[ 9 ];
+  buf[ 0 ] = ( char )( ( major << 5 ) | info );
+  for( int i = 0; i < count; ++i )
+  {
+    buf[ count - i ] = ( char )( argument >> ( 8 * i ) );
+  }
+  stream->Write( buf, count + 1 );
+}
+
+// Whether a single precision float holds the value exactly. Infinities and NaN fit.
+static bool IsSingle( double d )
+{
+  if( d != d || fabs( d ) > DBL_MAX )
+  {
+    return true;
+  }
+  return fabs( d ) <= FLT_MAX && ( double )( float )d == d;
+}
+
+// Write the initial byte of a data item, followed by its argument in as few bytes as possible.
+void JsnCborWriter::WriteHead( int major, uint64_t argument )
+{
+  int count;
+  int info;
+  if( argument < kCbor_OneByte )
+  {
+    count = 0;
+    info = ( int )argument;
+  }
+  else if( argument <= 0xFF )
+  {
+    count = 1;
+    info = kCbor_OneByte;
+  }
+  else if( argument <= 0xFFFF )
+  {
+    count = 2;
+    info = kCbor_OneByte + 1;
+  }
+  else if( argument <= 0xFFFFFFFF )
+  {
+    count = 4;
+    info = kCbor_OneByte + 2;
+  }
+  else
+  {
+    count = 8;
+    info = kCbor_OneByte + 3;
+  }
+  WriteItem( m_Stream, major, info, argument, count );
+}
+
+void JsnCborWriter::WriteString( const JsnFragment& fragment )
+{
+  const char* text = fragment.m_Text;
+  int64_t length = fragment.m_Length;
+  if( length && !( fragment.m_Flags & kJsnFlag_Unescaped ) && memchr( text, '\\', ( size_t )length ) )
+  {
+    // The length goes before the text, so decode into a copy first
+    char  small[ 256 ];
+    char* buf = length <= ( int64_t )sizeof( small ) ? small : new char[ length ];
+    memcpy( buf, text, ( size_t )length );
+    length = JsnUnescapeInPlace( buf, length );
+    if( length < 0 )
+    {
+      m_Stream->SetError( "Invalid escape sequence" );
+    }
+    else
+    {
+      WriteHead( kCbor_Text, ( uint64_t )length );
+      m_Stream->Write( buf, length );
+    }
+    if( buf != small )
+    {
+      delete[] buf;
+    }
+    return;
+  }
+  WriteHead( kCbor_Text, ( uint64_t )length );
+  m_Stream->Write( text, length );
+}
+
+void JsnCborWriter::WriteName( const JsnFragment& name )
+{
+  // Past the maximum depth the stream is in error, and nothing gets written
+  if( m_Depth && m_InObject[ m_Depth <= JSN_WRITER_MAX_DEPTH ? m_Depth : JSN_WRITER_MAX_DEPTH ] )
+  {
+    WriteString( name );
+  }
+}
+
+void JsnCborWriter::Push( bool object )
+{
+  m_Depth += 1;
+  if( m_Depth > JSN_WRITER_MAX_DEPTH )
+  {
+    m_Stream->SetError( "Nesting too deep for JsnCborWriter" );
+    return;
+  }
+  m_InObject[ m_Depth ] = object;
+}
+
+void JsnCborWriter::Pop()
+{
+  if( m_Depth )
+  {
+    m_Depth -= 1;
+  }
+}
+
+void JsnCborWriter::AddProperty( const JsnFragment& name, const JsnFragment& value )
+{
+  switch( value.m_Type )
+  {
+    case kJsn_Int:
+    {
+      WriteName( name );
+      int64_t i = value.AsInt();
+      if( i >= 0 )
+      {
+        WriteHead( kCbor_Unsigned, ( uint64_t )i );
+      }
+      else
+      {
+        WriteHead( kCbor_Negative, ( uint64_t )( -1 - i ) );
+      }
+      break;
+    }
+
+    case kJsn_Float:
+    {
+      WriteName( name );
+      double d = value.AsFloat();
+      if( IsSingle( d ) )
+      {
+        float f = ( float )d;
+        uint32_t bits;
+        memcpy( &bits, &f, sizeof( bits ) );
+        WriteItem( m_Stream, kCbor_Simple, kCbor_Single, bits, 4 );
+      }
+      else
+      {
+        uint64_t bits;
+        memcpy( &bits, &d, sizeof( bits ) );
+        WriteItem( m_Stream, kCbor_Simple, kCbor_Double, bits, 8 );
+      }
+      break;
+    }
+
+    case kJsn_String:
+      WriteName( name );
+      WriteString( value );
+      break;
+
+    case kJsn_True:
+      WriteName( name );
+      m_Stream->Write( ( kCbor_Simple << 5 ) | kCbor_True );
+      break;
+
+    case kJsn_False:
+      WriteName( name );
+      m_Stream->Write( ( kCbor_Simple << 5 ) | kCbor_False );
+      break;
+
+    case kJsn_Null:
+      WriteName( name );
+      m_Stream->Write( ( kCbor_Simple << 5 ) | kCbor_Null );
+      break;
+
+    default:
+      break;
+  }
+}
+
+JsnHandler* JsnCborWriter::BeginObject( const JsnFragment& name )
+{
+  WriteName( name );
+  m_Stream->Write( ( kCbor_Map << 5 ) | kCbor_Indefinite );
+  Push( true );
+  return this;
+}
+
+void JsnCborWriter::EndObject( JsnHandler* )
+{
+  Pop();
+  m_Stream->Write( kCborBreak );
+}
+
+JsnHandler* JsnCborWriter::BeginArray( const JsnFragment& name )
+{
+  WriteName( name );
+  m_Stream->Write( ( kCbor_Array << 5 ) | kCbor_Indefinite );
+  Push( false );
+  return this;
+}
+
+void JsnCborWriter::EndArray( JsnHandler* )
+{
+  Pop();
+  m_Stream->Write( kCborBreak );
+}
+
+/****************************************************************************************************************/
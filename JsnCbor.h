@@ -0,0 +1,91 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+#include "JsnStream.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \class JsnCborWriter
+ Writes CBOR (RFC 8949) instead of JSON text. Implements JsnHandler, and is used just like JsnWriter: pass
+ it to JsnParse() to convert JSON text, or call its members to write your own data.
+
+ Objects and arrays are written with indefinite length, because their size is not known when they begin.
+ Strings and names are written as text strings. JSON text is unescaped on the way, and fragments with the
+ kJsnFlag_Unescaped flag are copied as they are. Integers are written as integers, floats as single
+ precision if that holds the value exactly, and double precision otherwise.
+ */
+class JsnCborWriter final : public JsnHandler
+{
+public:
+
+  /**
+   Construct JsnCborWriter with an output stream.
+   \param[ in ] stream Output stream.
+   */
+  JsnCborWriter( JsnStreamOut* stream );
+
+  virtual void        AddProperty( const JsnFragment& name, const JsnFragment& value ) override;
+  virtual JsnHandler* BeginObject( const JsnFragment& name ) override;
+  virtual void        EndObject( JsnHandler* byoc ) override;
+  virtual JsnHandler* BeginArray( const JsnFragment& name ) override;
+  virtual void        EndArray( JsnHandler* byoc ) override;
+
+private:
+
+  JsnStreamOut*   m_Stream;
+  int             m_Depth;
+  bool            m_InObject[ JSN_WRITER_MAX_DEPTH + 1 ]; // Whether each nesting level is an object or an array
+
+  JsnCborWriter( const JsnCborWriter& other );
+  void WriteHead( int major, uint64_t argument );
+  void WriteString( const JsnFragment& fragment );
+  void WriteName( const JsnFragment& name );
+  void Push( bool object );
+  void Pop();
+};
+
+/************************************************************************************************************/ /**
+ Parse a CBOR data item, and call members of the handler implementation as its contents are decoded. The
+ handler receives the same calls as from JsnParse(), so any handler that builds your data from JSON text
+ builds it from CBOR as well.
+
+ Text strings are passed without copying, as fragments that point into the input, with the
+ kJsnFlag_Unescaped flag. Numbers are passed as fragments without text, with the decoded value in m_Value
+ and the kJsnFlag_Decoded flag, like JsnFragment::FromInt() and JsnFragment::FromFloat(). Integers outside
+ the int64_t range become floats. Tags are ignored, and undefined is passed as null.
+
+ Byte strings, text strings of indefinite length, map keys that are not text strings and simple values
+ other than false, true, null and undefined have no JSON equivalent, and are reported as errors.
+ Returning NULL from BeginObject() or BeginArray() and RequestStop() work as with JsnParse().
+ \param[ in ] reader Handler implementation.
+ \param[ in ] stream Input stream, positioned at the start of the data item.
+ \return true if successful, false if not. Call stream->GetError() for details.
+ */
+bool JsnParseCbor( JsnHandler* reader, JsnStreamIn* stream );
+
+/****************************************************************************************************************/
@@ -0,0 +1,466 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnDocument.h"
+#include "JsnIndex.h"
+#include "JsnParseStatic.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/****************************************************************************************************************/
+
+// Each entry has a tag in the top 8 bits. A tag is a JsnType, or one of the following.
+enum
+{
+  kTag_Name = kJsn_Array + 1, // Property name, followed by the value
+  kTag_End                    // Close of object or array. Payload is the index of the open entry
+};
+
+// Strings and names take two entries: offset of the text, then length with flags in the top 8 bits.
+// Numbers take two entries: the tag, then the bits of the int64_t or double.
+// Objects and arrays open with the index of the close entry, and close with the index of the open entry.
+// The first entry of a value that is preceded by a name has the kEntry_Named bit set.
+static const uint64_t kEntry_Named = ( uint64_t )1 << 55;
+static const uint64_t kPayloadMask = kEntry_Named - 1;
+static const uint64_t kFlag_Copied = 1 << 7; // Text is in m_Strings, rather than in m_Text
+
+static inline uint64_t MakeEntry( int tag, uint64_t payload )
+{
+  return ( ( uint64_t )tag << 56 ) | payload;
+}
+
+/****************************************************************************************************************/
+
+JsnDocument::JsnDocument()
+: m_Tape( NULL )
+, m_Count( 0 )
+, m_Capacity( 0 )
+, m_Strings( NULL )
+, m_StringsSize( 0 )
+, m_StringsCapacity( 0 )
+, m_Text( NULL )
+, m_TextEnd( NULL )
+, m_Open( -1 )
+{}
+
+/****************************************************************************************************************/
+
+JsnDocument::~JsnDocument()
+{
+  delete[] m_Tape;
+  delete[] m_Strings;
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::Clear()
+{
+  m_Count = 0;
+  m_StringsSize = 0;
+  m_Text = NULL;
+  m_TextEnd = NULL;
+  m_Open = -1;
+}
+
+/****************************************************************************************************************/
+
+bool JsnDocument::Parse( JsnStreamIn* stream, const JsnParseOptions& options )
+{
+  Clear();
+  return Append( stream, options );
+}
+
+/****************************************************************************************************************/
+
+bool JsnDocument::Append( JsnStreamIn* stream, const JsnParseOptions& options )
+{
+  // Strings in the stream's text are stored by offset. Later calls with a stream over the same text, but
+  // perhaps a longer stretch of it, can share the offsets.
+  const char* text = stream->GetCurrent() - stream->GetCount();
+  const char* text_end = stream->GetCurrent() + stream->GetRemaining();
+  if( !m_Text )
+  {
+    m_Text = text;
+    m_TextEnd = text_end;
+  }
+  else if( text == m_Text && text_end > m_TextEnd )
+  {
+    m_TextEnd = text_end;
+  }
+
+  // Every value and name takes at most two entries, and at least one index position per entry. Without
+  // an index, a number can be as short as two characters including the comma.
+  int64_t count = m_Count;
+  int64_t strings_size = m_StringsSize;
+  Reserve( m_Count + ( options.m_Index ? 2 * options.m_Index->GetCount() + 2 : stream->GetRemaining() / 4 + 16 ) );
+
+  if( !JsnParse< JsnDocument >( this, stream, options ) )
+  {
+    m_Count = count;
+    m_StringsSize = strings_size;
+    m_Open = -1;
+    return false;
+  }
+  return true;
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::Reserve( int64_t count )
+{
+  if( count > m_Capacity )
+  {
+    int64_t capacity = m_Capacity ? m_Capacity * 2 : 256;
+    while( capacity < count )
+    {
+      capacity *= 2;
+    }
+    uint64_t* tape = new uint64_t[ capacity ];
+    if( m_Count )
+    {
+      memcpy( tape, m_Tape, m_Count * sizeof( uint64_t ) );
+    }
+    delete[] m_Tape;
+    m_Tape = tape;
+    m_Capacity = capacity;
+  }
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::AddString( int tag, const JsnFragment& text, uint64_t named )
+{
+  uint64_t flags = text.m_Flags & ( kJsnFlag_Escaped | kJsnFlag_Unescaped );
+  uint64_t offset;
+  if( m_Text && text.m_Text >= m_Text && text.m_Text + text.m_Length <= m_TextEnd )
+  {
+    offset = ( uint64_t )( text.m_Text - m_Text );
+  }
+  else
+  {
+    if( m_StringsSize + text.m_Length > m_StringsCapacity )
+    {
+      int64_t capacity = m_StringsCapacity ? m_StringsCapacity * 2 : 4096;
+      while( capacity < m_StringsSize + text.m_Length )
+      {
+        capacity *= 2;
+      }
+      char* strings = new char[ capacity ];
+      if( m_StringsSize )
+      {
+        memcpy( strings, m_Strings, m_StringsSize );
+      }
+      delete[] m_Strings;
+      m_Strings = strings;
+      m_StringsCapacity = capacity;
+    }
+    if( text.m_Length )
+    {
+      memcpy( m_Strings + m_StringsSize, text.m_Text, text.m_Length );
+    }
+    offset = ( uint64_t )m_StringsSize;
+    m_StringsSize += text.m_Length;
+    flags |= kFlag_Copied;
+  }
+  m_Tape[ m_Count++ ] = MakeEntry( tag, offset ) | named;
+  m_Tape[ m_Count++ ] = MakeEntry( ( int )flags, ( uint64_t )text.m_Length );
+}
+
+/****************************************************************************************************************/
+
+uint64_t JsnDocument::AddName( const JsnFragment& name )
+{
+  // Only members of objects have a name. The root value and array elements don't.
+  if( m_Open >= 0 && GetTag( m_Open ) == kJsn_Object )
+  {
+    Reserve( m_Count + 4 );
+    AddString( kTag_Name, name, 0 );
+    return kEntry_Named;
+  }
+  Reserve( m_Count + 2 );
+  return 0;
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::AddProperty( const JsnFragment& name, const JsnFragment& value )
+{
+  uint64_t named = AddName( name );
+  switch( value.m_Type )
+  {
+    case kJsn_String:
+      AddString( kJsn_String, value, named );
+      break;
+
+    case kJsn_Int:
+    {
+      int64_t i = value.AsInt();
+      m_Tape[ m_Count++ ] = MakeEntry( kJsn_Int, 0 ) | named;
+      memcpy( &m_Tape[ m_Count++ ], &i, sizeof( i ) );
+      break;
+    }
+
+    case kJsn_Float:
+    {
+      double f = value.AsFloat();
+      m_Tape[ m_Count++ ] = MakeEntry( kJsn_Float, 0 ) | named;
+      memcpy( &m_Tape[ m_Count++ ], &f, sizeof( f ) );
+      break;
+    }
+
+    default:
+      m_Tape[ m_Count++ ] = MakeEntry( value.m_Type, 0 ) | named;
+      break;
+  }
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::Begin( const JsnFragment& name, JsnType type )
+{
+  uint64_t named = AddName( name );
+  // Until the close, the payload links to the enclosing open entry, so no separate stack is needed
+  m_Tape[ m_Count ] = MakeEntry( type, ( uint64_t )( m_Open + 1 ) ) | named;
+  m_Open = m_Count++;
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::End()
+{
+  if( m_Open < 0 )
+  {
+    return;
+  }
+  Reserve( m_Count + 1 );
+  int64_t open = m_Open;
+  m_Open = ( int64_t )( m_Tape[ open ] & kPayloadMask ) - 1;
+  m_Tape[ open ] = ( m_Tape[ open ] & ~kPayloadMask ) | ( uint64_t )m_Count;
+  m_Tape[ m_Count++ ] = MakeEntry( kTag_End, ( uint64_t )open );
+}
+
+/****************************************************************************************************************/
+
+JsnDocument* JsnDocument::BeginObject( const JsnFragment& name )
+{
+  Begin( name, kJsn_Object );
+  return this;
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::EndObject( JsnHandler* )
+{
+  End();
+}
+
+/****************************************************************************************************************/
+
+JsnDocument* JsnDocument::BeginArray( const JsnFragment& name )
+{
+  Begin( name, kJsn_Array );
+  return this;
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::EndArray( JsnHandler* )
+{
+  End();
+}
+
+/****************************************************************************************************************/
+
+JsnFragment JsnDocument::GetString( int64_t index ) const
+{
+  uint64_t offset = m_Tape[ index ] & kPayloadMask;
+  uint64_t flags = m_Tape[ index + 1 ] >> 56;
+  const char* base = ( flags & kFlag_Copied ) ? m_Strings : m_Text;
+  JsnFragment fragment( kJsn_String, base + offset, ( int64_t )( m_Tape[ index + 1 ] & kPayloadMask ) );
+  fragment.m_Flags = ( uint32_t )( flags & ~kFlag_Copied );
+  return fragment;
+}
+
+/****************************************************************************************************************/
+
+JsnFragment JsnDocument::GetValue( int64_t index ) const
+{
+  switch( GetTag( index ) )
+  {
+    case kJsn_String:
+      return GetString( index );
+
+    case kJsn_Int:
+    {
+      int64_t i;
+      memcpy( &i, &m_Tape[ index + 1 ], sizeof( i ) );
+      return JsnFragment::FromInt( i );
+    }
+
+    case kJsn_Float:
+    {
+      double f;
+      memcpy( &f, &m_Tape[ index + 1 ], sizeof( f ) );
+      return JsnFragment::FromFloat( f );
+    }
+
+    default:
+      return JsnFragment( GetType( index ) );
+  }
+}
+
+/****************************************************************************************************************/
+
+JsnFragment JsnDocument::GetName( int64_t index ) const
+{
+  if( m_Tape[ index ] & kEntry_Named )
+  {
+    return GetString( index - 2 );
+  }
+  return JsnFragment();
+}
+
+/****************************************************************************************************************/
+
+int64_t JsnDocument::GetEnd( int64_t index ) const
+{
+  switch( GetTag( index ) )
+  {
+    case kJsn_Object:
+    case kJsn_Array:
+      return ( int64_t )( m_Tape[ index ] & kPayloadMask ) + 1;
+
+    case kJsn_Int:
+    case kJsn_Float:
+    case kJsn_String:
+    case kTag_Name:
+      return index + 2;
+
+    default:
+      return index + 1;
+  }
+}
+
+/****************************************************************************************************************/
+
+int64_t JsnDocument::GetChild( int64_t index ) const
+{
+  int tag = GetTag( index );
+  if( ( tag != kJsn_Object && tag != kJsn_Array ) || GetTag( index + 1 ) == kTag_End )
+  {
+    return -1;
+  }
+  return tag == kJsn_Object ? index + 3 : index + 1;
+}
+
+/****************************************************************************************************************/
+
+int64_t JsnDocument::GetNext( int64_t index ) const
+{
+  int64_t next = GetEnd( index );
+  if( next >= m_Count )
+  {
+    return -1;
+  }
+  switch( GetTag( next ) )
+  {
+    case kTag_End:
+      return -1;
+
+    case kTag_Name:
+      return next + 2;
+
+    default:
+      return next;
+  }
+}
+
+/****************************************************************************************************************/
+
+static void CheckStop( JsnHandler* handler, bool* stop )
+{
+  if( handler->IsStopRequested() )
+  {
+    handler->ClearStopRequest();
+    *stop = true;
+  }
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::WriteValue( JsnHandler* handler, const JsnFragment& name, int64_t index, bool* stop ) const
+{
+  switch( GetTag( index ) )
+  {
+    case kJsn_Object:
+    {
+      JsnHandler* child_handler = handler->BeginObject( name );
+      CheckStop( handler, stop );
+      if( child_handler )
+      {
+        for( int64_t child = GetChild( index ); child >= 0 && !*stop; child = GetNext( child ) )
+        {
+          WriteValue( child_handler, GetName( child ), child, stop );
+        }
+        handler->EndObject( child_handler );
+      }
+      break;
+    }
+
+    case kJsn_Array:
+    {
+      JsnHandler* child_handler = handler->BeginArray( name );
+      CheckStop( handler, stop );
+      if( child_handler )
+      {
+        for( int64_t child = GetChild( index ); child >= 0 && !*stop; child = GetNext( child ) )
+        {
+          WriteValue( child_handler, JsnFragment(), child, stop );
+        }
+        handler->EndArray( child_handler );
+      }
+      break;
+    }
+
+    default:
+      handler->AddProperty( name, GetValue( index ) );
+      break;
+  }
+  CheckStop( handler, stop );
+}
+
+/****************************************************************************************************************/
+
+void JsnDocument::Write( JsnHandler* handler, int64_t index ) const
+{
+  if( index < m_Count )
+  {
+    bool stop = false;
+    WriteValue( handler, GetName( index ), index, &stop );
+  }
+}
+
+/****************************************************************************************************************/
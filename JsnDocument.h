@@ -0,0 +1,181 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \class JsnDocument
+ Ready-made handler that stores the whole document in one flat array of 64-bit entries, called the tape,
+ in the order the values appear in the text. There are no per-value allocations: the tape and a buffer
+ for copied strings are the only memory the document owns, and both are reused by the next Parse().
+
+ A value is identified by its tape index. The root value is at index 0. Each object or array entry holds
+ the index of its matching close entry, so GetEnd() skips a subtree of any size in constant time. Strings
+ and property names point into the parsed text, which must therefore remain valid, and unchanged, for
+ the life span of the document.
+
+ \code
+ JsnDocument doc;
+ JsnStreamIn stream( text, length );
+ if( doc.Parse( &stream ) && doc.GetType( 0 ) == kJsn_Object )
+ {
+   for( int64_t i = doc.GetChild( 0 ); i >= 0; i = doc.GetNext( i ) )
+   {
+     JsnFragment name = doc.GetName( i );
+     JsnFragment value = doc.GetValue( i );
+     ...
+   }
+ }
+ \endcode
+
+ The document can also be filled by any other source of JsnHandler calls, such as JsnPushParser. Call
+ Clear() first. Fragments that do not point into text passed to Parse() are copied into the document.
+ */
+class JsnDocument final : public JsnHandler
+{
+public:
+
+  JsnDocument();
+  ~JsnDocument();
+
+  /**
+   Parse a JSON text into the document, replacing the previous contents.
+   \param[ in ] stream Stream over the text. The text must remain valid for the life span of the
+   document, or until the next Parse().
+   \param[ in ] options Parse options. See JsnParseOptions.
+   \return true if successful, false if not. The document is empty after an error. Call
+   stream->GetError() for details.
+   */
+  bool Parse( JsnStreamIn* stream, const JsnParseOptions& options = JsnParseOptions() );
+
+  /**
+   Parse a JSON text, and add its value to the document after the values already there. GetNext() of a top
+   level value returns the next top level value. Use this to collect several texts, such as the lines of a
+   JSON Lines file, in one document.
+   \param[ in ] stream Stream over the text. Like for Parse(), the text must remain valid.
+   \param[ in ] options Parse options. See JsnParseOptions.
+   \return true if successful, false if not. After an error, the document is as it was before the call.
+   Call stream->GetError() for details.
+   */
+  bool Append( JsnStreamIn* stream, const JsnParseOptions& options = JsnParseOptions() );
+
+  /**
+   Remove all values. Memory is kept for reuse.
+   */
+  void Clear();
+
+  /**
+   Return number of tape entries.
+   \return Number of entries. Zero if the document is empty.
+   */
+  int64_t GetCount() const { return m_Count; }
+
+  /**
+   Return type of a value.
+   \param[ in ] index Tape index of the value.
+   \return Type.
+   */
+  JsnType GetType( int64_t index ) const { return ( JsnType )GetTag( index ); }
+
+  /**
+   Return a value. Numbers come with the decoded value, and no text. Objects and arrays come with their
+   type only.
+   \param[ in ] index Tape index of the value.
+   \return The value.
+   */
+  JsnFragment GetValue( int64_t index ) const;
+
+  /**
+   Return the property name of a value.
+   \param[ in ] index Tape index of the value.
+   \return The name, or an empty fragment of type kJsn_Undefined if the value is not in an object.
+   */
+  JsnFragment GetName( int64_t index ) const;
+
+  /**
+   Return the first value in an object or array.
+   \param[ in ] index Tape index of the object or array.
+   \return Tape index of the first value, or -1 if there is none.
+   */
+  int64_t GetChild( int64_t index ) const;
+
+  /**
+   Return the next value in the same object or array.
+   \param[ in ] index Tape index of a value.
+   \return Tape index of the next value, or -1 if there is none.
+   */
+  int64_t GetNext( int64_t index ) const;
+
+  /**
+   Return the tape index just past a value, including everything nested in it. Constant time.
+   \param[ in ] index Tape index of a value.
+   \return Tape index past the value.
+   */
+  int64_t GetEnd( int64_t index ) const;
+
+  /**
+   Send a value and everything nested in it to another handler, such as a JsnWriter. The handler can skip
+   objects and arrays, and stop, like it can with JsnParse().
+   \param[ in ] handler Handler to receive the value.
+   \param[ in ] index Tape index of the value.
+   */
+  void Write( JsnHandler* handler, int64_t index = 0 ) const;
+
+  // Implementation of interface:
+  virtual void        AddProperty( const JsnFragment& name, const JsnFragment& value ) override;
+  virtual JsnDocument* BeginObject( const JsnFragment& name ) override;
+  virtual void        EndObject( JsnHandler* handler ) override;
+  virtual JsnDocument* BeginArray( const JsnFragment& name ) override;
+  virtual void        EndArray( JsnHandler* handler ) override;
+
+private:
+
+  uint64_t*   m_Tape;
+  int64_t     m_Count;
+  int64_t     m_Capacity;
+  char*       m_Strings;        // Text of fragments that did not point into m_Text
+  int64_t     m_StringsSize;
+  int64_t     m_StringsCapacity;
+  const char* m_Text;           // Text passed to Parse()
+  const char* m_TextEnd;
+  int64_t     m_Open;           // Tape index of innermost open object or array, or -1
+
+  int         GetTag( int64_t index ) const { return ( int )( m_Tape[ index ] >> 56 ); }
+  void        Reserve( int64_t count );
+  uint64_t    AddName( const JsnFragment& name );
+  void        AddString( int tag, const JsnFragment& text, uint64_t named );
+  void        Begin( const JsnFragment& name, JsnType type );
+  void        End();
+  JsnFragment GetString( int64_t index ) const;
+  void        WriteValue( JsnHandler* handler, const JsnFragment& name, int64_t index, bool* stop ) const;
+
+  JsnDocument( const JsnDocument& other );
+  JsnDocument& operator=( const JsnDocument& other );
+};
+
+/****************************************************************************************************************/
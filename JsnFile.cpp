@@ -0,0 +1,216 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnFile.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined( _WIN32 )
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/****************************************************************************************************************/
+
+JsnFileIn::JsnFileIn()
+: m_Data( NULL )
+, m_Size( 0 )
+, m_Error( NULL )
+, m_Mapping( NULL )
+{}
+
+/****************************************************************************************************************/
+
+JsnFileIn::~JsnFileIn()
+{
+  Close();
+}
+
+/****************************************************************************************************************/
+
+#if defined( _WIN32 )
+
+bool JsnFileIn::Open( const char* path, int flags )
+{
+  Close();
+
+  // Windows has no huge pages for file mappings, and no populate flag. Sequential scan is the one hint
+  // that applies.
+  ( void )flags;
+
+  HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+  if( file == INVALID_HANDLE_VALUE )
+  {
+    m_Error = "Cannot open file";
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if( !GetFileSizeEx( file, &size ) )
+  {
+    CloseHandle( file );
+    m_Error = "Cannot read file size";
+    return false;
+  }
+
+  if( size.QuadPart == 0 )
+  {
+    CloseHandle( file );
+    m_Data = "";
+    return true;
+  }
+
+  if( ( uint64_t )size.QuadPart > ( uint64_t )SIZE_MAX )
+  {
+    CloseHandle( file );
+    m_Error = "File too large to map";
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+  CloseHandle( file );
+  if( !mapping )
+  {
+    m_Error = "Cannot map file";
+    return false;
+  }
+
+  void* view = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+  if( !view )
+  {
+    CloseHandle( mapping );
+    m_Error = "Cannot map file";
+    return false;
+  }
+
+  m_Data    = ( const char* )view;
+  m_Size    = size.QuadPart;
+  m_Mapping = mapping;
+  return true;
+}
+
+void JsnFileIn::Close()
+{
+  if( m_Mapping )
+  {
+    UnmapViewOfFile( m_Data );
+    CloseHandle( ( HANDLE )m_Mapping );
+  }
+  m_Data    = NULL;
+  m_Size    = 0;
+  m_Error   = NULL;
+  m_Mapping = NULL;
+}
+
+#else
+
+bool JsnFileIn::Open( const char* path, int flags )
+{
+  Close();
+
+  int fd = open( path, O_RDONLY );
+  if( fd < 0 )
+  {
+    m_Error = "Cannot open file";
+    return false;
+  }
+
+  struct stat st;
+  if( fstat( fd, &st ) != 0 )
+  {
+    close( fd );
+    m_Error = "Cannot read file size";
+    return false;
+  }
+
+  if( st.st_size == 0 )
+  {
+    // Can't map zero bytes
+    close( fd );
+    m_Data = "";
+    return true;
+  }
+
+  if( ( uint64_t )st.st_size > ( uint64_t )SIZE_MAX )
+  {
+    close( fd );
+    m_Error = "File too large to map";
+    return false;
+  }
+
+  int map_flags = MAP_PRIVATE;
+#if defined( MAP_POPULATE )
+  if( flags & kJsnFile_Populate )
+  {
+    map_flags |= MAP_POPULATE;
+  }
+#endif
+
+  void* view = mmap( NULL, ( size_t )st.st_size, PROT_READ, map_flags, fd, 0 );
+  close( fd ); // The mapping keeps its own reference to the file
+  if( view == MAP_FAILED )
+  {
+    m_Error = "Cannot map file";
+    return false;
+  }
+
+  // Hints only. Failure is harmless.
+  madvise( view, ( size_t )st.st_size, MADV_SEQUENTIAL );
+#if defined( MADV_HUGEPAGE )
+  // Only has an effect with transparent huge pages for the page cache, which most kernels do not enable
+  if( flags & kJsnFile_HugePages )
+  {
+    madvise( view, ( size_t )st.st_size, MADV_HUGEPAGE );
+  }
+#endif
+
+  m_Data    = ( const char* )view;
+  m_Size    = ( int64_t )st.st_size;
+  m_Mapping = view;
+  return true;
+}
+
+void JsnFileIn::Close()
+{
+  if( m_Mapping )
+  {
+    munmap( m_Mapping, ( size_t )m_Size );
+  }
+  m_Data    = NULL;
+  m_Size    = 0;
+  m_Error   = NULL;
+  m_Mapping = NULL;
+}
+
+#endif
+
+/****************************************************************************************************************/
@@ -0,0 +1,114 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnStream.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \enum JsnFileFlags
+ Options for JsnFileIn::Open(). Combine with bitwise or.
+ */
+enum JsnFileFlags
+{
+  kJsnFile_Default    = 0,      /**< Map the file, and tell the OS it will be read front to back */
+  kJsnFile_HugePages  = 1 << 0, /**< Ask the OS to back the mapping with huge pages. Best effort: on Linux this
+                                 is MADV_HUGEPAGE, which only affects a file mapping if the kernel has
+                                 transparent huge pages for the page cache enabled. Most do not, and then
+                                 the request is ignored. */
+  kJsnFile_Populate   = 1 << 1  /**< Read the whole file into memory up front, instead of on demand */
+};
+
+/************************************************************************************************************/ /**
+ \class JsnFileIn
+ Read-only memory mapped file. The text is parsed straight from the page cache: there is no copy, and
+ no heap buffer the size of the file. Works for files larger than 2 GB.
+
+ \code
+ JsnFileIn file;
+ if( file.Open( "export.json" ) )
+ {
+   JsnStreamIn stream = file.GetStream();
+   JsnParse( &handler, &stream );
+ }
+ \endcode
+ */
+class JsnFileIn
+{
+public:
+
+  JsnFileIn();
+  ~JsnFileIn();
+
+  /**
+   Map a file. Any previously mapped file is closed first.
+   \param[ in ] path Path of the file.
+   \param[ in ] flags Combination of JsnFileFlags.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Open( const char* path, int flags = kJsnFile_Default );
+
+  /**
+   Unmap the file. Fragments pointing into the file text become invalid.
+   */
+  void Close();
+
+  /**
+   Return error string.
+   \return Error string, or NULL if no error.
+   */
+  const char* GetError() const { return m_Error; }
+
+  /**
+   Return start of file text. Not zero terminated.
+   \return File text, or NULL if no file is open.
+   */
+  const char* GetData() const { return m_Data; }
+
+  /**
+   Return size of the file text.
+   \return Size in bytes.
+   */
+  int64_t GetSize() const { return m_Size; }
+
+  /**
+   Return an input stream over the file text.
+   \return Stream.
+   */
+  JsnStreamIn GetStream() const { return JsnStreamIn( m_Data, m_Size ); }
+
+private:
+
+  const char* m_Data;
+  int64_t     m_Size;
+  const char* m_Error;
+  void*       m_Mapping;  // Platform handle, if any
+
+  JsnFileIn( const JsnFileIn& other );
+  JsnFileIn& operator=( const JsnFileIn& other );
+};
+
+/****************************************************************************************************************/
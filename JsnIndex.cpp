@@ -0,0 +1,647 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnIndex.h"
+#include "JsnBlock.h"
+
+#include "JsnUTF8.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/****************************************************************************************************************/
+
+JsnIndex::JsnIndex()
+: m_Positions( NULL )
+, m_Count( 0 )
+, m_Capacity( 0 )
+, m_Links( NULL )
+, m_EscapedBits( NULL )
+, m_Elements( NULL )
+, m_ElementCount( 0 )
+, m_Error( NULL )
+{}
+
+/****************************************************************************************************************/
+
+JsnIndex::~JsnIndex()
+{
+  delete[] m_Positions;
+  ClearLinks();
+}
+
+/****************************************************************************************************************/
+
+void JsnIndex::ClearLinks()
+{
+  delete[] m_Links;
+  delete[] m_EscapedBits;
+  delete[] m_Elements;
+  m_Links = NULL;
+  m_EscapedBits = NULL;
+  m_Elements = NULL;
+  m_ElementCount = 0;
+}
+
+/****************************************************************************************************************/
+
+void JsnIndex::Grow( int64_t count )
+{
+  m_Capacity *= 2;
+  uint64_t* positions = new uint64_t[ m_Capacity ];
+  memcpy( positions, m_Positions, count * sizeof( uint64_t ) );
+  delete[] m_Positions;
+  m_Positions = positions;
+}
+
+/****************************************************************************************************************/
+
+static inline uint64_t* WritePositions( uint64_t* out, uint64_t base, uint64_t bits )
+{
+  while( bits )
+  {
+    *out++ = base + JsnCountTrailingZeros( bits );
+    bits &= bits - 1;
+  }
+  return out;
+}
+
+/****************************************************************************************************************/
+
+bool JsnIndex::Build( const char* text, int64_t length )
+{
+  m_Count = 0;
+  m_Error = NULL;
+  ClearLinks();
+
+  if( !text || length < 0 )
+  {
+    length = 0;
+  }
+
+  // Typical JSON text has far fewer positions than bytes. Start with an estimate, and grow when a block
+  // might not fit. There is always room for one more block plus the end marker.
+  if( m_Capacity < length / 8 + 65 )
+  {
+    delete[] m_Positions;
+    m_Capacity  = length / 8 + 65;
+    m_Positions = new uint64_t[ m_Capacity ];
+  }
+
+  const uint8_t*  p = ( const uint8_t* )text;
+  uint64_t*       out = m_Positions;
+  JsnStringMask   strings;
+  uint64_t        prev_scalar = 0;
+
+  for( int64_t base = 0; base < length; base += 64 )
+  {
+    int64_t count = out - m_Positions;
+    if( m_Capacity - count < 65 )
+    {
+      Grow( count );
+      out = m_Positions + count;
+    }
+
+    JsnBlock block;
+    int64_t remaining = length - base;
+    if( remaining >= 64 )
+    {
+      JsnClassifyBlock( p + base, &block );
+    }
+    else
+    {
+      JsnClassifyPartialBlock( p + base, ( int )remaining, &block );
+    }
+
+    uint64_t quotes;
+    uint64_t in_string = strings.Next( block, &quotes );
+
+    // Numbers and literals are runs of anything else outside strings. Only the first byte of each run
+    // is indexed.
+    uint64_t scalar = ~( block.m_Structural | block.m_Whitespace | block.m_Quote | in_string );
+    uint64_t scalar_start = scalar & ~( ( scalar << 1 ) | prev_scalar );
+    prev_scalar = scalar >> 63;
+
+    out = WritePositions( out, ( uint64_t )base, ( block.m_Structural & ~in_string ) | quotes | scalar_start );
+  }
+
+  m_Count = out - m_Positions;
+  m_Positions[ m_Count ] = ( uint64_t )length;
+
+  if( strings.m_PrevInString )
+  {
+    m_Error = "Unterminated string";
+    return false;
+  }
+  return true;
+}
+
+/****************************************************************************************************************/
+
+// Grow an array of int64_t, keeping the first count entries
+static int64_t* GrowArray( int64_t* array, int64_t count, int64_t* capacity )
+{
+  *capacity = *capacity ? *capacity * 2 : 64;
+  int64_t* grown = new int64_t[ *capacity ];
+  if( count )
+  {
+    memcpy( grown, array, count * sizeof( int64_t ) );
+  }
+  delete[] array;
+  return grown;
+}
+
+// Match brackets and quotes, and find the top level values. Each entry of chars is the character at the
+// position with the same index. The escaped bits are already set.
+bool JsnIndex::Link( const char* chars )
+{
+  int64_t count = m_Count;
+  m_Links = new int64_t[ count + 1 ];
+
+  int64_t* stack = NULL;              // Position indices of the open brackets
+  int64_t  depth = 0;
+  int64_t  stack_capacity = 0;
+  int64_t  element_capacity = 0;
+  bool     root_is_array = count && chars[ 0 ] == '[';
+
+  for( int64_t i = 0; i < count && !m_Error; ++i )
+  {
+    m_Links[ i ] = 0;
+    char c = chars[ i ];
+    if( c == '}' || c == ']' )
+    {
+      if( !depth || chars[ stack[ depth - 1 ] ] != ( c == '}' ? '{' : '[' ) )
+      {
+        m_Error = "Mismatched brackets";
+        break;
+      }
+      int64_t open = stack[ --depth ];
+      m_Links[ open ] = i;
+      m_Links[ i ] = open;
+      continue;
+    }
+    if( c == ',' || c == ':' )
+    {
+      continue;
+    }
+
+    // A value starts here, or a name. Values directly inside the root are the top level values.
+    if( depth == 1 && ( root_is_array ? chars[ i - 1 ] == '[' || chars[ i - 1 ] == ',' : chars[ i - 1 ] == ':' ) )
+    {
+      if( m_ElementCount == element_capacity )
+      {
+        m_Elements = GrowArray( m_Elements, m_ElementCount, &element_capacity );
+      }
+      m_Elements[ m_ElementCount++ ] = i;
+    }
+    if( c == '{' || c == '[' )
+    {
+      if( depth == stack_capacity )
+      {
+        stack = GrowArray( stack, depth, &stack_capacity );
+      }
+      stack[ depth++ ] = i;
+    }
+    else if( c == '"' && i + 1 < count )
+    {
+      // The closing quote is always the next position
+      m_Links[ i ] = i + 1;
+      m_Links[ i + 1 ] = i;
+      i += 1;
+    }
+  }
+  delete[] stack;
+
+  if( !m_Error && depth )
+  {
+    m_Error = "Mismatched brackets";
+  }
+  if( m_Error )
+  {
+    ClearLinks();
+    return false;
+  }
+  return true;
+}
+
+bool JsnIndex::BuildLinks( const char* text )
+{
+  ClearLinks();
+  if( m_Error )
+  {
+    return false;
+  }
+
+  int64_t count = m_Count;
+  char* chars = new char[ count + 1 ];
+  m_EscapedBits = new uint64_t[ count / 64 + 1 ];
+  memset( m_EscapedBits, 0, ( count / 64 + 1 ) * sizeof( uint64_t ) );
+  for( int64_t i = 0; i < count; ++i )
+  {
+    chars[ i ] = text[ m_Positions[ i ] ];
+    if( chars[ i ] == '"' && i + 1 < count )
+    {
+      const char* begin = text + m_Positions[ i ] + 1;
+      if( memchr( begin, '\\', ( size_t )( text + m_Positions[ i + 1 ] - begin ) ) )
+      {
+        m_EscapedBits[ i >> 6 ] |= 1ULL << ( i & 63 );
+      }
+      chars[ i + 1 ] = '"';
+      i += 1;
+    }
+  }
+  bool ok = Link( chars );
+  delete[] chars;
+  return ok;
+}
+
+/****************************************************************************************************************/
+
+int64_t JsnIndex::GetElement( int64_t n ) const
+{
+  return n >= 0 && n < m_ElementCount ? ( int64_t )m_Positions[ m_Elements[ n ] ] : -1;
+}
+
+// Return the position index after the value at position index i
+int64_t JsnIndex::SkipValue( int64_t i ) const
+{
+  return m_Links[ i ] > i ? m_Links[ i ] + 1 : i + 1;
+}
+
+// Return the character at position index i, or zero past the last position
+static char CharAt( const char* text, const uint64_t* positions, int64_t count, int64_t i )
+{
+  return i < count ? text[ positions[ i ] ] : 0;
+}
+
+// Compare the string at position index i with a decoded name
+static bool IsName( const char* text, const uint64_t* positions, const uint64_t* escaped_bits, int64_t i,
+                    const char* name, int64_t name_length )
+{
+  const char* begin = text + positions[ i ] + 1;
+  int64_t length = ( int64_t )( text + positions[ i + 1 ] - begin );
+  if( !( ( escaped_bits[ i >> 6 ] >> ( i & 63 ) ) & 1 ) )
+  {
+    return length == name_length && !memcmp( begin, name, ( size_t )length );
+  }
+  if( length < name_length )
+  {
+    return false;
+  }
+  char  small[ 256 ];
+  char* buf = length <= ( int64_t )sizeof( small ) ? small : new char[ length ];
+  memcpy( buf, begin, ( size_t )length );
+  length = JsnUnescapeInPlace( buf, length );
+  bool same = length == name_length && !memcmp( buf, name, ( size_t )length );
+  if( buf != small )
+  {
+    delete[] buf;
+  }
+  return same;
+}
+
+int64_t JsnIndex::Find( const char* text, const char* pointer ) const
+{
+  if( !m_Links || !m_Count || !pointer )
+  {
+    return -1;
+  }
+
+  // Decoded segments are never longer than the pointer
+  char* segment = new char[ strlen( pointer ) + 1 ];
+  int64_t i = 0;
+  const char* p = pointer;
+  while( i >= 0 && *p == '/' )
+  {
+    int64_t length = 0;
+    for( p += 1; *p && *p != '/'; ++p )
+    {
+      char c = *p;
+      if( c == '~' && ( p[ 1 ] == '0' || p[ 1 ] == '1' ) )
+      {
+        c = *++p == '0' ? '~' : '/';
+      }
+      segment[ length++ ] = c;
+    }
+
+    char c = CharAt( text, m_Positions, m_Count, i );
+    if( c == '[' )
+    {
+      // Only plain decimal numbers select an element
+      int64_t n = 0;
+      bool is_number = length > 0 && ( length == 1 || segment[ 0 ] != '0' );
+      for( int64_t k = 0; k < length && is_number; ++k )
+      {
+        is_number = segment[ k ] >= '0' && segment[ k ] <= '9' && n < ( INT64_MAX - 9 ) / 10;
+        n = n * 10 + ( segment[ k ] - '0' );
+      }
+      if( !is_number )
+      {
+        i = -1;
+      }
+      else if( i == 0 )
+      {
+        i = n < m_ElementCount ? m_Elements[ n ] : -1;
+      }
+      else
+      {
+        int64_t j = i + 1;
+        for( ; n > 0 && CharAt( text, m_Positions, m_Count, j ) != ']' && j < m_Count; --n )
+        {
+          j = SkipValue( j );
+          j += CharAt( text, m_Positions, m_Count, j ) == ',';
+        }
+        c = CharAt( text, m_Positions, m_Count, j );
+        i = c && c != ']' && c != ',' ? j : -1;
+      }
+    }
+    else if( c == '{' )
+    {
+      int64_t j = i + 1;
+      i = -1;
+      while( CharAt( text, m_Positions, m_Count, j ) == '"' && j + 3 < m_Count )
+      {
+        if( IsName( text, m_Positions, m_EscapedBits, j, segment, length ) )
+        {
+          i = j + 3; // Past the quotes and the colon
+          break;
+        }
+        j = SkipValue( j + 3 );
+        j += CharAt( text, m_Positions, m_Count, j ) == ',';
+      }
+    }
+    else
+    {
+      i = -1;
+    }
+  }
+  delete[] segment;
+  return i >= 0 && !*p ? ( int64_t )m_Positions[ i ] : -1;
+}
+
+/****************************************************************************************************************/
+
+namespace
+{
+  // Start of an index file. Then follow the positions, as 32-bit distances from the previous position,
+  // or as they are if any distance is larger. Links are not stored, but the character at each position
+  // is, and the escaped bits. Load() links them again, which is much faster than looking in the text.
+  struct FileHeader
+  {
+    char     m_Magic[ 8 ];
+    uint32_t m_Version;     // Also tells apart machines with a different byte order
+    uint32_t m_Flags;
+    uint64_t m_TextLength;
+    uint64_t m_TextHash;
+    int64_t  m_Count;
+  };
+
+  enum
+  {
+    kFile_Links         = 1 << 0,
+    kFile_WidePositions = 1 << 1
+  };
+
+  const char      kFileMagic[ 8 ] = { 'J', 's', 'n', 'I', 'n', 'd', 'e', 'x' };
+  const uint32_t  kFileVersion = 1;
+  const int64_t   kFileChunk = 16384;   // Entries converted at a time
+}
+
+static inline uint64_t Rotate( uint64_t x, int bits )
+{
+  return ( x << bits ) | ( x >> ( 64 - bits ) );
+}
+
+// Hash the text, to recognize it again. Four independent lanes keep the loop going at memory speed.
+static uint64_t HashText( const char* text, int64_t length )
+{
+  const uint64_t k1 = 0x9E3779B97F4A7C15ULL;
+  const uint64_t k2 = 0xC2B2AE3D27D4EB4FULL;
+  uint64_t lanes[ 4 ] = { k1, k2, k1 ^ k2, k1 + k2 };
+  int64_t i = 0;
+  for( ; i + 32 <= length; i += 32 )
+  {
+    for( int lane = 0; lane < 4; ++lane )
+    {
+      uint64_t v;
+      memcpy( &v, text + i + 8 * lane, sizeof( v ) );
+      lanes[ lane ] = Rotate( lanes[ lane ] + v * k2, 31 ) * k1;
+    }
+  }
+  uint64_t tail[ 4 ] = { 0, 0, 0, 0 };
+  memcpy( tail, text + i, ( size_t )( length - i ) );
+  uint64_t hash = ( uint64_t )length;
+  for( int lane = 0; lane < 4; ++lane )
+  {
+    lanes[ lane ] = Rotate( lanes[ lane ] + tail[ lane ] * k2, 31 ) * k1;
+    hash = Rotate( hash ^ lanes[ lane ], 27 ) * k1 + k2;
+  }
+  hash ^= hash >> 33;
+  hash *= k2;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+bool JsnIndex::Save( const char* path, const char* text, int64_t length )
+{
+  int64_t count = m_Count;
+  bool wide = false;
+  for( int64_t i = 1; i < count && !wide; ++i )
+  {
+    wide = m_Positions[ i ] - m_Positions[ i - 1 ] > 0xFFFFFFFF;
+  }
+  wide = wide || ( count && m_Positions[ 0 ] > 0xFFFFFFFF );
+
+  FileHeader header;
+  memcpy( header.m_Magic, kFileMagic, sizeof( header.m_Magic ) );
+  header.m_Version = kFileVersion;
+  header.m_Flags = ( m_Links ? kFile_Links : 0 ) | ( wide ? kFile_WidePositions : 0 );
+  header.m_TextLength = ( uint64_t )length;
+  header.m_TextHash = HashText( text, length );
+  header.m_Count = count;
+
+  FILE* file = fopen( path, "wb" );
+  if( !file )
+  {
+    m_Error = "Cannot open index file";
+    return false;
+  }
+  bool ok = fwrite( &header, sizeof( header ), 1, file ) == 1;
+  if( wide )
+  {
+    ok = ok && fwrite( m_Positions, sizeof( uint64_t ), ( size_t )count, file ) == ( size_t )count;
+  }
+  else
+  {
+    uint32_t distances[ kFileChunk ];
+    for( int64_t begin = 0; begin < count && ok; begin += kFileChunk )
+    {
+      int64_t end = begin + kFileChunk < count ? begin + kFileChunk : count;
+      for( int64_t i = begin; i < end; ++i )
+      {
+        distances[ i - begin ] = ( uint32_t )( m_Positions[ i ] - ( i ? m_Positions[ i - 1 ] : 0 ) );
+      }
+      ok = fwrite( distances, sizeof( uint32_t ), ( size_t )( end - begin ), file ) == ( size_t )( end - begin );
+    }
+  }
+  if( m_Links )
+  {
+    char chars[ kFileChunk ];
+    for( int64_t begin = 0; begin < count && ok; begin += kFileChunk )
+    {
+      int64_t end = begin + kFileChunk < count ? begin + kFileChunk : count;
+      for( int64_t i = begin; i < end; ++i )
+      {
+        chars[ i - begin ] = text[ m_Positions[ i ] ];
+      }
+      ok = fwrite( chars, 1, ( size_t )( end - begin ), file ) == ( size_t )( end - begin );
+    }
+    size_t words = ( size_t )count / 64 + 1;
+    ok = ok && fwrite( m_EscapedBits, sizeof( uint64_t ), words, file ) == words;
+  }
+  ok = fclose( file ) == 0 && ok;
+  if( !ok )
+  {
+    m_Error = "Cannot write index file";
+  }
+  return ok;
+}
+
+// Read the positions written by Save(), and check that they can not lead the parser outside the text
+static bool ReadPositions( FILE* file, uint64_t* positions, int64_t count, bool wide, uint64_t length )
+{
+  if( wide )
+  {
+    if( fread( positions, sizeof( uint64_t ), ( size_t )count, file ) != ( size_t )count )
+    {
+      return false;
+    }
+    for( int64_t i = 1; i < count; ++i )
+    {
+      if( positions[ i ] <= positions[ i - 1 ] )
+      {
+        return false;
+      }
+    }
+  }
+  else
+  {
+    uint32_t distances[ kFileChunk ];
+    uint64_t position = 0;
+    for( int64_t begin = 0; begin < count; begin += kFileChunk )
+    {
+      int64_t end = begin + kFileChunk < count ? begin + kFileChunk : count;
+      if( fread( distances, sizeof( uint32_t ), ( size_t )( end - begin ), file ) != ( size_t )( end - begin ) )
+      {
+        return false;
+      }
+      for( int64_t i = begin; i < end; ++i )
+      {
+        uint32_t distance = distances[ i - begin ];
+        if( !distance && i )
+        {
+          return false;
+        }
+        position += distance;
+        positions[ i ] = position;
+      }
+    }
+  }
+  positions[ count ] = length;
+  return !count || positions[ count - 1 ] < length;
+}
+
+bool JsnIndex::Load( const char* path, const char* text, int64_t length )
+{
+  m_Count = 0;
+  m_Error = NULL;
+  ClearLinks();
+
+  FILE* file = fopen( path, "rb" );
+  if( !file )
+  {
+    m_Error = "Cannot open index file";
+    return false;
+  }
+
+  FileHeader header;
+  if( fread( &header, sizeof( header ), 1, file ) != 1 ||
+      memcmp( header.m_Magic, kFileMagic, sizeof( header.m_Magic ) ) || header.m_Version != kFileVersion ||
+      header.m_Count < 0 || header.m_Count > length )
+  {
+    m_Error = "Not an index file";
+  }
+  else if( header.m_TextLength != ( uint64_t )length || header.m_TextHash != HashText( text, length ) )
+  {
+    m_Error = "Index file does not match the text";
+  }
+  else
+  {
+    int64_t count = header.m_Count;
+    if( m_Capacity < count + 1 )
+    {
+      delete[] m_Positions;
+      m_Capacity = count + 1;
+      m_Positions = new uint64_t[ m_Capacity ];
+    }
+    if( !ReadPositions( file, m_Positions, count, ( header.m_Flags & kFile_WidePositions ) != 0, length ) )
+    {
+      m_Error = "Cannot read index file";
+    }
+    else if( header.m_Flags & kFile_Links )
+    {
+      m_Count = count;
+      size_t words = ( size_t )count / 64 + 1;
+      char* chars = new char[ count + 1 ];
+      m_EscapedBits = new uint64_t[ words ];
+      if( fread( chars, 1, ( size_t )count, file ) != ( size_t )count ||
+          fread( m_EscapedBits, sizeof( uint64_t ), words, file ) != words )
+      {
+        m_Error = "Cannot read index file";
+      }
+      else
+      {
+        Link( chars );
+      }
+      delete[] chars;
+    }
+    else
+    {
+      m_Count = count;
+    }
+  }
+  fclose( file );
+
+  if( m_Error )
+  {
+    m_Count = 0;
+    ClearLinks();
+    return false;
+  }
+  return true;
+}
+
+/****************************************************************************************************************/
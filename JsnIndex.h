@@ -0,0 +1,183 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \class JsnIndex
+ Structural index of a JSON text. The index holds the position of every structural character ('{', '}',
+ '[', ']', ':' and ','), of the opening and closing quote of every string, and of the first character of
+ every number or literal. It is built in a single pass that classifies the text 64 bytes at a time, using
+ AVX2 or SSE2 when the compiler targets it, and plain C++ otherwise.
+
+ Pass the index to JsnParse() to let the parser step from position to position: it never reads whitespace
+ or string contents, and it only moves the stream at the end. The index refers to the text it was built
+ from, by position, so it must be used with a JsnStreamIn over the same text.
+
+ Building the index and then parsing with it is faster than the plain parse on text with strings of any
+ length, and slower on text that is mostly numbers, because numbers are still decoded one by one. It pays
+ off most when the same text is parsed more than once, or when Find() or a path filter lets the parser skip
+ most of it. The "index/build" and "parse/indexed" benchmarks measure both steps.
+
+ BuildLinks() adds what is needed to find a value without parsing the text before it: the matching
+ bracket of every bracket, the top level values, and which strings contain escape sequences. Save() and
+ Load() keep the index in a file next to the text, so that a large document that does not change is
+ scanned only once.
+
+ \code
+ JsnIndex index;
+ if( !index.Load( "export.json.jsni", file.GetData(), file.GetSize() ) )
+ {
+   index.Build( file.GetData(), file.GetSize() );
+   index.BuildLinks( file.GetData() );
+   index.Save( "export.json.jsni", file.GetData(), file.GetSize() );
+ }
+ JsnStreamIn stream = file.GetStream();
+ stream.Seek( index.Find( file.GetData(), "/items/1000" ) );
+ JsnParseOptions options;
+ options.m_Index = &index;
+ JsnParse( &handler, &stream, options );
+ \endcode
+ */
+class JsnIndex
+{
+public:
+
+  JsnIndex();
+  ~JsnIndex();
+
+  /**
+   Build the index. Memory allocated by a previous Build() is reused if it is large enough.
+   \param[ in ] text Start of text, not necessarily zero terminated.
+   \param[ in ] length Length of text.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Build( const char* text, int64_t length );
+
+  /**
+   Return error string.
+   \return Error string, or NULL if no error.
+   */
+  const char* GetError() const { return m_Error; }
+
+  /**
+   Return number of positions in the index.
+   \return Number of positions. The position array holds one more entry, equal to the text length.
+   */
+  int64_t GetCount() const { return m_Count; }
+
+  /**
+   Return the positions, in ascending order.
+   \return Array of GetCount() + 1 positions.
+   */
+  const uint64_t* GetPositions() const { return m_Positions; }
+
+  /**
+   Find the matching bracket of every bracket, the top level values, and the strings that contain escape
+   sequences. Call after Build(), with the same text. Needed for GetElementCount(), GetElement() and
+   Find(). The parser uses the escape flags as well.
+   \param[ in ] text Start of text.
+   \return true if successful, false if the brackets do not match. Call GetError() for details.
+   */
+  bool BuildLinks( const char* text );
+
+  /**
+   Return whether BuildLinks() was called, or the links were loaded.
+   \return true if links are available.
+   */
+  bool HasLinks() const { return m_Links != 0; }
+
+  /**
+   Return one bit per position, set for the opening quote of every string that contains an escape
+   sequence.
+   \return Array of ( GetCount() + 63 ) / 64 words, or NULL without links.
+   */
+  const uint64_t* GetEscapedBits() const { return m_EscapedBits; }
+
+  /**
+   Return the number of top level values: the elements of an array, or the property values of an object.
+   \return Number of values. Zero if the text is not an object or array, or without links.
+   */
+  int64_t GetElementCount() const { return m_ElementCount; }
+
+  /**
+   Return where a top level value starts.
+   \param[ in ] n Index of the value, as counted by GetElementCount().
+   \return Text offset of the value, or -1 if there is no such value.
+   */
+  int64_t GetElement( int64_t n ) const;
+
+  /**
+   Find a value by its JSON Pointer, such as "/items/1000/name". Segments are separated by '/', "~0"
+   stands for '~' and "~1" for '/'. Only objects and arrays on the way are looked at, and the values
+   before the one that is wanted are skipped without parsing them. Needs links.
+   \param[ in ] text Start of text the index was built from.
+   \param[ in ] pointer Zero terminated JSON Pointer. The empty pointer "" is the whole document.
+   \return Text offset of the value, or -1 if it does not exist.
+   */
+  int64_t Find( const char* text, const char* pointer ) const;
+
+  /**
+   Write the index, with its links if it has them, to a file. The file records the length and a hash of
+   the text, so that Load() can tell whether it still belongs to the text.
+   \param[ in ] path Path of the file.
+   \param[ in ] text Start of text the index was built from.
+   \param[ in ] length Length of text.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Save( const char* path, const char* text, int64_t length );
+
+  /**
+   Read an index written by Save(). Hashing the text takes a fraction of the time that Build() takes.
+   \param[ in ] path Path of the file.
+   \param[ in ] text Start of text.
+   \param[ in ] length Length of text.
+   \return true if successful. false if the file can not be read, or was saved for another text. Call
+   GetError() for details. The index can then not be used until it is built.
+   */
+  bool Load( const char* path, const char* text, int64_t length );
+
+private:
+
+  uint64_t*   m_Positions;
+  int64_t     m_Count;
+  int64_t     m_Capacity;
+  int64_t*    m_Links;        // Per position: index of the matching bracket or quote, zero for scalars
+  uint64_t*   m_EscapedBits;  // Per position: set for the opening quote of a string with escapes
+  int64_t*    m_Elements;     // Position indices of the top level values
+  int64_t     m_ElementCount;
+  const char* m_Error;
+
+  void Grow( int64_t count );
+  void ClearLinks();
+  bool Link( const char* chars );
+  int64_t SkipValue( int64_t i ) const;
+
+  JsnIndex( const JsnIndex& other );
+  JsnIndex& operator=( const JsnIndex& other );
+};
+
+/****************************************************************************************************************/
@@ -0,0 +1,139 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnKeys.h"
+#include "JsnReserve.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/****************************************************************************************************************/
+
+JsnKeyDictionary::JsnKeyDictionary()
+: m_Text( NULL )
+, m_TextSize( 0 )
+, m_TextCapacity( 0 )
+, m_Keys( NULL )
+, m_KeyCount( 0 )
+, m_KeyCapacity( 0 )
+, m_Slots( NULL )
+, m_SlotMask( 0 )
+{}
+
+JsnKeyDictionary::~JsnKeyDictionary()
+{
+  delete[] m_Text;
+  delete[] m_Keys;
+  delete[] m_Slots;
+}
+
+void JsnKeyDictionary::Clear()
+{
+  m_TextSize = 0;
+  m_KeyCount = 0;
+  if( m_Slots )
+  {
+    memset( m_Slots, 0xFF, ( m_SlotMask + 1 ) * sizeof( int ) );
+  }
+}
+
+void JsnKeyDictionary::Rehash( int slot_count )
+{
+  delete[] m_Slots;
+  m_Slots = new int[ slot_count ];
+  m_SlotMask = slot_count - 1;
+  memset( m_Slots, 0xFF, slot_count * sizeof( int ) );
+  for( int id = 0; id < m_KeyCount; ++id )
+  {
+    uint32_t slot = m_Keys[ id ].m_Hash & m_SlotMask;
+    while( m_Slots[ slot ] >= 0 )
+    {
+      slot = ( slot + 1 ) & m_SlotMask;
+    }
+    m_Slots[ slot ] = id;
+  }
+}
+
+int JsnKeyDictionary::Find( uint32_t hash, const char* name, int64_t length ) const
+{
+  if( !m_Slots )
+  {
+    return -1;
+  }
+  for( uint32_t slot = hash & m_SlotMask; m_Slots[ slot ] >= 0; slot = ( slot + 1 ) & m_SlotMask )
+  {
+    const Key& key = m_Keys[ m_Slots[ slot ] ];
+    if( key.m_Hash == hash && key.m_Length == length && memcmp( m_Text + key.m_Offset, name, ( size_t )length ) == 0 )
+    {
+      return m_Slots[ slot ];
+    }
+  }
+  return -1;
+}
+
+int JsnKeyDictionary::Add( const char* name, int64_t length )
+{
+  uint32_t hash = JsnHashKey( name, length );
+  int id = Find( hash, name, length );
+  if( id >= 0 )
+  {
+    return id;
+  }
+
+  JsnReserve( &m_Text, m_TextSize, &m_TextCapacity, m_TextSize + length );
+  memcpy( m_Text + m_TextSize, name, ( size_t )length );
+  JsnReserve( &m_Keys, m_KeyCount, &m_KeyCapacity, m_KeyCount + 1 );
+  id = m_KeyCount++;
+  m_Keys[ id ].m_Offset = m_TextSize;
+  m_Keys[ id ].m_Length = length;
+  m_Keys[ id ].m_Hash = hash;
+  m_TextSize += length;
+
+  // Keep the table at most half full, so that a miss ends at an empty slot soon
+  if( m_KeyCount * 2 > m_SlotMask + 1 || !m_Slots )
+  {
+    Rehash( m_Slots ? ( m_SlotMask + 1 ) * 2 : 16 );
+  }
+  else
+  {
+    uint32_t slot = hash & m_SlotMask;
+    while( m_Slots[ slot ] >= 0 )
+    {
+      slot = ( slot + 1 ) & m_SlotMask;
+    }
+    m_Slots[ slot ] = id;
+  }
+  return id;
+}
+
+void JsnKeyDictionary::Add( const char* const* names, int count )
+{
+  for( int i = 0; i < count; ++i )
+  {
+    Add( names[ i ], ( int64_t )strlen( names[ i ] ) );
+  }
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,162 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/************************************************************************************************************/ /**
+ Hash a property name. This is the hash that the parser stores with names when JsnParseOptions::m_HashKeys
+ is set. It is fast rather than strong, and depends on the byte order of the machine, so do not store it.
+ \param[ in ] text Decoded name, not necessarily zero terminated.
+ \param[ in ] length Length of name.
+ \return Hash.
+ */
+inline uint32_t JsnHashKey( const char* text, int64_t length )
+{
+  const uint64_t k = 0x9E3779B97F4A7C15ULL;
+  uint64_t h = ( uint64_t )length * k;
+  for( ; length >= 8; text += 8, length -= 8 )
+  {
+    uint64_t v;
+    memcpy( &v, text, sizeof( v ) );
+    h = ( h ^ v ) * k;
+    h ^= h >> 32;
+  }
+  if( length > 0 )
+  {
+    uint64_t v = 0;
+    memcpy( &v, text, ( size_t )length );
+    h = ( h ^ v ) * k;
+  }
+  h ^= h >> 29;
+  h *= k;
+  return ( uint32_t )( h >> 32 );
+}
+
+/************************************************************************************************************/ /**
+ \class JsnKeyDictionary
+ A set of property names, each with a small integer ID. Pass it to JsnParse() or JsnReader with
+ JsnParseOptions::m_Keys, and names that are in the dictionary arrive with their ID. A handler can then
+ switch on JsnFragment::GetKeyId(), rather than comparing strings.
+
+ IDs are handed out from zero, in the order the names are added, so they can match an enum:
+ \code
+ enum { kKey_Id, kKey_Name, kKey_Tags };
+ static const char* key_names[] = { "id", "name", "tags" };
+
+ JsnKeyDictionary keys;
+ keys.Add( key_names, 3 );
+ JsnParseOptions options;
+ options.m_Keys = &keys;
+ JsnParse( &handler, &stream, options );
+
+ void Handler::AddProperty( const JsnFragment& name, const JsnFragment& value )
+ {
+   switch( name.GetKeyId() )
+   {
+     case kKey_Id:   m_Id = value.AsInt(); break;
+     case kKey_Name: ...
+   }
+ }
+ \endcode
+
+ Finding a name does not change the dictionary, so one dictionary can serve several threads at once.
+ */
+class JsnKeyDictionary
+{
+public:
+
+  JsnKeyDictionary();
+  ~JsnKeyDictionary();
+
+  /**
+   Add a name.
+   \param[ in ] name Name, decoded. Not necessarily zero terminated.
+   \param[ in ] length Length of name.
+   \return ID of the name. A name that was added before keeps its first ID.
+   */
+  int Add( const char* name, int64_t length );
+
+  /**
+   Add names. The first new name gets the ID after the last one added before.
+   \param[ in ] names Array of zero terminated names.
+   \param[ in ] count Number of names.
+   */
+  void Add( const char* const* names, int count );
+
+  /**
+   Find a name.
+   \param[ in ] hash JsnHashKey() of the name.
+   \param[ in ] name Name, decoded. Not necessarily zero terminated.
+   \param[ in ] length Length of name.
+   \return ID of the name, or -1 if the dictionary does not have it.
+   */
+  int Find( uint32_t hash, const char* name, int64_t length ) const;
+
+  /**
+   Find a name.
+   \param[ in ] name Name, decoded. Not necessarily zero terminated.
+   \param[ in ] length Length of name.
+   \return ID of the name, or -1 if the dictionary does not have it.
+   */
+  int Find( const char* name, int64_t length ) const { return Find( JsnHashKey( name, length ), name, length ); }
+
+  /**
+   Return the number of names.
+   \return Number of names. IDs run from zero to one less than this.
+   */
+  int GetCount() const { return m_KeyCount; }
+
+  /**
+   Remove all names.
+   */
+  void Clear();
+
+private:
+
+  struct Key
+  {
+    int64_t   m_Offset;   // Name in m_Text
+    int64_t   m_Length;
+    uint32_t  m_Hash;
+  };
+
+  char*       m_Text;
+  int64_t     m_TextSize;
+  int64_t     m_TextCapacity;
+  Key*        m_Keys;
+  int         m_KeyCount;
+  int         m_KeyCapacity;
+  int*        m_Slots;      // Open addressing on the hash: ID of the key, or -1 for an empty slot
+  int         m_SlotMask;
+
+  void        Rehash( int slot_count );
+
+  JsnKeyDictionary( const JsnKeyDictionary& other );
+  JsnKeyDictionary& operator=( const JsnKeyDictionary& other );
+};
+
+/****************************************************************************************************************/
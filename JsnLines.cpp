@@ -0,0 +1,320 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnLines.h"
+#include "JsnDocument.h"
+#include "JsnWorkers.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/****************************************************************************************************************/
+
+namespace
+{
+  struct LinesContext
+  {
+    JsnLineHandler*         m_Handler;
+    const char*             m_Text;
+    int64_t                 m_Length;
+    int64_t                 m_ChunkSize;
+    int64_t                 m_ChunkCount;
+    int64_t*                m_LineCounts;   // Number of line ends before each chunk's nominal start
+    JsnParseOptions         m_ParseOptions;
+    JsnStats*               m_WorkerStats;  // Statistics of each worker, or NULL
+    bool                    m_Ordered;
+    std::atomic< int64_t >  m_NextChunk;    // Next chunk to be taken by a worker
+    std::atomic< bool >     m_Failed;
+    std::mutex              m_Mutex;
+    std::condition_variable m_Turn;
+    int64_t                 m_Delivered;    // Chunks passed on to the handler so far, in ordered mode
+  };
+
+  struct LineRecord
+  {
+    int64_t     m_Line;
+    int64_t     m_Root;                     // Tape index of the value, or -1 if there is none
+    const char* m_Error;
+  };
+}
+
+/****************************************************************************************************************/
+
+// Chunk k starts at the first line that starts at or after its nominal start, k * chunk size.
+static int64_t ChunkStart( const LinesContext* context, int64_t chunk )
+{
+  if( chunk == 0 )
+  {
+    return 0;
+  }
+  int64_t position = chunk * context->m_ChunkSize;
+  if( chunk >= context->m_ChunkCount || position >= context->m_Length )
+  {
+    return context->m_Length;
+  }
+  const char* end = ( const char* )memchr( context->m_Text + position, '\n', context->m_Length - position );
+  return end ? end - context->m_Text + 1 : context->m_Length;
+}
+
+static int64_t ChunkFirstLine( const LinesContext* context, int64_t chunk )
+{
+  // The line end found by ChunkStart() is the first one after the nominal start
+  return chunk == 0 ? 1 : context->m_LineCounts[ chunk ] + 2;
+}
+
+static bool IsBlank( const char* p, const char* end )
+{
+  while( p < end && ( uint8_t )*p <= ' ' )
+  {
+    p += 1;
+  }
+  return p == end;
+}
+
+// Check that nothing but whitespace follows the value.
+static const char* CheckLineEnd( JsnStreamIn* stream )
+{
+  const char* p = stream->GetCurrent();
+  return IsBlank( p, p + stream->GetRemaining() ) ? NULL : "Unexpected character after value";
+}
+
+/****************************************************************************************************************/
+
+static void CountLines( LinesContext* context )
+{
+  int64_t chunk;
+  while( ( chunk = context->m_NextChunk++ ) < context->m_ChunkCount )
+  {
+    const char* p = context->m_Text + chunk * context->m_ChunkSize;
+    const char* end = context->m_Text + context->m_Length;
+    if( end - p > context->m_ChunkSize )
+    {
+      end = p + context->m_ChunkSize;
+    }
+    int64_t count = 0;
+    while( ( p = ( const char* )memchr( p, '\n', end - p ) ) != NULL )
+    {
+      count += 1;
+      p += 1;
+    }
+    context->m_LineCounts[ chunk + 1 ] = count;
+  }
+}
+
+/****************************************************************************************************************/
+
+static void ParseUnordered( LinesContext* context, int worker )
+{
+  JsnParseOptions options = JsnWorkerOptions( context, worker );
+  int64_t chunk;
+  while( ( chunk = context->m_NextChunk++ ) < context->m_ChunkCount )
+  {
+    const char* p = context->m_Text + ChunkStart( context, chunk );
+    const char* end = context->m_Text + ChunkStart( context, chunk + 1 );
+    for( int64_t line = ChunkFirstLine( context, chunk ); p < end; ++line )
+    {
+      const char* line_end = ( const char* )memchr( p, '\n', end - p );
+      if( !line_end )
+      {
+        line_end = end;
+      }
+      if( !IsBlank( p, line_end ) )
+      {
+        JsnHandler* handler = context->m_Handler->BeginLine( worker, line );
+        if( handler )
+        {
+          JsnStreamIn stream( p, line_end );
+          const char* error = JsnParse( handler, &stream, options ) ? CheckLineEnd( &stream ) : stream.GetError();
+          if( error )
+          {
+            context->m_Failed = true;
+          }
+          context->m_Handler->EndLine( worker, line, handler, error );
+        }
+      }
+      p = line_end + 1;
+    }
+  }
+}
+
+/****************************************************************************************************************/
+
+static void ParseOrdered( LinesContext* context, int worker )
+{
+  JsnParseOptions options = JsnWorkerOptions( context, worker );
+  JsnDocument document;
+  LineRecord* records = NULL;
+  int64_t record_capacity = 0;
+
+  int64_t chunk;
+  while( ( chunk = context->m_NextChunk++ ) < context->m_ChunkCount )
+  {
+    // Parse the whole chunk into the document. Streams span the whole text, so that the document can
+    // refer to the strings of all lines by offset.
+    int64_t record_count = 0;
+    int64_t begin = ChunkStart( context, chunk );
+    int64_t end = ChunkStart( context, chunk + 1 );
+    const char* p = context->m_Text + begin;
+    for( int64_t line = ChunkFirstLine( context, chunk ); p < context->m_Text + end; ++line )
+    {
+      const char* line_end = ( const char* )memchr( p, '\n', context->m_Text + end - p );
+      if( !line_end )
+      {
+        line_end = context->m_Text + end;
+      }
+      if( !IsBlank( p, line_end ) )
+      {
+        if( record_count == record_capacity )
+        {
+          record_capacity = record_capacity ? record_capacity * 2 : 256;
+          LineRecord* new_records = new LineRecord[ record_capacity ];
+          if( record_count )
+          {
+            memcpy( new_records, records, record_count * sizeof( LineRecord ) );
+          }
+          delete[] records;
+          records = new_records;
+        }
+        LineRecord& record = records[ record_count++ ];
+        JsnStreamIn stream( context->m_Text, line_end );
+        stream.Seek( p - context->m_Text );
+        record.m_Line = line;
+        record.m_Root = document.GetCount();
+        if( document.Append( &stream, options ) )
+        {
+          record.m_Error = CheckLineEnd( &stream );
+        }
+        else
+        {
+          record.m_Root = -1;
+          record.m_Error = stream.GetError();
+        }
+      }
+      p = line_end + 1;
+    }
+
+    // Wait until all chunks before this one have been passed on
+    {
+      std::unique_lock< std::mutex > lock( context->m_Mutex );
+      while( context->m_Delivered != chunk )
+      {
+        context->m_Turn.wait( lock );
+      }
+    }
+
+    for( int64_t i = 0; i < record_count; ++i )
+    {
+      const LineRecord& record = records[ i ];
+      JsnHandler* handler = context->m_Handler->BeginLine( worker, record.m_Line );
+      if( handler )
+      {
+        if( record.m_Root >= 0 )
+        {
+          document.Write( handler, record.m_Root );
+        }
+        if( record.m_Error )
+        {
+          context->m_Failed = true;
+        }
+        context->m_Handler->EndLine( worker, record.m_Line, handler, record.m_Error );
+      }
+    }
+    document.Clear();
+
+    {
+      std::lock_guard< std::mutex > lock( context->m_Mutex );
+      context->m_Delivered = chunk + 1;
+    }
+    context->m_Turn.notify_all();
+  }
+
+  delete[] records;
+}
+
+/****************************************************************************************************************/
+
+static void CountWork( LinesContext* context, int )
+{
+  CountLines( context );
+}
+
+/****************************************************************************************************************/
+
+bool JsnParseLines( JsnLineHandler* handler, const char* text, int64_t length, const JsnParseLinesOptions& options )
+{
+  LinesContext context;
+  context.m_Handler      = handler;
+  context.m_Text         = text;
+  context.m_Length       = text && length > 0 ? length : 0;
+  context.m_ChunkSize    = options.m_ChunkSize > 0 ? options.m_ChunkSize : 1 << 20;
+  context.m_ChunkCount   = ( context.m_Length + context.m_ChunkSize - 1 ) / context.m_ChunkSize;
+  context.m_ParseOptions = options.m_ParseOptions;
+  context.m_ParseOptions.m_Index = NULL;
+  context.m_ParseOptions.m_Stats = NULL;
+  context.m_Ordered      = options.m_Ordered;
+  context.m_Failed       = false;
+  context.m_Delivered    = 0;
+
+  int worker_count = options.m_ThreadCount > 0 ? options.m_ThreadCount : ( int )std::thread::hardware_concurrency();
+  if( worker_count < 1 )
+  {
+    worker_count = 1;
+  }
+  if( worker_count > context.m_ChunkCount && context.m_ChunkCount > 0 )
+  {
+    worker_count = ( int )context.m_ChunkCount;
+  }
+  handler->BeginLines( worker_count );
+
+  // Count line ends in all chunks first, so every worker knows the line numbers of the chunks it takes
+  context.m_LineCounts = new int64_t[ context.m_ChunkCount + 1 ];
+  context.m_LineCounts[ 0 ] = 0;
+  JsnRunWorkers( &context, &context.m_NextChunk, worker_count, CountWork );
+  for( int64_t i = 1; i <= context.m_ChunkCount; ++i )
+  {
+    context.m_LineCounts[ i ] += context.m_LineCounts[ i - 1 ];
+  }
+
+  context.m_WorkerStats = options.m_ParseOptions.m_Stats ? new JsnStats[ worker_count ] : NULL;
+  JsnRunWorkers( &context, &context.m_NextChunk, worker_count, context.m_Ordered ? ParseOrdered : ParseUnordered );
+  if( context.m_WorkerStats )
+  {
+    for( int i = 0; i < worker_count; ++i )
+    {
+      options.m_ParseOptions.m_Stats->Add( context.m_WorkerStats[ i ] );
+    }
+    delete[] context.m_WorkerStats;
+  }
+
+  delete[] context.m_LineCounts;
+  return !context.m_Failed;
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,107 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \interface JsnLineHandler
+ Receives the records of a JSON Lines text from JsnParseLines(). Each line holds one JSON value. For each
+ line, BeginLine() provides the handler for the value, and EndLine() reports the outcome. Lines that hold
+ only whitespace are skipped.
+
+ Several worker threads call these members at the same time. Calls for the same worker never overlap, so
+ keeping one handler per worker is enough to avoid locking.
+ */
+class JsnLineHandler
+{
+public:
+
+  /**
+   Called once, on the calling thread, before any other member.
+   \param[ in ] worker_count Number of workers. Worker indices run from zero to worker_count - 1.
+   */
+  virtual void        BeginLines( int worker_count ) = 0;
+  /**
+   Start a record.
+   \param[ in ] worker Index of the calling worker.
+   \param[ in ] line Line number, starting at 1.
+   \return Handler that will receive the value of the line, or NULL to skip the line.
+   */
+  virtual JsnHandler* BeginLine( int worker, int64_t line ) = 0;
+  /**
+   Finish a record. Not called if BeginLine() returned NULL.
+   \param[ in ] worker Index of the calling worker.
+   \param[ in ] line Line number, starting at 1.
+   \param[ in ] handler Handler from BeginLine().
+   \param[ in ] error Error string, or NULL if the line was parsed successfully. After an error, the handler
+   may have received part of the value.
+   */
+  virtual void        EndLine( int worker, int64_t line, JsnHandler* handler, const char* error ) = 0;
+
+  virtual ~JsnLineHandler() {}
+};
+
+/************************************************************************************************************/ /**
+ \struct JsnParseLinesOptions
+ Settings for JsnParseLines().
+ */
+struct JsnParseLinesOptions
+{
+  int             m_ThreadCount;  /**< Number of worker threads, or zero for one per hardware thread. */
+  int64_t         m_ChunkSize;    /**< Workers take the text in chunks of about this many bytes. Each chunk
+                                   ends at a line end. */
+  bool            m_Ordered;      /**< Deliver records in line order. Each chunk is parsed into a
+                                   JsnDocument first, and passed on when all chunks before it have been.
+                                   The calls for one chunk are made by the worker that parsed it, but calls
+                                   never overlap. Without this, records are passed on as they are parsed. */
+  JsnParseOptions m_ParseOptions; /**< Options for each line. m_Index is ignored. Statistics in m_Stats are
+                                   gathered per worker, and added up when all lines are done. */
+
+  JsnParseLinesOptions()
+  : m_ThreadCount( 0 )
+  , m_ChunkSize( 1 << 20 )
+  , m_Ordered( false )
+  {}
+};
+
+/************************************************************************************************************/ /**
+ Parse a JSON Lines text, also known as newline delimited JSON, on several threads. The text is split into
+ chunks at line ends, and each worker takes the next chunk when it is done with the previous one. A line
+ that fails to parse is reported to EndLine(), and does not stop the other lines.
+ Uses std::thread. Compile with thread support enabled (-pthread with GCC and Clang).
+ \param[ in ] handler Line handler implementation.
+ \param[ in ] text Start of text, not necessarily zero terminated. Must be writable if
+ m_ParseOptions.m_UnescapeInPlace is set.
+ \param[ in ] length Length of text.
+ \param[ in ] options Settings.
+ \return true if all lines were parsed successfully, false if not.
+ */
+bool JsnParseLines( JsnLineHandler* handler, const char* text, int64_t length,
+                    const JsnParseLinesOptions& options = JsnParseLinesOptions() );
+
+/****************************************************************************************************************/
@@ -0,0 +1,82 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+#include "JsnStream.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ Scan a number, accepting the same text as JsnParse(), and decode its value. Integers that fit in
+ int64_t are decoded exactly, eight digits at a time. Everything else is decoded to the nearest double,
+ using the Clinger fast path where it applies, and the Eisel-Lemire algorithm otherwise. Both round
+ correctly. Neither depends on the locale.
+ \param[ in ] text Start of text. The number may be followed by other text.
+ \param[ in ] length Length of text.
+ \param[ out ] number Fragment covering the number text. Type is kJsn_Int or kJsn_Float, the decoded
+ value is in m_Value, and m_Flags contains kJsnFlag_Decoded.
+ \return Number of characters scanned.
+ */
+int64_t JsnParseNumber( const char* text, int64_t length, JsnFragment* number );
+
+/**
+ Maximum number of characters written by JsnFormatInt() and JsnFormatFloat().
+ */
+enum { kJsnMaxNumberLength = 25 };
+
+/************************************************************************************************************/ /**
+ Format an integer as decimal text.
+ \param[ out ] buf Buffer of at least kJsnMaxNumberLength characters. Will not be zero terminated.
+ \param[ in ] value The value to format.
+ \return Number of characters written.
+ */
+int JsnFormatInt( char* buf, int64_t value );
+
+/************************************************************************************************************/ /**
+ Format a double as the shortest decimal text that reads back as exactly the same value. Uses the Schubfach
+ algorithm. Does not depend on the locale. Values from 1e-6 up to 1e21 are written without exponent, like
+ JavaScript does. Infinity and NaN have no JSON representation, and are written as null.
+ \param[ out ] buf Buffer of at least kJsnMaxNumberLength characters. Will not be zero terminated.
+ \param[ in ] value The value to format.
+ \return Number of characters written.
+ */
+int JsnFormatFloat( char* buf, double value );
+
+/************************************************************************************************************/ /**
+ Format an integer straight into a stream. See JsnFormatInt().
+ \param[ in ] stream Output stream.
+ \param[ in ] value The value to write.
+ */
+void JsnWriteInt( JsnStreamOut* stream, int64_t value );
+
+/************************************************************************************************************/ /**
+ Format a double straight into a stream. See JsnFormatFloat().
+ \param[ in ] stream Output stream.
+ \param[ in ] value The value to write.
+ */
+void JsnWriteFloat( JsnStreamOut* stream, double value );
+
+/****************************************************************************************************************/
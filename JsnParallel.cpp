@@ -0,0 +1,458 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnParallel.h"
+#include "JsnBlock.h"
+#include "JsnUTF8.h"
+#include "JsnWorkers.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+/****************************************************************************************************************/
+
+namespace
+{
+  struct Chunk
+  {
+    int64_t m_Begin;
+    int64_t m_End;
+    int64_t m_Delta[ 2 ];   // Change in depth, assuming the chunk starts outside [ 0 ] or inside [ 1 ] a string
+    int64_t m_Min[ 2 ];     // Lowest depth relative to the start, with the same assumptions
+    bool    m_Parity;       // Odd number of string quotes
+    bool    m_InString;     // The chunk starts inside a string
+    int64_t m_Depth;        // Depth at the start, where the top level array is depth 1, or 0 after the array
+    int64_t m_Split;        // Start of the first element that starts in this chunk, or -1 if there is none
+  };
+
+  struct Range
+  {
+    int64_t     m_Begin;
+    int64_t     m_End;
+    const char* m_Error;
+    int64_t     m_ErrorPosition;
+  };
+
+  struct ParallelContext
+  {
+    JsnElementHandler*      m_Handler;
+    const char*             m_Text;
+    int64_t                 m_Length;
+    Chunk*                  m_Chunks;
+    int64_t                 m_ChunkCount;
+    Range*                  m_Ranges;
+    int64_t                 m_RangeCount;
+    JsnParseOptions         m_ParseOptions;
+    JsnStats*               m_WorkerStats;  // Statistics of each worker, or NULL
+    bool                    m_ValidateUTF8;
+    std::atomic< int64_t >  m_Next;         // Next chunk or range to be taken by a worker
+    std::atomic< int64_t >  m_FirstError;   // First range that failed, or m_RangeCount
+    int64_t                 m_ArrayEnd;     // Read position after the array
+  };
+
+  // Consumes values that the element handler chose to skip
+  class SkipHandler final : public JsnHandler
+  {
+  public:
+    virtual void        AddProperty( const JsnFragment&, const JsnFragment& ) override {}
+    virtual JsnHandler* BeginObject( const JsnFragment& ) override { return NULL; }
+    virtual void        EndObject( JsnHandler* ) override {}
+    virtual JsnHandler* BeginArray( const JsnFragment& ) override { return NULL; }
+    virtual void        EndArray( JsnHandler* ) override {}
+  };
+}
+
+/****************************************************************************************************************/
+
+// A run of backslashes just before the chunk escapes its first byte if the run has odd length.
+static uint64_t EscapedAtStart( const ParallelContext* context, int64_t begin )
+{
+  int64_t first = context->m_Chunks[ 0 ].m_Begin;
+  int64_t p = begin;
+  while( p > first && context->m_Text[ p - 1 ] == '\\' )
+  {
+    p -= 1;
+  }
+  return ( begin - p ) & 1;
+}
+
+static void ClassifyAt( const ParallelContext* context, int64_t base, int64_t end, JsnBlock* block )
+{
+  const uint8_t* p = ( const uint8_t* )context->m_Text + base;
+  if( end - base >= 64 )
+  {
+    JsnClassifyBlock( p, block );
+  }
+  else
+  {
+    JsnClassifyPartialBlock( p, ( int )( end - base ), block );
+  }
+}
+
+/****************************************************************************************************************/
+
+// First pass: string parity and depth changes of a chunk, for either string state at its start. Starting
+// inside a string flips the string mask, so both are found from one mask.
+static void ScanChunk( ParallelContext* context, Chunk* chunk )
+{
+  JsnStringMask strings;
+  strings.m_PrevEscaped = EscapedAtStart( context, chunk->m_Begin );
+  int64_t depth[ 2 ] = { 0, 0 };
+  int64_t min[ 2 ] = { 0, 0 };
+  for( int64_t base = chunk->m_Begin; base < chunk->m_End; base += 64 )
+  {
+    JsnBlock block;
+    ClassifyAt( context, base, chunk->m_End, &block );
+    uint64_t quotes;
+    uint64_t in_string = strings.Next( block, &quotes );
+    uint64_t structural = block.m_Structural;
+    while( structural )
+    {
+      int bit = JsnCountTrailingZeros( structural );
+      structural &= structural - 1;
+      int outside = ( int )( ( in_string >> bit ) & 1 ); // Index of the assumption under which this is outside
+      switch( context->m_Text[ base + bit ] )
+      {
+        case '{':
+        case '[':
+          depth[ outside ] += 1;
+          break;
+        case '}':
+        case ']':
+          depth[ outside ] -= 1;
+          if( depth[ outside ] < min[ outside ] )
+          {
+            min[ outside ] = depth[ outside ];
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  for( int i = 0; i < 2; ++i )
+  {
+    chunk->m_Delta[ i ] = depth[ i ];
+    chunk->m_Min[ i ] = min[ i ];
+  }
+  chunk->m_Parity = strings.m_PrevInString != 0;
+}
+
+// Second pass: find the first top level comma in a chunk. The element after it starts a range.
+static void FindSplit( ParallelContext* context, Chunk* chunk )
+{
+  chunk->m_Split = -1;
+  int64_t depth = chunk->m_Depth;
+  if( depth <= 0 )
+  {
+    return;
+  }
+  JsnStringMask strings;
+  strings.m_PrevEscaped = EscapedAtStart( context, chunk->m_Begin );
+  strings.m_PrevInString = chunk->m_InString ? ~0ULL : 0;
+  for( int64_t base = chunk->m_Begin; base < chunk->m_End; base += 64 )
+  {
+    JsnBlock block;
+    ClassifyAt( context, base, chunk->m_End, &block );
+    uint64_t quotes;
+    uint64_t in_string = strings.Next( block, &quotes );
+    uint64_t structural = block.m_Structural & ~in_string;
+    while( structural )
+    {
+      int64_t position = base + JsnCountTrailingZeros( structural );
+      structural &= structural - 1;
+      switch( context->m_Text[ position ] )
+      {
+        case '{':
+        case '[':
+          depth += 1;
+          break;
+        case '}':
+        case ']':
+          if( --depth == 0 )
+          {
+            return;
+          }
+          break;
+        case ',':
+          if( depth == 1 )
+          {
+            chunk->m_Split = position + 1;
+            return;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+}
+
+/****************************************************************************************************************/
+
+static void EatSpace( JsnStreamIn* stream )
+{
+  while( stream->Peek() != -1 && stream->Peek() <= ' ' )
+  {
+    stream->Read();
+  }
+}
+
+// Third pass: parse the elements of a range. The range must end exactly where the next one starts.
+static void ParseRange( ParallelContext* context, const JsnParseOptions& options, int worker, int64_t range_index )
+{
+  Range* range = context->m_Ranges + range_index;
+  bool last = range_index == context->m_RangeCount - 1;
+  JsnStreamIn stream( context->m_Text, context->m_Length );
+  stream.Seek( range->m_Begin );
+
+  if( context->m_ValidateUTF8 )
+  {
+    int64_t offset = JsnValidateUTF8( context->m_Text + range->m_Begin, range->m_End - range->m_Begin );
+    if( offset >= 0 )
+    {
+      stream.Seek( range->m_Begin + offset );
+      stream.SetError( "Invalid UTF-8" );
+    }
+  }
+
+  SkipHandler skip;
+  int64_t index = 0;
+  bool done = false;
+  while( !stream.GetError() && !done && context->m_FirstError > range_index )
+  {
+    EatSpace( &stream );
+    if( stream.Peek() != ']' )
+    {
+      JsnHandler* handler = context->m_Handler->BeginElement( worker, range_index, index );
+      JsnParse( handler ? handler : &skip, &stream, options );
+      if( handler )
+      {
+        context->m_Handler->EndElement( worker, range_index, index, handler );
+      }
+      index += 1;
+      EatSpace( &stream );
+    }
+    if( stream.Peek() == ',' )
+    {
+      stream.Read();
+      if( !last && stream.GetCount() >= range->m_End )
+      {
+        if( stream.GetCount() > range->m_End )
+        {
+          // The element runs into the next range, so the split point was not between elements after all
+          stream.SetError( "Syntax error" );
+        }
+        done = true;
+      }
+      continue;
+    }
+    if( stream.Read() != ']' )
+    {
+      stream.Unread();
+      stream.SetError( "\"]\" expected" );
+    }
+    else if( !last )
+    {
+      stream.Unread();
+      stream.SetError( "Syntax error" );
+    }
+    else
+    {
+      context->m_ArrayEnd = stream.GetCount();
+    }
+    done = true;
+  }
+
+  if( stream.GetError() )
+  {
+    range->m_Error = stream.GetError();
+    range->m_ErrorPosition = stream.GetCount();
+    int64_t first = context->m_FirstError;
+    while( range_index < first && !context->m_FirstError.compare_exchange_weak( first, range_index ) )
+    {
+    }
+  }
+}
+
+/****************************************************************************************************************/
+
+static void ScanWork( ParallelContext* context, int )
+{
+  int64_t i;
+  while( ( i = context->m_Next++ ) < context->m_ChunkCount )
+  {
+    ScanChunk( context, context->m_Chunks + i );
+  }
+}
+
+static void SplitWork( ParallelContext* context, int )
+{
+  int64_t i;
+  while( ( i = context->m_Next++ ) < context->m_ChunkCount )
+  {
+    if( i > 0 )
+    {
+      FindSplit( context, context->m_Chunks + i );
+    }
+  }
+}
+
+static void ParseWork( ParallelContext* context, int worker )
+{
+  JsnParseOptions options = JsnWorkerOptions( context, worker );
+  int64_t i;
+  while( ( i = context->m_Next++ ) < context->m_RangeCount )
+  {
+    ParseRange( context, options, worker, i );
+  }
+}
+
+/****************************************************************************************************************/
+
+bool JsnParseParallel( JsnElementHandler* handler, JsnStreamIn* stream, const JsnParallelOptions& options )
+{
+  if( stream->Peek() != '[' )
+  {
+    stream->SetError( stream->GetRemaining() ? "\"[\" expected" : "Unexpected end of input data" );
+    return false;
+  }
+  stream->Read();
+
+  ParallelContext context;
+  context.m_Handler      = handler;
+  context.m_Text         = stream->GetCurrent() - stream->GetCount();
+  context.m_Length       = stream->GetCount() + stream->GetRemaining();
+  context.m_ParseOptions = options.m_ParseOptions;
+  context.m_ParseOptions.m_Index = NULL;
+  context.m_ParseOptions.m_Filter = NULL;
+  context.m_ParseOptions.m_Stats = NULL;
+  context.m_ParseOptions.m_ValidateUTF8 = false; // Each range is validated once, rather than per element
+  context.m_ValidateUTF8 = options.m_ParseOptions.m_ValidateUTF8;
+  context.m_ArrayEnd     = 0;
+
+  int worker_count = options.m_ThreadCount > 0 ? options.m_ThreadCount : ( int )std::thread::hardware_concurrency();
+  if( worker_count < 1 )
+  {
+    worker_count = 1;
+  }
+
+  // With a single worker, the whole array is one range, and there is no need to look for split points
+  int64_t begin = stream->GetCount();
+  int64_t chunk_size = options.m_ChunkSize > 0 && worker_count > 1 ? options.m_ChunkSize : context.m_Length;
+  context.m_ChunkCount = ( context.m_Length - begin + chunk_size - 1 ) / chunk_size;
+  if( context.m_ChunkCount < 1 )
+  {
+    context.m_ChunkCount = 1;
+  }
+  if( worker_count > context.m_ChunkCount )
+  {
+    worker_count = ( int )context.m_ChunkCount;
+  }
+  context.m_Chunks = new Chunk[ context.m_ChunkCount ];
+  for( int64_t i = 0; i < context.m_ChunkCount; ++i )
+  {
+    Chunk& chunk = context.m_Chunks[ i ];
+    chunk.m_Begin = begin + i * chunk_size;
+    chunk.m_End = context.m_Length - chunk.m_Begin > chunk_size ? chunk.m_Begin + chunk_size : context.m_Length;
+  }
+
+  if( context.m_ChunkCount > 1 )
+  {
+    JsnRunWorkers( &context, &context.m_Next, worker_count, ScanWork );
+
+    // Pick the right assumption for each chunk, in order. Once the array is closed, no more ranges start.
+    bool in_string = false;
+    int64_t depth = 1;
+    for( int64_t i = 0; i < context.m_ChunkCount; ++i )
+    {
+      Chunk& chunk = context.m_Chunks[ i ];
+      int assumption = in_string ? 1 : 0;
+      chunk.m_InString = in_string;
+      chunk.m_Depth = depth;
+      if( depth > 0 )
+      {
+        depth = depth + chunk.m_Min[ assumption ] <= 0 ? 0 : depth + chunk.m_Delta[ assumption ];
+      }
+      in_string ^= chunk.m_Parity;
+    }
+
+    JsnRunWorkers( &context, &context.m_Next, worker_count, SplitWork );
+  }
+
+  context.m_RangeCount = 0;
+  context.m_Ranges = new Range[ context.m_ChunkCount ];
+  for( int64_t i = 0; i < context.m_ChunkCount; ++i )
+  {
+    int64_t split = i == 0 ? begin : context.m_Chunks[ i ].m_Split;
+    if( split >= 0 )
+    {
+      Range& range = context.m_Ranges[ context.m_RangeCount++ ];
+      range.m_Begin = split;
+      range.m_Error = NULL;
+      range.m_ErrorPosition = 0;
+    }
+  }
+  for( int64_t i = 0; i < context.m_RangeCount; ++i )
+  {
+    context.m_Ranges[ i ].m_End = i + 1 < context.m_RangeCount ? context.m_Ranges[ i + 1 ].m_Begin : context.m_Length;
+  }
+  delete[] context.m_Chunks;
+
+  if( worker_count > context.m_RangeCount )
+  {
+    worker_count = ( int )context.m_RangeCount;
+  }
+  handler->BeginElements( worker_count, context.m_RangeCount );
+  context.m_FirstError = context.m_RangeCount;
+  context.m_WorkerStats = options.m_ParseOptions.m_Stats ? new JsnStats[ worker_count ] : NULL;
+  JsnRunWorkers( &context, &context.m_Next, worker_count, ParseWork );
+  if( context.m_WorkerStats )
+  {
+    for( int i = 0; i < worker_count; ++i )
+    {
+      options.m_ParseOptions.m_Stats->Add( context.m_WorkerStats[ i ] );
+    }
+    delete[] context.m_WorkerStats;
+  }
+
+  int64_t first_error = context.m_FirstError;
+  if( first_error < context.m_RangeCount )
+  {
+    stream->Seek( context.m_Ranges[ first_error ].m_ErrorPosition );
+    stream->SetError( context.m_Ranges[ first_error ].m_Error );
+  }
+  else
+  {
+    stream->Seek( context.m_ArrayEnd );
+  }
+  delete[] context.m_Ranges;
+  return !stream->GetError();
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,119 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \interface JsnElementHandler
+ Receives the elements of a top level array from JsnParseParallel(). The array is cut into ranges of
+ consecutive elements, and each range is parsed by one worker. For each element, BeginElement() provides
+ the handler for the value, and EndElement() finishes it. The handler receives the same calls as the
+ array's handler would from JsnParse().
+
+ Ranges are numbered in text order, and elements are numbered from zero within their range. To put the
+ results back in order, keep them per range and append the ranges in order when the parse is done.
+
+ Several worker threads call these members at the same time. Calls for the same worker never overlap, so
+ keeping one handler per worker is enough to avoid locking.
+ */
+class JsnElementHandler
+{
+public:
+
+  /**
+   Called once, on the calling thread, before any other member.
+   \param[ in ] worker_count Number of workers. Worker indices run from zero to worker_count - 1.
+   \param[ in ] range_count Number of ranges. Range indices run from zero to range_count - 1.
+   */
+  virtual void        BeginElements( int worker_count, int64_t range_count ) = 0;
+  /**
+   Start an element.
+   \param[ in ] worker Index of the calling worker.
+   \param[ in ] range Index of the range that holds the element.
+   \param[ in ] index Index of the element within its range.
+   \return Handler that will receive the value, or NULL to skip the element.
+   */
+  virtual JsnHandler* BeginElement( int worker, int64_t range, int64_t index ) = 0;
+  /**
+   Finish an element. Not called if BeginElement() returned NULL.
+   \param[ in ] worker Index of the calling worker.
+   \param[ in ] range Index of the range that holds the element.
+   \param[ in ] index Index of the element within its range.
+   \param[ in ] handler Handler from BeginElement().
+   */
+  virtual void        EndElement( int worker, int64_t range, int64_t index, JsnHandler* handler ) = 0;
+
+  virtual ~JsnElementHandler() {}
+};
+
+/************************************************************************************************************/ /**
+ \struct JsnParallelOptions
+ Settings for JsnParseParallel().
+ */
+struct JsnParallelOptions
+{
+  int             m_ThreadCount;  /**< Number of worker threads, or zero for one per hardware thread. */
+  int64_t         m_ChunkSize;    /**< The text is scanned in chunks of this many bytes. Each chunk
+                                   starts at most one range. */
+  JsnParseOptions m_ParseOptions; /**< Options for each element. m_Index and m_Filter are ignored. Statistics
+                                   in m_Stats are gathered per worker, and added up when all elements are
+                                   done. They count each element as a top level value. */
+
+  JsnParallelOptions()
+  : m_ThreadCount( 0 )
+  , m_ChunkSize( 1 << 22 )
+  {}
+};
+
+/************************************************************************************************************/ /**
+ Parse a text that holds one large array, on several threads.
+
+ The split points between elements are found without parsing. A first pass over all chunks in parallel
+ tracks strings and bracket depth in each chunk twice: once assuming the chunk starts outside a string,
+ and once assuming it starts inside one. A quick serial pass over the chunks then picks the right
+ assumption for each chunk, and works out the nesting depth at its start. A second pass finds the first
+ comma between top level elements in each chunk, and the ranges between these are parsed in parallel.
+
+ Elements are checked as strictly as by JsnParse(). If a split point was picked wrongly, the text was not
+ valid JSON, and the element that crosses it causes an error. The error reported is the one in the first
+ range that has one, which is not always the error JsnParse() would report. Ranges after that one are
+ abandoned, so the handler may not have received all elements before the error.
+
+ Handlers can skip objects and arrays as with JsnParse(), but RequestStop() is not supported.
+
+ Uses std::thread. Compile with thread support enabled (-pthread with GCC and Clang).
+ \param[ in ] handler Element handler implementation.
+ \param[ in ] stream Stream to parse. On success, the read position is just past the array. On failure,
+ the stream holds the error and its position.
+ \param[ in ] options Settings.
+ \return true if successful, false if not. Call stream->GetError() for details.
+ */
+bool JsnParseParallel( JsnElementHandler* handler, JsnStreamIn* stream,
+                       const JsnParallelOptions& options = JsnParallelOptions() );
+
+/****************************************************************************************************************/
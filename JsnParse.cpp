@@ -24,11 +24,15 @@
  */
 
 #include "JsnParse.h"
+#include "JsnBlock.h"
+#include "JsnIndex.h"
+#include "JsnNumber.h"
+#include "JsnParseStatic.h"
+#include "JsnPathFilter.h"
 #include "JsnUTF8.h"
 #include "JsnStream.h"
 
 #include <stdlib.h>
-#include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 
@@ -51,255 +55,353 @@ static bool IsUTF8Whitespace( int codepoint )
   codepoint == 0xFEFF;
 }
 
-static void JsnEatSpace( JsnStreamIn* stream )
+JsnParseContext::JsnParseContext( JsnStreamIn* stream, const JsnParseOptions& options )
+: m_Stream( stream )
+, m_Positions( options.m_Index ? options.m_Index->GetPositions() : NULL )
+, m_EscapedBits( options.m_Index ? options.m_Index->GetEscapedBits() : NULL )
+, m_Cursor( 0 )
+, m_Text( stream->GetCurrent() - stream->GetCount() )
+, m_End( stream->GetCount() + stream->GetRemaining() )
+, m_Unescape( options.m_UnescapeInPlace )
+, m_Stop( false )
+, m_HashKeys( options.m_HashKeys || options.m_Keys != NULL )
+, m_Keys( options.m_Keys )
+, m_Filter( options.m_Filter )
+, m_Stats( options.m_Stats )
+, m_Depth( 0 )
 {
-  while( stream->Peek() != -1 && stream->Peek() <= ' ' )
+  if( m_Positions && stream->GetCount() )
   {
-    stream->Read();
+    // Starting in the middle of the text, for instance at a value found with JsnIndex::Find(). Look up
+    // the first position at or after the read position, rather than walking up to it.
+    int64_t low = 0;
+    int64_t high = options.m_Index->GetCount();
+    while( low < high )
+    {
+      int64_t middle = low + ( high - low ) / 2;
+      if( ( int64_t )m_Positions[ middle ] < stream->GetCount() )
+      {
+        low = middle + 1;
+      }
+      else
+      {
+        high = middle;
+      }
+    }
+    m_Cursor = low;
+  }
+  if( m_Positions && ( int64_t )m_Positions[ options.m_Index->GetCount() ] < m_End )
+  {
+    m_End = ( int64_t )m_Positions[ options.m_Index->GetCount() ];
   }
 }
 
-static JsnFragment ParseString( JsnStreamIn* stream )
+bool JsnParseContext::Validate( JsnStreamIn* stream, const JsnParseOptions& options )
 {
-  stream->Read(); // Skip leading quote
-  const char* begin = stream->GetCurrent();
-  int c = stream->Read();
-  while( c != '"' )
+  if( options.m_ValidateUTF8 )
   {
-    if( c == '\\' )
+    int64_t offset = JsnValidateUTF8( stream->GetCurrent(), stream->GetRemaining() );
+    if( offset >= 0 )
     {
-      c = stream->Read(); // Skip escaped character
+      stream->Seek( stream->GetCount() + offset );
+      stream->SetError( "Invalid UTF-8" );
+      return false;
     }
-    c = stream->Read();
   }
-  const char* end = stream->GetCurrent() - 1;
-  return JsnFragment( kJsn_String, begin, end );
+  return true;
+}
+
+int JsnParseContext::GetStartState() const
+{
+  return m_Filter ? m_Filter->GetStart() : ( int )JsnPathFilter::kAll;
 }
 
-static double TextAsFloat( const char* text, int length )
+void JsnParseContext::Unescape( JsnFragment* fragment )
 {
-  char buf[ 100 ];  // Could be 1000000000000000000000000000000000000000000000000000000000000
-  if( length < sizeof( buf ) - 1 )
+  if( m_Stream->GetError() )
   {
-    memcpy( buf, text, length );
-    buf[ length ] = '\0';
-    return atof( buf );
+    return;
+  }
+  fragment->m_Flags |= kJsnFlag_Unescaped;
+  if( fragment->m_Flags & kJsnFlag_Escaped )
+  {
+    // The caller promised the text is writable
+    int64_t length = JsnUnescapeInPlace( const_cast< char* >( fragment->m_Text ), fragment->m_Length );
+    if( length < 0 )
+    {
+      m_Stream->SetError( "Invalid escape sequence" );
+    }
+    else
+    {
+      fragment->m_Length = length;
+    }
   }
-  return 0;
 }
 
-static JsnFragment ParseNumber( JsnStreamIn* stream )
+// Decoded text of a property name. Names without escape sequences, or with an invalid one, are used as they
+// are.
+class DecodedName
 {
-  JsnType t = kJsn_Int;
+public:
 
-  const char* begin = stream->GetCurrent();
-  int c = stream->Read();
-  if( c == '-' )
+  DecodedName( const JsnFragment& name )
+  : m_Text( name.m_Text )
+  , m_Length( name.m_Length )
+  , m_Allocated( NULL )
   {
-    c = stream->Read();
+    if( ( name.m_Flags & kJsnFlag_Escaped ) && !( name.m_Flags & kJsnFlag_Unescaped ) )
+    {
+      char* text = name.m_Length <= ( int64_t )sizeof( m_Buffer ) ? m_Buffer : m_Allocated = new char[ name.m_Length ];
+      memcpy( text, name.m_Text, ( size_t )name.m_Length );
+      int64_t length = JsnUnescapeInPlace( text, name.m_Length );
+      if( length >= 0 )
+      {
+        m_Text = text;
+        m_Length = length;
+      }
+    }
   }
 
-  while( c >= '0' && c <= '9' )
+  ~DecodedName()
   {
-    c = stream->Read();
+    delete[] m_Allocated;
   }
 
-  if( c == '.' )
+  const char* m_Text;
+  int64_t     m_Length;
+
+private:
+
+  char*       m_Allocated;
+  char        m_Buffer[ 256 ];
+
+  DecodedName( const DecodedName& other );
+};
+
+void JsnParseContext::HashEscapedName( JsnFragment* name )
+{
+  DecodedName decoded( *name );
+  uint32_t hash = JsnHashKey( decoded.m_Text, decoded.m_Length );
+  name->m_Value.key.hash = hash;
+  name->m_Flags |= kJsnFlag_Hashed;
+  if( m_Keys )
   {
-    t = kJsn_Float;
-    c = stream->Read();
-    while( c >= '0' && c <= '9' )
-    {
-      c = stream->Read();
-    }
+    name->m_Value.key.id = m_Keys->Find( hash, decoded.m_Text, decoded.m_Length );
+    name->m_Flags |= name->m_Value.key.id >= 0 ? kJsnFlag_KeyId : 0;
   }
+}
+
+uint32_t JsnFragment::HashKey() const
+{
+  DecodedName decoded( *this );
+  return JsnHashKey( decoded.m_Text, decoded.m_Length );
+}
 
-  if( c == 'e' || c == 'E' )
+bool JsnFragment::IsEscapedKey( const char* text, int64_t length ) const
+{
+  // The decoded name is never longer than the JSON text
+  if( m_Length < length )
   {
-    t = kJsn_Float;
-    c = stream->Read();
-    if( c == '-' || c == '+' )
-    {
-      c = stream->Read();
-    }
-    while( c >= '0' && c <= '9' )
-    {
-      c = stream->Read();
-    }
+    return false;
   }
-  stream->Unread();
-  const char* end = stream->GetCurrent();
+  DecodedName decoded( *this );
+  return decoded.m_Length == length && memcmp( decoded.m_Text, text, ( size_t )length ) == 0;
+}
 
-  if( t == kJsn_Int )
+static JsnFragment DecodeNumber( const JsnFragment& fragment )
+{
+  JsnFragment number( fragment );
+  if( !( fragment.m_Flags & kJsnFlag_Decoded ) )
   {
-    double f = TextAsFloat( begin, ( int )( end - begin ) );
-    if( f > UINT64_MAX || f < INT64_MIN )
-    {
-      t = kJsn_Float;
-    }
+    JsnParseNumber( fragment.m_Text, fragment.m_Length, &number );
   }
-
-  return JsnFragment( t, begin, end );
+  return number;
 }
 
 double JsnFragment::AsFloat() const
 {
-  return TextAsFloat( m_Text, m_Length );
+  JsnFragment number = DecodeNumber( *this );
+  return number.m_Type == kJsn_Int ? ( double )number.m_Value.i : number.m_Value.f;
 }
 
 int64_t JsnFragment::AsInt() const
 {
-  char buf[ 25 ];
-  if( m_Length < sizeof( buf ) - 1 )
+  JsnFragment number = DecodeNumber( *this );
+  if( number.m_Type == kJsn_Int )
+  {
+    return number.m_Value.i;
+  }
+  double f = number.m_Value.f;
+  if( f >= 9223372036854775807.0 )
   {
-    memcpy( buf, m_Text, m_Length );
-    buf[ m_Length ] = '\0';
-    return atoi( buf );
+    return INT64_MAX;
   }
-  return 0;
+  if( f <= -9223372036854775808.0 )
+  {
+    return INT64_MIN;
+  }
+  return f == f ? ( int64_t )f : 0;
 }
 
 JsnFragment JsnFragment::FromFloat( char* buf25, int buf_size, double value )
 {
-  snprintf( buf25, buf_size, "%.16g", value );
-  return JsnFragment( kJsn_Float, buf25 );
+  char buf[ kJsnMaxNumberLength ];
+  int length = JsnFormatFloat( buf, value );
+  length = length < buf_size ? length : buf_size - 1;
+  memcpy( buf25, buf, length );
+  buf25[ length ] = 0;
+  return JsnFragment( kJsn_Float, buf25, length );
 }
 
 JsnFragment JsnFragment::FromInt( char* buf25, int buf_size, int64_t value )
 {
-  snprintf( buf25, buf_size, "%lld", value );
-  return JsnFragment( kJsn_Int, buf25 );
+  char buf[ kJsnMaxNumberLength ];
+  int length = JsnFormatInt( buf, value );
+  length = length < buf_size ? length : buf_size - 1;
+  memcpy( buf25, buf, length );
+  buf25[ length ] = 0;
+  return JsnFragment( kJsn_Int, buf25, length );
 }
 
-static void ParseTrue( JsnStreamIn* stream )
+JsnFragment JsnFragment::FromFloat( double value )
 {
-  if( stream->Read() != 't' ||
-      stream->Read() != 'r' ||
-      stream->Read() != 'u' ||
-      stream->Read() != 'e'
-    )
-  {
-    stream->SetError( "Syntax error" );
-  }
+  JsnFragment fragment( kJsn_Float );
+  fragment.m_Flags = kJsnFlag_Decoded;
+  fragment.m_Value.f = value;
+  return fragment;
 }
 
-static void ParseFalse( JsnStreamIn* stream )
+JsnFragment JsnFragment::FromInt( int64_t value )
 {
-  if( stream->Read() != 'f' ||
-      stream->Read() != 'a' ||
-      stream->Read() != 'l' ||
-      stream->Read() != 's' ||
-      stream->Read() != 'e'
-    )
-  {
-    stream->SetError( "Syntax error" );
-  }
+  JsnFragment fragment( kJsn_Int );
+  fragment.m_Flags = kJsnFlag_Decoded;
+  fragment.m_Value.i = value;
+  return fragment;
 }
 
-static void ParseNull( JsnStreamIn* stream )
+// Move past the object or array at the read position, without parsing it. Only quotes and brackets are
+// looked at, so the contents are not checked for errors.
+void JsnParseContext::SkipContainer()
 {
-  if( stream->Read() != 'n' ||
-      stream->Read() != 'u' ||
-      stream->Read() != 'l' ||
-      stream->Read() != 'l'
-    )
+  JsnStreamIn* stream = m_Stream;
+  const char* text = stream->GetCurrent() - stream->GetCount();
+  int64_t length = stream->GetCount() + stream->GetRemaining();
+  int64_t depth = 0;
+
+  if( m_Positions && NextPosition() == stream->GetCount() )
   {
-    stream->SetError( "Syntax error" );
+    if( IndexedSkipContainer() )
+    {
+      stream->Seek( ( int64_t )m_Positions[ m_Cursor - 1 ] + 1 );
+      return;
+    }
   }
-}
-
-static void ParseValue( JsnHandler* reader, JsnStreamIn* stream, const JsnFragment& name );
-
-static void ParseObject( JsnHandler* reader, JsnStreamIn* stream )
-{
-  do
+  else
   {
-    stream->Read(); // Skip open brace or comma
-    JsnEatSpace( stream );
-    int c = stream->Peek();
-    if( c != '}' )
+    // Classify a block at a time, and only look at the structural characters outside strings
+    const uint8_t* p = ( const uint8_t* )text;
+    JsnStringMask strings;
+    for( int64_t base = stream->GetCount(); base < length; base += 64 )
     {
-      JsnFragment name;
-      if( c == '"' )
+      JsnBlock block;
+      if( length - base >= 64 )
       {
-        name = ParseString( stream );
+        JsnClassifyBlock( p + base, &block );
       }
       else
       {
-        stream->SetError( "String expected" );
-      }
-
-      JsnEatSpace( stream );
-      int c = stream->Peek();
-      if( c == ':' )
-      {
-        stream->Read(); // Skip colon
-        JsnEatSpace( stream );
-        ParseValue( reader, stream, name );
+        JsnClassifyPartialBlock( p + base, ( int )( length - base ), &block );
       }
-      else
+      uint64_t quotes;
+      uint64_t in_string = strings.Next( block, &quotes );
+      uint64_t structural = block.m_Structural & ~in_string;
+      while( structural )
       {
-        stream->SetError( "\":\" expected" );
+        int64_t position = base + JsnCountTrailingZeros( structural );
+        structural &= structural - 1;
+        switch( p[ position ] )
+        {
+          case '{':
+          case '[':
+            depth += 1;
+            break;
+          case '}':
+          case ']':
+            if( --depth == 0 )
+            {
+              stream->Seek( position + 1 );
+              return;
+            }
+            break;
+          default:
+            break;
+        }
       }
-      JsnEatSpace( stream );
     }
   }
-  while( !stream->GetError() && stream->Peek() == ',' );
-
-  if( stream->Read() != '}' )
-  {
-    stream->Unread();
-    stream->SetError( "\"}\" expected" );
-  }
+  stream->Seek( length );
+  stream->SetError( "Unexpected end of input data" );
 }
 
-static void ParseArray( JsnHandler* reader, JsnStreamIn* stream )
+// Move m_Cursor past the object or array at the next position. Nothing inside strings is indexed, so strings
+// take no time at all.
+bool JsnParseContext::IndexedSkipContainer()
 {
-  do
+  const uint64_t* positions = m_Positions;
+  int64_t depth = 0;
+  for( int64_t i = m_Cursor; ( int64_t )positions[ i ] < m_End; ++i )
   {
-    stream->Read(); // Skip open bracket or comma
-    JsnEatSpace( stream );
-    if( stream->Peek() != ']' )
+    switch( m_Text[ positions[ i ] ] )
     {
-      ParseValue( reader, stream, JsnFragment() );
-      JsnEatSpace( stream );
+      case '{':
+      case '[':
+        depth += 1;
+        break;
+      case '}':
+      case ']':
+        if( --depth == 0 )
+        {
+          m_Cursor = i + 1;
+          return true;
+        }
+        break;
+      default:
+        break;
     }
   }
-  while( !stream->GetError() && stream->Peek() == ',' );
-
-  if( stream->Read() != ']' )
-  {
-    stream->Unread();
-    stream->SetError( "\"]\" expected" );
-  }
+  return false;
 }
 
-static void ParseValue( JsnHandler* reader, JsnStreamIn* stream, const JsnFragment& name )
+// Move m_Cursor past the value at the next position, without calling the handler.
+void JsnParseContext::IndexedSkipValue()
 {
-  switch( stream->Peek() )
+  JsnFragment number;
+  switch( IndexedPeek() )
   {
+    case '{':
+    case '[':
+      if( !IndexedSkipContainer() )
+      {
+        IndexedError( "Unexpected end of input data" );
+      }
+      break;
+
+    case '"':
+      IndexedString();
+      break;
+
     case 't':
-      ParseTrue( stream );
-      reader->AddProperty( name, JsnFragment( kJsn_True ) );
+      IndexedLiteral( "true", 4 );
       break;
 
     case 'f':
-      ParseFalse( stream );
-      reader->AddProperty( name, JsnFragment( kJsn_False ) );
+      IndexedLiteral( "false", 5 );
       break;
 
     case 'n':
-      ParseNull( stream );
-      reader->AddProperty( name, JsnFragment( kJsn_Null ) );
+      IndexedLiteral( "null", 4 );
       break;
 
-    case '"':
-    {
-      JsnFragment value = ParseString( stream );
-      reader->AddProperty( name, value );
-      break;
-    }
-
     case '-':
     case '.':
     case '0':
@@ -312,27 +414,97 @@ static void ParseValue( JsnHandler* reader, JsnStreamIn* stream, const JsnFragme
     case '7':
     case '8':
     case '9':
-    {
-      JsnFragment value = ParseNumber( stream );
-      reader->AddProperty( name, value );
+      IndexedNumber( &number );
       break;
-    }
 
-    case '[':
-    {
-      JsnHandler* child_reader = reader->BeginArray( name );
-      ParseArray( child_reader, stream );
-      reader->EndArray( child_reader );
+    default:
+      IndexedError( "Unexpected character" );
       break;
+  }
+}
+
+// Report an error at the next position.
+void JsnParseContext::IndexedError( const char* error )
+{
+  int64_t position = ( int64_t )m_Positions[ m_Cursor ];
+  m_Stream->Seek( position < m_End ? position : m_End );
+  m_Stream->SetError( error );
+}
+
+// Move the stream after the last token that was parsed. A structural character or quote is one character, and
+// a number or literal runs up to whitespace or the next position.
+void JsnParseContext::IndexedFinish()
+{
+  if( m_Stream->GetError() || !m_Cursor )
+  {
+    return;
+  }
+  if( m_Stop )
+  {
+    // Stopped before the next token, as the plain parse does
+    int64_t next = ( int64_t )m_Positions[ m_Cursor ];
+    m_Stream->Seek( next < m_End ? next : m_End );
+    return;
+  }
+  int64_t end = ( int64_t )m_Positions[ m_Cursor - 1 ];
+  if( end < m_Stream->GetCount() )
+  {
+    return; // Nothing parsed
+  }
+  char c = m_Text[ end ];
+  end += 1;
+  if( !strchr( "{}[]:,\"", c ) )
+  {
+    int64_t next = ( int64_t )m_Positions[ m_Cursor ];
+    while( end < next && end < m_End && ( uint8_t )m_Text[ end ] > ' ' )
+    {
+      end += 1;
     }
+  }
+  m_Stream->Seek( end );
+}
 
+// Move past the value at the read position, without calling the handler.
+void JsnParseContext::SkipValue()
+{
+  JsnStreamIn* stream = m_Stream;
+  switch( stream->Peek() )
+  {
     case '{':
-    {
-      JsnHandler* child_reader = reader->BeginObject( name );
-      ParseObject( child_reader, stream );
-      reader->EndObject( child_reader );
+    case '[':
+      SkipContainer();
+      break;
+
+    case '"':
+      ParseString();
+      break;
+
+    case 't':
+      ParseLiteral( "true" );
+      break;
+
+    case 'f':
+      ParseLiteral( "false" );
+      break;
+
+    case 'n':
+      ParseLiteral( "null" );
+      break;
+
+    case '-':
+    case '.':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      ParseNumber();
       break;
-    }
 
     default:
       stream->SetError( "Unexpected character" );
@@ -340,56 +512,50 @@ static void ParseValue( JsnHandler* reader, JsnStreamIn* stream, const JsnFragme
   }
 }
 
-bool JsnParse( JsnHandler* reader, JsnStreamIn* stream )
+// Return the path filter state of a property value.
+int JsnParseContext::NextState( int state, const JsnFragment& name )
 {
-  ParseValue( reader, stream, JsnFragment() );
-  return !stream->GetError();
+  if( state < 0 )
+  {
+    return state;
+  }
+  // Paths hold decoded names. A name with an invalid escape sequence is matched as it is.
+  DecodedName decoded( name );
+  return m_Filter->Next( state, decoded.m_Text, decoded.m_Length );
 }
 
-static void WriteStringChar( JsnStreamOut* write_stream, JsnStreamIn* read_stream, bool escape )
+int JsnParseContext::NextIndexState( int state, int64_t index )
 {
-  int codepoint1 = JsnReadUTF8Char( read_stream );
+  return m_Filter->NextIndex( state, index );
+}
 
-  if( read_stream->GetError() )
-  {
-    return;
-  }
+bool JsnParse( JsnHandler* reader, JsnStreamIn* stream )
+{
+  return JsnParse( reader, stream, NULL );
+}
 
-  if( codepoint1 == '\\' )
-  {
-    int codepoint2 = JsnReadUTF8Char( read_stream );
-    switch( codepoint2 )
-    {
-      case '"':
-      case '\\':
-      case '/':
-      case 'b':
-      case 'f':
-      case 'n':
-      case 'r':
-      case 't':
-      case 'u':
-        // Recognized backslash combo. Write complete combo not just backslash
-        write_stream->Write( codepoint1 );
-        write_stream->Write( codepoint2 );
-        break;
+bool JsnParse( JsnHandler* reader, JsnStreamIn* stream, const JsnIndex* index )
+{
+  JsnParseOptions options;
+  options.m_Index = index;
+  return JsnParse( reader, stream, options );
+}
 
-      default:
-        // Must escape backslash followed by anything else. It's not a combo
-        write_stream->Write( '\\' );
-        write_stream->Write( '\\' );
-        read_stream->Unread();  // Didn't consume second code
-        break;
-    }
-  }
-  else if( codepoint1 == '"' )
+bool JsnParse( JsnHandler* reader, JsnStreamIn* stream, const JsnParseOptions& options )
+{
+  return JsnParse< JsnHandler >( reader, stream, options );
+}
+
+static void WriteCodepoint( JsnStreamOut* write_stream, int codepoint, bool escape )
+{
+  if( codepoint == '"' || codepoint == '\\' )
   {
     write_stream->Write( '\\' );
-    write_stream->Write( '"' );
+    write_stream->Write( codepoint );
   }
-  else if( codepoint1 < 0x20 )
+  else if( codepoint < 0x20 )
   {
-    switch( codepoint1 )
+    switch( codepoint )
     {
       case '\b':
         write_stream->WriteStr( "\\b" );
@@ -407,43 +573,179 @@ static void WriteStringChar( JsnStreamOut* write_stream, JsnStreamIn* read_strea
         write_stream->WriteStr( "\\t" );
         break;
       default:
-        JsnWriteEscapedUTF8Char( write_stream, codepoint1 );
+        JsnWriteEscapedUTF8Char( write_stream, codepoint );
         break;
     }
   }
-  else if( codepoint1 >= 0x80 && escape )
+  else if( ( codepoint >= 0x80 && escape ) || ( codepoint >= 0xD800 && codepoint <= 0xDFFF ) )
   {
-    JsnWriteEscapedUTF8Char( write_stream, codepoint1 );
+    // An unpaired surrogate can only be written as an escape
+    JsnWriteEscapedUTF8Char( write_stream, codepoint );
   }
   else
   {
-    JsnWriteUnescapedUTF8Char( write_stream, codepoint1 );
+    JsnWriteUnescapedUTF8Char( write_stream, codepoint );
   }
 }
 
-void JsnWriter::WriteFragment( const JsnFragment& fragment )
+static void WriteStringChar( JsnStreamOut* write_stream, JsnStreamIn* read_stream, bool escape )
+{
+  int next = read_stream->Peek( 1 );
+  if( read_stream->Peek() == '\\' && next != 'u' && next != 'U' )
+  {
+    // Look at the raw character after the backslash. Decoding it would take "\\u0041" for an escape.
+    read_stream->Read();
+    switch( next )
+    {
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        // Recognized backslash combo. Write complete combo not just backslash
+        write_stream->Write( '\\' );
+        write_stream->Write( read_stream->Read() );
+        break;
+
+      default:
+        // Must escape backslash followed by anything else, or by nothing. It's not a combo
+        write_stream->Write( '\\' );
+        write_stream->Write( '\\' );
+        break;
+    }
+    return;
+  }
+
+  int codepoint = JsnReadUTF8Char( read_stream );
+  if( !read_stream->GetError() )
+  {
+    WriteCodepoint( write_stream, codepoint, escape );
+  }
+}
+
+// Write one character of decoded text. Unlike in JSON text, a backslash is just a backslash.
+static void WriteDecodedChar( JsnStreamOut* write_stream, JsnStreamIn* read_stream, bool escape )
 {
-  JsnStreamIn read_stream( fragment.m_Text, fragment.m_Length );
-  while( !m_Stream->GetError() && read_stream.Peek() != -1 )
+  if( read_stream->Peek() == '\\' )
+  {
+    read_stream->Read();
+    write_stream->WriteStr( "\\\\" );
+    return;
+  }
+  int codepoint = JsnReadUTF8Char( read_stream );
+  if( !read_stream->GetError() )
   {
-    m_Stream->Write( read_stream.Read() );
+    WriteCodepoint( write_stream, codepoint, escape );
   }
 }
 
+void JsnWriter::WriteFragment( const JsnFragment& fragment )
+{
+  m_Stream->Write( fragment.m_Text, fragment.m_Length );
+}
+
 void JsnWriter::WriteFragmentString( const JsnFragment& fragment )
 {
-  JsnStreamIn read_stream( fragment.m_Text, fragment.m_Length );
+  const char* text = fragment.m_Text;
+  const char* end = text + fragment.m_Length;
+  bool escape = m_Style->m_EscapeUTF8;
+  bool decoded = ( fragment.m_Flags & kJsnFlag_Unescaped ) != 0;
+  JsnStreamIn read_stream( text, end );
+  JSN_STATS( int64_t sequences = 0; )
   m_Stream->Write( '"' );
-  while( !read_stream.GetError() && !m_Stream->GetError() && read_stream.Peek() )
+  while( !read_stream.GetError() && !m_Stream->GetError() )
+  {
+    // Copy everything up to the next character that needs attention in one go
+    const char* run = read_stream.GetCurrent();
+    const char* run_end = JsnFindEscape( run, end, escape );
+    m_Stream->Write( run, run_end - run );
+    if( run_end == end || ( !*run_end && !decoded ) )
+    {
+      break;
+    }
+    read_stream.Seek( run_end - text );
+    JSN_STATS( sequences += 1; )
+    if( decoded )
+    {
+      WriteDecodedChar( m_Stream, &read_stream, escape );
+    }
+    else
+    {
+      WriteStringChar( m_Stream, &read_stream, escape );
+    }
+  }
+  if( read_stream.GetError() )
   {
-    WriteStringChar( m_Stream, &read_stream, m_Style->m_EscapeUTF8 );
+    m_Stream->SetError( read_stream.GetError() ); // Don't truncate silently
   }
   m_Stream->Write( '"' );
+#if JSN_ENABLE_STATS
+  if( m_Stats )
+  {
+    if( fragment.m_Length > m_Stats->m_LongestString )
+    {
+      m_Stats->m_LongestString = fragment.m_Length;
+    }
+    m_Stats->m_EscapedStrings += sequences != 0;
+    m_Stats->m_EscapeSequences += sequences;
+  }
+#endif
+}
+
+void JsnWriter::WriteFragmentNumber( const JsnFragment& fragment )
+{
+  if( fragment.m_Text || !( fragment.m_Flags & kJsnFlag_Decoded ) )
+  {
+    WriteFragment( fragment );
+  }
+  else if( fragment.m_Type == kJsn_Int )
+  {
+    JSN_STATS( if( m_Stats ) { m_Stats->m_NumbersConverted += 1; } )
+    JsnWriteInt( m_Stream, fragment.m_Value.i );
+  }
+  else
+  {
+    JSN_STATS( if( m_Stats ) { m_Stats->m_NumbersConverted += 1; } )
+    JsnWriteFloat( m_Stream, fragment.m_Value.f );
+  }
+}
+
+JsnWriter::Frame* JsnWriter::Top()
+{
+  // Past the maximum depth the stream is in error, and nothing gets written. Just keep counting.
+  return &m_Frames[ m_Depth <= JSN_WRITER_MAX_DEPTH ? m_Depth : JSN_WRITER_MAX_DEPTH ];
+}
+
+void JsnWriter::Push()
+{
+  m_Depth += 1;
+  if( m_Depth > JSN_WRITER_MAX_DEPTH )
+  {
+    m_Stream->SetError( "Nesting too deep for JsnWriter" );
+  }
+#if JSN_ENABLE_STATS
+  if( m_Stats && m_Depth > m_Stats->m_MaxDepth )
+  {
+    m_Stats->m_MaxDepth = m_Depth;
+  }
+#endif
+  Top()->m_ValueCount = 0;
+}
+
+void JsnWriter::Pop()
+{
+  if( m_Depth )
+  {
+    m_Depth -= 1;
+  }
 }
 
 void JsnWriter::WriteIndent()
 {
-  for( int i = 0; i < m_IndentLevel; ++i )
+  for( int i = 0; i < m_Depth; ++i )
   {
     WriteFragment( m_Style->m_IndentString );
   }
@@ -451,16 +753,17 @@ void JsnWriter::WriteIndent()
 
 void JsnWriter::WriteProperty( const JsnFragment& name, const JsnFragment& value )
 {
-  if( m_IndentLevel )
+  Frame* frame = Top();
+  if( m_Depth )
   {
-    if( m_ValueCount )
+    if( frame->m_ValueCount )
     {
       WriteFragment( "," );
     }
     WriteFragment( m_Style->m_NewlineString );
     WriteIndent();
   }
-  if( name.m_Length )
+  if( name.m_Length || name.m_Type == kJsn_String ) // Array elements have no name, but "" is a name
   {
     WriteFragmentString( name );
     WriteFragment( ":" );
@@ -470,15 +773,20 @@ void JsnWriter::WriteProperty( const JsnFragment& name, const JsnFragment& value
   {
     WriteFragmentString( value );
   }
+  else if( value.m_Type == kJsn_Int || value.m_Type == kJsn_Float )
+  {
+    WriteFragmentNumber( value );
+  }
   else
   {
     WriteFragment( value );
   }
-  m_ValueCount += 1;
+  frame->m_ValueCount += 1;
 }
 
 void JsnWriter::AddProperty( const JsnFragment& name, const JsnFragment& value )
 {
+  JSN_STATS( int64_t count = m_Stream->GetCount(); )
   switch( value.m_Type )
   {
     case kJsn_Int:
@@ -499,40 +807,64 @@ void JsnWriter::AddProperty( const JsnFragment& name, const JsnFragment& value )
     default:
       break;
   }
+  JSN_STATS( StatsWrite( value.m_Type, count ); )
 }
 
 JsnHandler* JsnWriter::BeginObject( const JsnFragment& name )
 {
+  JSN_STATS( int64_t count = m_Stream->GetCount(); )
   WriteProperty( name, "{" );
-  return new JsnWriter( *this );
+  Push();
+  JSN_STATS( StatsWrite( kJsn_Object, count ); )
+  return this;
 }
 
-void JsnWriter::EndObject( JsnHandler* byoc )
+void JsnWriter::EndObject( JsnHandler* )
 {
+  JSN_STATS( int64_t count = m_Stream->GetCount(); )
+  Pop();
   WriteFragment( m_Style->m_NewlineString );
   WriteIndent();
   WriteFragment( "}" );
-  if( !m_IndentLevel )
+  if( !m_Depth )
   {
     WriteFragment( m_Style->m_NewlineString );
   }
-  delete byoc;
+  JSN_STATS( StatsWrite( kJsn_Undefined, count ); )
 }
 
 JsnHandler* JsnWriter::BeginArray( const JsnFragment& name )
 {
+  JSN_STATS( int64_t count = m_Stream->GetCount(); )
   WriteProperty( name, "[" );
-  return new JsnWriter( *this );
+  Push();
+  JSN_STATS( StatsWrite( kJsn_Array, count ); )
+  return this;
 }
 
-void JsnWriter::EndArray( JsnHandler* byoc )
+void JsnWriter::EndArray( JsnHandler* )
 {
+  JSN_STATS( int64_t count = m_Stream->GetCount(); )
+  Pop();
   WriteFragment( m_Style->m_NewlineString );
   WriteIndent();
   WriteFragment( "]" );
-  delete byoc;
+  JSN_STATS( StatsWrite( kJsn_Undefined, count ); )
 }
 
+#if JSN_ENABLE_STATS
+// Add the bytes written since count, and count a value of the given type. EndObject() and EndArray() pass
+// kJsn_Undefined: their container was counted at the start.
+void JsnWriter::StatsWrite( JsnType type, int64_t count )
+{
+  if( m_Stats )
+  {
+    m_Stats->m_Bytes += m_Stream->GetCount() - count;
+    m_Stats->m_Counts[ type ] += type != kJsn_Undefined;
+  }
+}
+#endif
+
 JsnWriter::Style::Style()
 : m_IndentString( "  " )
 , m_NewlineString( "\n" )
@@ -546,13 +878,42 @@ static JsnWriter::Style g_DefaultStyle;
 JsnWriter::JsnWriter( JsnStreamOut* stream, const Style* style )
 : m_Stream( stream )
 , m_Style( style ? style : &g_DefaultStyle )
-, m_IndentLevel( 0 )
-, m_ValueCount( 0 )
-{}
+, m_Depth( 0 )
+, m_Stats( NULL )
+{
+  m_Frames[ 0 ].m_ValueCount = 0;
+}
 
-JsnWriter::JsnWriter( const JsnWriter& other )
-: m_Stream( other.m_Stream )
-, m_Style( other.m_Style )
-, m_IndentLevel( other.m_IndentLevel + 1 )
-, m_ValueCount( 0 )
-{}
+/****************************************************************************************************************/
+
+void JsnStats::Clear()
+{
+  m_Bytes = 0;
+  for( int i = 0; i <= kJsn_Array; ++i )
+  {
+    m_Counts[ i ] = 0;
+  }
+  m_MaxDepth = 0;
+  m_EscapedStrings = 0;
+  m_EscapeSequences = 0;
+  m_LongestString = 0;
+  m_NumbersConverted = 0;
+  m_ParseNanoseconds = 0;
+  m_HandlerNanoseconds = 0;
+}
+
+void JsnStats::Add( const JsnStats& other )
+{
+  m_Bytes += other.m_Bytes;
+  for( int i = 0; i <= kJsn_Array; ++i )
+  {
+    m_Counts[ i ] += other.m_Counts[ i ];
+  }
+  m_MaxDepth = other.m_MaxDepth > m_MaxDepth ? other.m_MaxDepth : m_MaxDepth;
+  m_EscapedStrings += other.m_EscapedStrings;
+  m_EscapeSequences += other.m_EscapeSequences;
+  m_LongestString = other.m_LongestString > m_LongestString ? other.m_LongestString : m_LongestString;
+  m_NumbersConverted += other.m_NumbersConverted;
+  m_ParseNanoseconds += other.m_ParseNanoseconds;
+  m_HandlerNanoseconds += other.m_HandlerNanoseconds;
+}
@@ -49,6 +49,24 @@ enum JsnType
   kJsn_Array      /**< JSON type array */
 };
 
+/************************************************************************************************************/ /**
+ \enum JsnFlags
+ Extra information about a JsnFragment. Combine with bitwise or.
+ */
+enum JsnFlags
+{
+  kJsnFlag_Decoded   = 1 << 0, /**< m_Value holds the decoded number (only for types kJsn_Int, kJsn_Float) */
+  kJsnFlag_Escaped   = 1 << 1, /**< The JSON text of the string contained escape sequences (only for type
+                                kJsn_String) */
+  kJsnFlag_Unescaped = 1 << 2, /**< m_Text holds the decoded string, not the JSON text. It may contain any
+                                character, including '"', '\\' and zero. See JsnParseOptions::m_UnescapeInPlace
+                                (only for type kJsn_String) */
+  kJsnFlag_Hashed    = 1 << 3, /**< m_Value holds the hash of the decoded name. See JsnParseOptions::m_HashKeys
+                                (only for property names) */
+  kJsnFlag_KeyId     = 1 << 4  /**< m_Value holds the ID of the name in a JsnKeyDictionary. See
+                                JsnParseOptions::m_Keys (only for property names) */
+};
+
 /**
  \struct JsnFragment
  Represents a text fragment of the input JSON text. Note that the fragment text is NOT a zero-terminated
@@ -57,8 +75,21 @@ enum JsnType
 struct JsnFragment
 {
   const char* m_Text;   /**< Start of the fragment text (only for types kJsn_String, kJsn_Float, kJsn_Int) */
-  int         m_Length; /**< Length of the fragment text */
+  int64_t     m_Length; /**< Length of the fragment text */
   JsnType     m_Type;   /**< Type of the fragment */
+  uint32_t    m_Flags;  /**< Combination of JsnFlags */
+  union
+  {
+    double    f;
+    int64_t   i;
+    struct
+    {
+      uint32_t hash;
+      int32_t  id;
+    }         key;
+  }           m_Value;  /**< Decoded number, if m_Flags contains kJsnFlag_Decoded, or the hash and ID of a
+                         property name. Use AsInt(), AsFloat(), GetKeyHash() and GetKeyId() rather than
+                         reading this directly. */
 
   /**
    Construct from text and length.
@@ -66,11 +97,14 @@ struct JsnFragment
    \param[ in ] text Start of text, not necessarily zero terminated
    \param[ in ] length Length of text string
    */
-  JsnFragment( JsnType t, const char* text, int length )
+  JsnFragment( JsnType t, const char* text, int64_t length )
   : m_Text( text )
   , m_Length( length )
   , m_Type( t )
-  {}
+  , m_Flags( 0 )
+  {
+    m_Value.i = 0;
+  }
 
   /**
    Construct from text start and end pointer.
@@ -80,9 +114,12 @@ struct JsnFragment
    */
   JsnFragment( JsnType t, const char* text, const char* end )
   : m_Text( text )
-  , m_Length( ( int )( end - text ) )
+  , m_Length( ( int64_t )( end - text ) )
   , m_Type( t )
-  {}
+  , m_Flags( 0 )
+  {
+    m_Value.i = 0;
+  }
 
   /**
    Construct from zero terminated text string.
@@ -91,9 +128,12 @@ struct JsnFragment
    */
   JsnFragment( JsnType t, const char* text )
   : m_Text( text )
-  , m_Length( text ? ( int )strlen( text ) : 0 )
+  , m_Length( text ? ( int64_t )strlen( text ) : 0 )
   , m_Type( t )
-  {}
+  , m_Flags( 0 )
+  {
+    m_Value.i = 0;
+  }
 
   /**
    Construct from zero terminated text string. Type will be undefined. This is used for helper strings,
@@ -102,9 +142,12 @@ struct JsnFragment
    */
   JsnFragment( const char* text )
   : m_Text( text )
-  , m_Length( text ? ( int )strlen( text ) : 0 )
+  , m_Length( text ? ( int64_t )strlen( text ) : 0 )
   , m_Type( kJsn_Undefined )
-  {}
+  , m_Flags( 0 )
+  {
+    m_Value.i = 0;
+  }
 
   /**
    Copy constructor.
@@ -114,6 +157,8 @@ struct JsnFragment
   : m_Text( other.m_Text )
   , m_Length( other.m_Length )
   , m_Type( other.m_Type )
+  , m_Flags( other.m_Flags )
+  , m_Value( other.m_Value )
   {}
 
   /**
@@ -124,24 +169,67 @@ struct JsnFragment
   : m_Text( NULL )
   , m_Length( 0 )
   , m_Type( t )
-  {}
+  , m_Flags( 0 )
+  {
+    m_Value.i = 0;
+  }
 
   /**
-   Interpret fragment as double precision float using `atof()`
+   Interpret fragment as double precision float. Returns the value decoded by the parser if there is one,
+   or decodes the text otherwise.
    */
   double AsFloat() const;
   /**
-   Interpret fragment as integer using `atod()`
+   Interpret fragment as integer. Returns the value decoded by the parser if there is one, or decodes the
+   text otherwise. Floats are truncated toward zero, and limited to the int64_t range.
    */
   int64_t AsInt() const;
 
+  /**
+   Return the hash of a property name, as computed by JsnHashKey() over the decoded name. The parser stores it
+   with the name if JsnParseOptions::m_HashKeys is set. Otherwise it is computed here.
+   */
+  uint32_t GetKeyHash() const { return ( m_Flags & kJsnFlag_Hashed ) ? m_Value.key.hash : HashKey(); }
+
+  /**
+   Return the ID of a property name in the JsnKeyDictionary passed in JsnParseOptions::m_Keys.
+   \return ID, or -1 if the name is not in the dictionary, or no dictionary was used.
+   */
+  int GetKeyId() const { return ( m_Flags & kJsnFlag_KeyId ) ? m_Value.key.id : -1; }
+
+  /**
+   Compute JsnHashKey() of the decoded text.
+   */
+  uint32_t HashKey() const;
+
+  /**
+   Compare a property name with decoded text. A name with escape sequences is decoded first.
+   \param[ in ] text Text to compare with, not necessarily zero terminated.
+   \param[ in ] length Length of text.
+   \return true if equal.
+   */
+  bool IsKey( const char* text, int64_t length ) const
+  {
+    if( ( m_Flags & kJsnFlag_Escaped ) && !( m_Flags & kJsnFlag_Unescaped ) )
+    {
+      return IsEscapedKey( text, length );
+    }
+    return m_Length == length && memcmp( m_Text, text, ( size_t )length ) == 0;
+  }
+
+  /**
+   IsKey() for a name with escape sequences.
+   */
+  bool IsEscapedKey( const char* text, int64_t length ) const;
+
   /**
    Assignment from string.
    */
   JsnFragment& operator=( const char* text )
   {
     m_Text    = text;
-    m_Length  = text ? ( int )strlen( text ) : 0;
+    m_Length  = text ? ( int64_t )strlen( text ) : 0;
+    m_Flags   = 0;
     return *this;
   }
 
@@ -153,6 +241,8 @@ struct JsnFragment
     m_Text    = rhs.m_Text;
     m_Length  = rhs.m_Length;
     m_Type    = rhs.m_Type;
+    m_Flags   = rhs.m_Flags;
+    m_Value   = rhs.m_Value;
     return *this;
   }
 
@@ -175,6 +265,22 @@ struct JsnFragment
    \return Fragment
    */
   static JsnFragment FromInt( char* buf25, int buf_size, int64_t value );
+
+  /**
+   Build from a double precision float, without text. The value is carried in m_Value, and JsnWriter
+   formats it straight into its output stream. Other handlers should use AsFloat().
+   \param[ in ] value The value to be represented.
+   \return Fragment
+   */
+  static JsnFragment FromFloat( double value );
+
+  /**
+   Build from an integer, without text. The value is carried in m_Value, and JsnWriter formats it
+   straight into its output stream. Other handlers should use AsInt().
+   \param[ in ] value The value to be represented.
+   \return Fragment
+   */
+  static JsnFragment FromInt( int64_t value );
 };
 
 /************************************************************************************************************/ /**
@@ -183,11 +289,19 @@ struct JsnFragment
  responsible for building one object or array. It will be passed properties through AddProperty(),
  nested objects through BeginObject()/EndObject(), and/or nested arrays through
  BeginArray()/EndArray().
+
+ A handler that is not interested in a nested object or array can return NULL from BeginObject() or
+ BeginArray(). The parser then skips to the matching bracket, without looking at the contents, and
+ EndObject() or EndArray() is not called. A handler that has everything it needs can call RequestStop().
  */
 class JsnHandler
 {
 public:
 
+  JsnHandler()
+  : m_StopRequested( false )
+  {}
+
   /**
    Add a new property to the object or array that this handler represents.
    \param[ in ] name Name of the property. This will be empty if this is an array element.
@@ -197,7 +311,7 @@ public:
   /**
    Add a new nested object to the object or array that this handler represents.
    \param[ in ] name Name of the object. This will be empty if this is an array element.
-   \return Handler that will receive properties of the nested object.
+   \return Handler that will receive properties of the nested object, or NULL to skip the object.
    */
   virtual JsnHandler* BeginObject( const JsnFragment& name ) = 0;
   /**
@@ -209,7 +323,7 @@ public:
   /**
    Add a new nested array to the object or array that this handler represents.
    \param[ in ] name Name of the array. This will be empty if this is an array element.
-   \return Handler that will receive elements of the nested array.
+   \return Handler that will receive elements of the nested array, or NULL to skip the array.
    */
   virtual JsnHandler* BeginArray( const JsnFragment& name ) = 0;
   /**
@@ -220,13 +334,104 @@ public:
   virtual void        EndArray( JsnHandler* handler ) = 0;
 
   virtual ~JsnHandler() {}
+
+  /**
+   Ask the parser to stop when the current call returns. This is not an error: the parse succeeds, objects
+   and arrays that are still open get their EndObject() and EndArray() calls, and the rest of the text is
+   not looked at. Call from any of the members above.
+   */
+  void RequestStop() { m_StopRequested = true; }
+
+  /**
+   Return whether RequestStop() was called. The parser clears the request when it stops.
+   \return true if a stop was requested.
+   */
+  bool IsStopRequested() const { return m_StopRequested; }
+
+  /**
+   Clear a request made with RequestStop().
+   */
+  void ClearStopRequest() { m_StopRequested = false; }
+
+private:
+
+  bool m_StopRequested;
+};
+
+/**
+ Set to 1 to have JsnParse() and JsnWriter fill in a JsnStats. With the default of 0, the code that
+ gathers statistics is not compiled at all. The library and the code that includes its headers must be
+ built with the same setting, so define it for the whole project rather than before an include.
+ */
+#ifndef JSN_ENABLE_STATS
+#define JSN_ENABLE_STATS 0
+#endif
+
+/**
+ Compile the argument only when statistics are enabled.
+ */
+#if JSN_ENABLE_STATS
+#define JSN_STATS( ... ) __VA_ARGS__
+#else
+#define JSN_STATS( ... )
+#endif
+
+/************************************************************************************************************/ /**
+ \struct JsnStats
+ Statistics gathered by JsnParse() and JsnWriter, to find out where the time goes. Pass one in
+ JsnParseOptions::m_Stats, or to JsnWriter::SetStats(). Counts add up over all calls until Clear(). Nothing
+ is gathered unless the library is built with JSN_ENABLE_STATS set to 1.
+
+ Values that the parser skips, because a handler returned NULL or a path filter did not match, are
+ consumed but not counted. Timing uses a clock read around every handler call, which costs some speed by
+ itself. Compare the two times with each other, rather than with a parse without statistics.
+ */
+struct JsnStats
+{
+  int64_t m_Bytes;            /**< Bytes of JSON text consumed or written. */
+  int64_t m_Counts[ kJsn_Array + 1 ]; /**< Values passed to or written by the handler, indexed by JsnType.
+                               Objects and arrays are counted once, at BeginObject() or BeginArray(). */
+  int     m_MaxDepth;         /**< Deepest nesting of objects and arrays. The top level value is at depth 1. */
+  int64_t m_EscapedStrings;   /**< Strings and names with at least one escape sequence. */
+  int64_t m_EscapeSequences;  /**< Escape sequences in all strings and names. */
+  int64_t m_LongestString;    /**< Length in bytes of the longest string or name, as JSON text for the parser
+                               and as passed in for JsnWriter. */
+  int64_t m_NumbersConverted; /**< Numbers decoded from text by the parser, or formatted from a value without
+                               text by JsnWriter. */
+  int64_t m_ParseNanoseconds; /**< Time spent in JsnParse(), not counting the handler calls. */
+  int64_t m_HandlerNanoseconds; /**< Time spent in handler calls made by JsnParse(). */
+
+  JsnStats() { Clear(); }
+
+  /**
+   Set all counts to zero.
+   */
+  void Clear();
+
+  /**
+   Add the counts of other statistics to these. Used to combine statistics gathered by separate threads.
+   \param[ in ] other Statistics to add.
+   */
+  void Add( const JsnStats& other );
 };
 
+/**
+ Maximum nesting depth of objects and arrays that JsnWriter and JsnCborWriter can write. Deeper nesting sets
+ an error on the output stream. Define before including this header to change it.
+ */
+#ifndef JSN_WRITER_MAX_DEPTH
+#define JSN_WRITER_MAX_DEPTH 256
+#endif
+
 /************************************************************************************************************/ /**
  \class JsnWriter
  Used to format your data in valid JSON. Implements JsnHandler. You are expected to iterate through your
  data and call the JsnWriter members in more or less the same order as it was built (or would build it)
  with JsnHandler. See proveded example code JsnExample::Value::Write().
+ One JsnWriter handles all nesting levels: BeginObject() and BeginArray() return the writer itself, and
+ keep track of the nesting in a fixed size stack. Nothing is allocated while writing.
+ A name is written when it is not empty, or when it is of type kJsn_String, as names from JsnParse() are.
+ That way a property named "" is written as it was read.
  */
 class JsnWriter final : public JsnHandler
 {
@@ -265,24 +470,103 @@ public:
   virtual JsnHandler* BeginArray( const JsnFragment& name ) override;
   virtual void        EndArray( JsnHandler* byoc ) override;
 
+  /**
+   Gather statistics of everything written from here on. See JsnStats.
+   \param[ in ] stats Statistics to add to, or NULL to stop gathering.
+   */
+  void SetStats( JsnStats* stats ) { m_Stats = stats; }
+
 private:
 
+  struct Frame
+  {
+    int           m_ValueCount;
+  };
+
   JsnStreamOut*   m_Stream;
   const Style*    m_Style;
-  const int       m_IndentLevel;
-  int             m_ValueCount;
+  int             m_Depth;
+  JsnStats*       m_Stats;
+  Frame           m_Frames[ JSN_WRITER_MAX_DEPTH + 1 ]; // Top level, then one per nesting level
 
   JsnWriter( const JsnWriter& other );
+  Frame* Top();
+  void Push();
+  void Pop();
   void WriteFragment( const JsnFragment& fragment );
   void WriteFragmentString( const JsnFragment& fragment );
+  void WriteFragmentNumber( const JsnFragment& fragment );
   void WriteIndent();
   void WriteProperty( const JsnFragment& name, const JsnFragment& value );
+#if JSN_ENABLE_STATS
+  void StatsWrite( JsnType type, int64_t count );
+#endif
 };
 
+class JsnIndex;
+class JsnKeyDictionary;
+class JsnPathFilter;
+
 /************************************************************************************************************/ /**
  Parse the input stream, call members of the handler implementation as elements in teh text are
  detected.
  */
 bool JsnParse( JsnHandler* reader, JsnStreamIn* stream );
 
+/************************************************************************************************************/ /**
+ Parse the input stream with the help of a structural index, built from the same text with
+ JsnIndex::Build(). The handler receives exactly the same calls as without the index.
+ \param[ in ] reader Handler implementation.
+ \param[ in ] stream Input stream.
+ \param[ in ] index Structural index of the stream's text, or NULL to parse without index.
+ \return true if successful, false if not. Call stream->GetError() for details.
+ */
+bool JsnParse( JsnHandler* reader, JsnStreamIn* stream, const JsnIndex* index );
+
+/************************************************************************************************************/ /**
+ \struct JsnParseOptions
+ Optional settings for JsnParse().
+ */
+struct JsnParseOptions
+{
+  const JsnIndex* m_Index;        /**< Structural index of the stream's text, built with JsnIndex::Build(), or
+                                   NULL to parse without index. */
+  bool            m_ValidateUTF8; /**< Check that the input is valid UTF-8 before parsing. If it is not, no
+                                   handler members are called, the stream error is set, and the stream is
+                                   positioned at the offending byte. GetCount() gives its offset. */
+  bool            m_UnescapeInPlace; /**< Decode escape sequences in strings and names before they are passed
+                                      to the handler, by overwriting the input text. The decoded text is never
+                                      longer than the original. Fragments get the kJsnFlag_Unescaped flag.
+                                      The stream's text must be writable: not a string literal, and not a
+                                      JsnFileIn. */
+  const JsnPathFilter* m_Filter;  /**< Only pass values that match one of the filter's paths to the handler,
+                                   or NULL to pass everything. See JsnPathFilter. */
+  bool            m_HashKeys;     /**< Hash every property name while it is in cache, and store the hash with
+                                   the name fragment. See JsnFragment::GetKeyHash(). */
+  const JsnKeyDictionary* m_Keys; /**< Look up every property name in this dictionary, and store the ID with
+                                   the name fragment, or NULL. Implies m_HashKeys. See JsnKeyDictionary. */
+  JsnStats*       m_Stats;        /**< Statistics to add to, or NULL. Only filled in when the library is built
+                                   with JSN_ENABLE_STATS set to 1. See JsnStats. */
+
+  JsnParseOptions()
+  : m_Index( NULL )
+  , m_ValidateUTF8( false )
+  , m_UnescapeInPlace( false )
+  , m_Filter( NULL )
+  , m_HashKeys( false )
+  , m_Keys( NULL )
+  , m_Stats( NULL )
+  {}
+};
+
+/************************************************************************************************************/ /**
+ Parse the input stream with optional settings. This calls the handler through the JsnHandler interface.
+ To have the calls resolved at compile time instead, use the JsnParse() template in JsnParseStatic.h.
+ \param[ in ] reader Handler implementation.
+ \param[ in ] stream Input stream.
+ \param[ in ] options Settings.
+ \return true if successful, false if not. Call stream->GetError() for details.
+ */
+bool JsnParse( JsnHandler* reader, JsnStreamIn* stream, const JsnParseOptions& options );
+
 /****************************************************************************************************************/
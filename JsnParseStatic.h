@@ -0,0 +1,910 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+#include "JsnKeys.h"
+#include "JsnNumber.h"
+#include "JsnPathFilter.h"
+#include "JsnStream.h"
+
+#include <string.h>
+#include <stdint.h>
+#if JSN_ENABLE_STATS
+#include <chrono>
+#endif
+
+/************************************************************************************************************/ /**
+ \class JsnParseContext
+ The parser behind JsnParse(). Its parse members are templates on the handler type, so that they call the
+ handler's members directly rather than through the JsnHandler interface. The compiler can then inline
+ small handlers into the parse loop.
+
+ The handler type, and the types that its BeginObject() and BeginArray() return, need the same members as
+ JsnHandler: AddProperty(), BeginObject(), EndObject(), BeginArray(), EndArray(), IsStopRequested() and
+ ClearStopRequest(). Each nested object or array is parsed with the type of the handler that was returned
+ for it. Deriving from JsnHandler and declaring the class final is the simplest way to get there: the
+ calls are then resolved at compile time, and the handler still works with every other part of the
+ library. A handler that returns a JsnHandler pointer gets virtual calls for its children.
+
+ Use it through the JsnParse() template below.
+ */
+class JsnParseContext
+{
+public:
+
+  JsnParseContext( JsnStreamIn* stream, const JsnParseOptions& options );
+
+  /**
+   Check the rest of the stream for invalid UTF-8, if the options ask for it.
+   \param[ in ] stream Input stream.
+   \param[ in ] options Settings.
+   \return true if the text may be parsed, false if not. The stream error is set.
+   */
+  static bool Validate( JsnStreamIn* stream, const JsnParseOptions& options );
+
+  /**
+   Return the path filter state of the top level value.
+   \return Start state.
+   */
+  int GetStartState() const;
+
+  /**
+   Parse the value at the read position.
+   \param[ in ] reader Handler implementation.
+   \param[ in ] name Name of the value.
+   \param[ in ] state Path filter state of the value.
+   */
+  template< class Handler >
+  void ParseValue( Handler* reader, const JsnFragment& name, int state );
+
+  /**
+   Parse the value at the read position, and leave the read position after it. With a structural index,
+   the parser steps from indexed position to indexed position, and only updates the stream at the end.
+   \param[ in ] reader Handler implementation.
+   */
+  template< class Handler >
+  void Parse( Handler* reader );
+
+private:
+
+  friend class JsnReader;
+
+  JsnStreamIn*    m_Stream;
+  const uint64_t* m_Positions;  // Structural index, or NULL
+  const uint64_t* m_EscapedBits; // Strings with escape sequences, from the index links, or NULL
+  int64_t         m_Cursor;     // Index of first position at or after the read position
+  const char*     m_Text;       // Start of the stream's text, for the index positions
+  int64_t         m_End;        // End of the stream's text, as a position. Later positions are not used.
+  bool            m_Unescape;   // Decode strings in place
+  bool            m_Stop;       // A handler called RequestStop()
+  bool            m_HashKeys;   // Hash property names
+  const JsnKeyDictionary* m_Keys; // Key dictionary, or NULL
+  const JsnPathFilter* m_Filter; // Path filter, or NULL
+  JsnStats*       m_Stats;      // Statistics, or NULL
+  int             m_Depth;      // Nesting depth, only tracked for statistics
+
+  // Return the first indexed position at or after the read position. The end of the positions array
+  // is marked with the text length, so this never runs off the end.
+  int64_t NextPosition()
+  {
+    int64_t current = m_Stream->GetCount();
+    while( ( int64_t )m_Positions[ m_Cursor ] < current )
+    {
+      m_Cursor += 1;
+    }
+    return ( int64_t )m_Positions[ m_Cursor ];
+  }
+
+  void        EatSpace();
+  JsnFragment ParseString();
+  JsnFragment ParseNumber();
+  void        ParseLiteral( const char* literal );
+  void        Unescape( JsnFragment* fragment );
+  void        HashName( JsnFragment* name );
+  void        HashEscapedName( JsnFragment* name );
+  void        SkipContainer();
+  void        SkipValue();
+  int         NextState( int state, const JsnFragment& name );
+  int         NextIndexState( int state, int64_t index );
+
+  int         IndexedPeek() const;
+  JsnFragment IndexedString();
+  bool        IndexedNumber( JsnFragment* number );
+  bool        IndexedLiteral( const char* literal, int64_t length );
+  bool        IndexedScalarEnd( int64_t end ) const;
+  bool        IndexedSkipContainer();
+  void        IndexedSkipValue();
+  void        IndexedError( const char* error );
+  void        IndexedFinish();
+
+#if JSN_ENABLE_STATS
+  int64_t     StatsClock() const;
+  void        StatsHandler( int64_t start, JsnType type );
+  void        StatsString( const char* begin, const char* end, bool escaped );
+  void        StatsEnter();
+#endif
+
+  template< class Handler >
+  void        AddProperty( Handler* reader, const JsnFragment& name, const JsnFragment& value );
+  template< class Handler >
+  bool        CheckStop( Handler* reader );
+  template< class Handler >
+  void        ParseObject( Handler* reader, int state );
+  template< class Handler >
+  void        ParseArray( Handler* reader, int state );
+  template< class Handler >
+  void        ParseIndexedValue( Handler* reader, const JsnFragment& name, int state );
+  template< class Handler >
+  void        ParseIndexedObject( Handler* reader, int state );
+  template< class Handler >
+  void        ParseIndexedArray( Handler* reader, int state );
+};
+
+#if JSN_ENABLE_STATS
+
+inline int64_t JsnStatsNow()
+{
+  return ( int64_t )std::chrono::duration_cast< std::chrono::nanoseconds >(
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// Adds the bytes consumed by one JsnParse() call, and the time it took minus the handler calls made
+// meanwhile.
+class JsnStatsScope
+{
+public:
+
+  JsnStatsScope( JsnStats* stats, JsnStreamIn* stream )
+  : m_Stats( stats )
+  , m_Stream( stream )
+  , m_Count( stream->GetCount() )
+  , m_Handler( stats ? stats->m_HandlerNanoseconds : 0 )
+  , m_Start( stats ? JsnStatsNow() : 0 )
+  {}
+
+  ~JsnStatsScope()
+  {
+    if( m_Stats )
+    {
+      int64_t elapsed = JsnStatsNow() - m_Start;
+      m_Stats->m_Bytes += m_Stream->GetCount() - m_Count;
+      m_Stats->m_ParseNanoseconds += elapsed - ( m_Stats->m_HandlerNanoseconds - m_Handler );
+    }
+  }
+
+private:
+
+  JsnStats*    m_Stats;
+  JsnStreamIn* m_Stream;
+  int64_t      m_Count;
+  int64_t      m_Handler;
+  int64_t      m_Start;
+};
+
+#endif
+
+/************************************************************************************************************/ /**
+ Parse the input stream with a handler of a known type. The handler receives the same calls as from the
+ JsnParse() overloads that take a JsnHandler, which are built on this one.
+ \code
+ class Counter final : public JsnHandler { ... };
+ Counter counter;
+ JsnParse< Counter >( &counter, &stream );
+ \endcode
+ \param[ in ] reader Handler implementation. See JsnParseContext for what its type needs.
+ \param[ in ] stream Input stream.
+ \param[ in ] options Settings.
+ \return true if successful, false if not. Call stream->GetError() for details.
+ */
+template< class Handler >
+bool JsnParse( Handler* reader, JsnStreamIn* stream, const JsnParseOptions& options = JsnParseOptions() )
+{
+  JSN_STATS( JsnStatsScope scope( options.m_Stats, stream ); )
+  if( !JsnParseContext::Validate( stream, options ) )
+  {
+    return false;
+  }
+  JsnParseContext context( stream, options );
+  context.Parse( reader );
+  return !stream->GetError();
+}
+
+/****************************************************************************************************************/
+
+#if JSN_ENABLE_STATS
+
+inline int64_t JsnParseContext::StatsClock() const
+{
+  return m_Stats ? JsnStatsNow() : 0;
+}
+
+inline void JsnParseContext::StatsHandler( int64_t start, JsnType type )
+{
+  if( m_Stats )
+  {
+    // EndObject() and EndArray() pass kJsn_Undefined: their container was counted at the start
+    m_Stats->m_HandlerNanoseconds += JsnStatsNow() - start;
+    m_Stats->m_Counts[ type ] += type != kJsn_Undefined;
+    m_Stats->m_NumbersConverted += type == kJsn_Int || type == kJsn_Float;
+  }
+}
+
+inline void JsnParseContext::StatsString( const char* begin, const char* end, bool escaped )
+{
+  if( !m_Stats )
+  {
+    return;
+  }
+  if( end - begin > m_Stats->m_LongestString )
+  {
+    m_Stats->m_LongestString = end - begin;
+  }
+  if( escaped )
+  {
+    m_Stats->m_EscapedStrings += 1;
+    for( const char* p = begin; p < end; ++p )
+    {
+      if( *p == '\\' )
+      {
+        m_Stats->m_EscapeSequences += 1;
+        p += 1; // Skip escaped character
+      }
+    }
+  }
+}
+
+inline void JsnParseContext::StatsEnter()
+{
+  m_Depth += 1;
+  if( m_Stats && m_Depth > m_Stats->m_MaxDepth )
+  {
+    m_Stats->m_MaxDepth = m_Depth;
+  }
+}
+
+#endif
+
+/****************************************************************************************************************/
+
+inline void JsnParseContext::EatSpace()
+{
+  JsnStreamIn* stream = m_Stream;
+  if( m_Positions )
+  {
+    // Whitespace always runs up to the next indexed position
+    int c = stream->Peek();
+    if( c != -1 && c <= ' ' )
+    {
+      stream->Seek( NextPosition() );
+    }
+    return;
+  }
+  while( stream->Peek() != -1 && stream->Peek() <= ' ' )
+  {
+    stream->Read();
+  }
+}
+
+inline JsnFragment JsnParseContext::ParseString()
+{
+  JsnStreamIn* stream = m_Stream;
+  const char* begin;
+  const char* end;
+  bool escaped = false;
+  if( m_Positions && NextPosition() == stream->GetCount() )
+  {
+    // The opening quote is indexed, and the closing quote is the very next position
+    begin = stream->GetCurrent() + 1;
+    stream->Seek( ( int64_t )m_Positions[ m_Cursor + 1 ] );
+    if( stream->Read() != '"' )
+    {
+      stream->SetError( "Unterminated string" );
+      return JsnFragment( kJsn_String, begin, stream->GetCurrent() );
+    }
+    end = stream->GetCurrent() - 1;
+    if( m_EscapedBits )
+    {
+      escaped = ( ( m_EscapedBits[ m_Cursor >> 6 ] >> ( m_Cursor & 63 ) ) & 1 ) != 0;
+    }
+    else
+    {
+      escaped = memchr( begin, '\\', end - begin ) != NULL;
+    }
+  }
+  else
+  {
+    stream->Read(); // Skip leading quote
+    begin = stream->GetCurrent();
+    int c = stream->Read();
+    while( c != '"' && c != -1 )
+    {
+      if( c == '\\' )
+      {
+        escaped = true;
+        c = stream->Read(); // Skip escaped character
+      }
+      c = stream->Read();
+    }
+    end = c == -1 ? stream->GetCurrent() : stream->GetCurrent() - 1;
+  }
+  JSN_STATS( StatsString( begin, end, escaped ); )
+  JsnFragment fragment( kJsn_String, begin, end );
+  if( escaped )
+  {
+    fragment.m_Flags |= kJsnFlag_Escaped;
+  }
+  if( m_Unescape )
+  {
+    Unescape( &fragment );
+  }
+  return fragment;
+}
+
+inline void JsnParseContext::HashName( JsnFragment* name )
+{
+  if( ( name->m_Flags & kJsnFlag_Escaped ) && !( name->m_Flags & kJsnFlag_Unescaped ) )
+  {
+    HashEscapedName( name );
+    return;
+  }
+  uint32_t hash = JsnHashKey( name->m_Text, name->m_Length );
+  name->m_Value.key.hash = hash;
+  name->m_Flags |= kJsnFlag_Hashed;
+  if( m_Keys )
+  {
+    name->m_Value.key.id = m_Keys->Find( hash, name->m_Text, name->m_Length );
+    name->m_Flags |= name->m_Value.key.id >= 0 ? kJsnFlag_KeyId : 0;
+  }
+}
+
+inline JsnFragment JsnParseContext::ParseNumber()
+{
+  JsnFragment number;
+  int64_t length = JsnParseNumber( m_Stream->GetCurrent(), m_Stream->GetRemaining(), &number );
+  m_Stream->Seek( m_Stream->GetCount() + length );
+  return number;
+}
+
+inline void JsnParseContext::ParseLiteral( const char* literal )
+{
+  for( const char* p = literal; *p; ++p )
+  {
+    if( m_Stream->Read() != ( uint8_t )*p )
+    {
+      m_Stream->SetError( "Syntax error" );
+      return;
+    }
+  }
+}
+
+template< class Handler >
+void JsnParseContext::AddProperty( Handler* reader, const JsnFragment& name, const JsnFragment& value )
+{
+  JSN_STATS( int64_t start = StatsClock(); )
+  reader->AddProperty( name, value );
+  JSN_STATS( StatsHandler( start, value.m_Type ); )
+}
+
+template< class Handler >
+bool JsnParseContext::CheckStop( Handler* reader )
+{
+  if( reader->IsStopRequested() )
+  {
+    reader->ClearStopRequest();
+    m_Stop = true;
+  }
+  return m_Stop;
+}
+
+template< class Handler >
+void JsnParseContext::ParseObject( Handler* reader, int state )
+{
+  JsnStreamIn* stream = m_Stream;
+  do
+  {
+    stream->Read(); // Skip open brace or comma
+    EatSpace();
+    int c = stream->Peek();
+    if( c != '}' )
+    {
+      JsnFragment name;
+      if( c == '"' )
+      {
+        name = ParseString();
+        if( m_HashKeys )
+        {
+          HashName( &name );
+        }
+      }
+      else
+      {
+        stream->SetError( "String expected" );
+      }
+
+      EatSpace();
+      int c = stream->Peek();
+      if( c == ':' )
+      {
+        stream->Read(); // Skip colon
+        EatSpace();
+        ParseValue( reader, name, state < 0 ? state : NextState( state, name ) );
+      }
+      else
+      {
+        stream->SetError( "\":\" expected" );
+      }
+      EatSpace();
+    }
+  }
+  while( !stream->GetError() && !m_Stop && stream->Peek() == ',' );
+
+  if( m_Stop )
+  {
+    return;
+  }
+  if( stream->Read() != '}' )
+  {
+    stream->Unread();
+    stream->SetError( "\"}\" expected" );
+  }
+}
+
+template< class Handler >
+void JsnParseContext::ParseArray( Handler* reader, int state )
+{
+  JsnStreamIn* stream = m_Stream;
+  int64_t index = 0;
+  do
+  {
+    stream->Read(); // Skip open bracket or comma
+    EatSpace();
+    if( stream->Peek() != ']' )
+    {
+      int element_state = state < 0 ? state : NextIndexState( state, index++ );
+      ParseValue( reader, JsnFragment(), element_state );
+      EatSpace();
+    }
+  }
+  while( !stream->GetError() && !m_Stop && stream->Peek() == ',' );
+
+  if( m_Stop )
+  {
+    return;
+  }
+  if( stream->Read() != ']' )
+  {
+    stream->Unread();
+    stream->SetError( "\"]\" expected" );
+  }
+}
+
+template< class Handler >
+void JsnParseContext::ParseValue( Handler* reader, const JsnFragment& name, int state )
+{
+  JsnStreamIn* stream = m_Stream;
+  if( state != JsnPathFilter::kAll )
+  {
+    // The value does not match a path. Only an object or array can still contain a match.
+    int c = stream->Peek();
+    if( state == JsnPathFilter::kNone || ( c != '{' && c != '[' ) )
+    {
+      SkipValue();
+      return;
+    }
+  }
+  switch( stream->Peek() )
+  {
+    case 't':
+      ParseLiteral( "true" );
+      AddProperty( reader, name, JsnFragment( kJsn_True ) );
+      break;
+
+    case 'f':
+      ParseLiteral( "false" );
+      AddProperty( reader, name, JsnFragment( kJsn_False ) );
+      break;
+
+    case 'n':
+      ParseLiteral( "null" );
+      AddProperty( reader, name, JsnFragment( kJsn_Null ) );
+      break;
+
+    case '"':
+    {
+      JsnFragment value = ParseString();
+      AddProperty( reader, name, value );
+      break;
+    }
+
+    case '-':
+    case '.':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    {
+      JsnFragment value = ParseNumber();
+      AddProperty( reader, name, value );
+      break;
+    }
+
+    case '[':
+    {
+      JSN_STATS( int64_t start = StatsClock(); )
+      auto child_reader = reader->BeginArray( name );
+      JSN_STATS( StatsHandler( start, kJsn_Array ); )
+      if( !child_reader )
+      {
+        if( !CheckStop( reader ) )
+        {
+          SkipContainer();
+        }
+        return;
+      }
+      if( !CheckStop( reader ) )
+      {
+        JSN_STATS( StatsEnter(); )
+        ParseArray( child_reader, state );
+        JSN_STATS( m_Depth -= 1; )
+      }
+      JSN_STATS( start = StatsClock(); )
+      reader->EndArray( child_reader );
+      JSN_STATS( StatsHandler( start, kJsn_Undefined ); )
+      break;
+    }
+
+    case '{':
+    {
+      JSN_STATS( int64_t start = StatsClock(); )
+      auto child_reader = reader->BeginObject( name );
+      JSN_STATS( StatsHandler( start, kJsn_Object ); )
+      if( !child_reader )
+      {
+        if( !CheckStop( reader ) )
+        {
+          SkipContainer();
+        }
+        return;
+      }
+      if( !CheckStop( reader ) )
+      {
+        JSN_STATS( StatsEnter(); )
+        ParseObject( child_reader, state );
+        JSN_STATS( m_Depth -= 1; )
+      }
+      JSN_STATS( start = StatsClock(); )
+      reader->EndObject( child_reader );
+      JSN_STATS( StatsHandler( start, kJsn_Undefined ); )
+      break;
+    }
+
+    default:
+      stream->SetError( "Unexpected character" );
+      break;
+  }
+  CheckStop( reader );
+}
+
+/****************************************************************************************************************/
+// Indexed parse. m_Cursor is the index of the position of the next token. Between two positions there is
+// only whitespace, the rest of a number or literal, or the contents of a string, so none of that is read.
+
+// Return the character at the next position, or -1 at the end of the text.
+inline int JsnParseContext::IndexedPeek() const
+{
+  int64_t position = ( int64_t )m_Positions[ m_Cursor ];
+  return position < m_End ? ( uint8_t )m_Text[ position ] : -1;
+}
+
+// A number or literal must run up to whitespace, or up to the next position.
+inline bool JsnParseContext::IndexedScalarEnd( int64_t end ) const
+{
+  return end == ( int64_t )m_Positions[ m_Cursor + 1 ] || end >= m_End || ( uint8_t )m_Text[ end ] <= ' ';
+}
+
+// The opening quote is at the next position, and the closing quote at the one after.
+inline JsnFragment JsnParseContext::IndexedString()
+{
+  int64_t open = ( int64_t )m_Positions[ m_Cursor ];
+  int64_t close = ( int64_t )m_Positions[ m_Cursor + 1 ];
+  if( close >= m_End || m_Text[ close ] != '"' )
+  {
+    IndexedError( "Unterminated string" );
+    return JsnFragment( kJsn_String, m_Text + open + 1, m_Text + ( close < m_End ? close : m_End ) );
+  }
+  const char* begin = m_Text + open + 1;
+  const char* end = m_Text + close;
+  bool escaped;
+  if( m_EscapedBits )
+  {
+    escaped = ( ( m_EscapedBits[ m_Cursor >> 6 ] >> ( m_Cursor & 63 ) ) & 1 ) != 0;
+  }
+  else
+  {
+    escaped = memchr( begin, '\\', end - begin ) != NULL;
+  }
+  m_Cursor += 2;
+  JSN_STATS( StatsString( begin, end, escaped ); )
+  JsnFragment fragment( kJsn_String, begin, end );
+  if( escaped )
+  {
+    fragment.m_Flags |= kJsnFlag_Escaped;
+  }
+  if( m_Unescape )
+  {
+    Unescape( &fragment );
+  }
+  return fragment;
+}
+
+inline bool JsnParseContext::IndexedNumber( JsnFragment* number )
+{
+  int64_t position = ( int64_t )m_Positions[ m_Cursor ];
+  int64_t length = JsnParseNumber( m_Text + position, m_End - position, number );
+  if( !length || !IndexedScalarEnd( position + length ) )
+  {
+    IndexedError( "Syntax error" );
+    return false;
+  }
+  m_Cursor += 1;
+  return true;
+}
+
+inline bool JsnParseContext::IndexedLiteral( const char* literal, int64_t length )
+{
+  int64_t position = ( int64_t )m_Positions[ m_Cursor ];
+  if( m_End - position < length || memcmp( m_Text + position, literal, ( size_t )length ) != 0 ||
+      !IndexedScalarEnd( position + length ) )
+  {
+    IndexedError( "Syntax error" );
+    return false;
+  }
+  m_Cursor += 1;
+  return true;
+}
+
+template< class Handler >
+void JsnParseContext::Parse( Handler* reader )
+{
+  if( m_Positions )
+  {
+    // Like the plain parse, the value must start right at the read position
+    if( ( int64_t )m_Positions[ m_Cursor ] != m_Stream->GetCount() )
+    {
+      m_Stream->SetError( "Unexpected character" );
+      return;
+    }
+    ParseIndexedValue( reader, JsnFragment(), GetStartState() );
+    IndexedFinish();
+  }
+  else
+  {
+    ParseValue( reader, JsnFragment(), GetStartState() );
+  }
+}
+
+template< class Handler >
+void JsnParseContext::ParseIndexedObject( Handler* reader, int state )
+{
+  int c;
+  do
+  {
+    m_Cursor += 1; // Skip open brace or comma
+    c = IndexedPeek();
+    if( c != '}' )
+    {
+      if( c != '"' )
+      {
+        IndexedError( "String expected" );
+        return;
+      }
+      JsnFragment name = IndexedString();
+      if( m_HashKeys )
+      {
+        HashName( &name );
+      }
+      if( IndexedPeek() != ':' )
+      {
+        IndexedError( "\":\" expected" );
+        return;
+      }
+      m_Cursor += 1; // Skip colon
+      ParseIndexedValue( reader, name, state < 0 ? state : NextState( state, name ) );
+      c = IndexedPeek();
+    }
+  }
+  while( c == ',' && !m_Stop && !m_Stream->GetError() );
+
+  if( m_Stop || m_Stream->GetError() )
+  {
+    return;
+  }
+  if( c != '}' )
+  {
+    IndexedError( "\"}\" expected" );
+    return;
+  }
+  m_Cursor += 1;
+}
+
+template< class Handler >
+void JsnParseContext::ParseIndexedArray( Handler* reader, int state )
+{
+  int64_t index = 0;
+  int c;
+  do
+  {
+    m_Cursor += 1; // Skip open bracket or comma
+    c = IndexedPeek();
+    if( c != ']' )
+    {
+      int element_state = state < 0 ? state : NextIndexState( state, index++ );
+      ParseIndexedValue( reader, JsnFragment(), element_state );
+      c = IndexedPeek();
+    }
+  }
+  while( c == ',' && !m_Stop && !m_Stream->GetError() );
+
+  if( m_Stop || m_Stream->GetError() )
+  {
+    return;
+  }
+  if( c != ']' )
+  {
+    IndexedError( "\"]\" expected" );
+    return;
+  }
+  m_Cursor += 1;
+}
+
+template< class Handler >
+void JsnParseContext::ParseIndexedValue( Handler* reader, const JsnFragment& name, int state )
+{
+  int c = IndexedPeek();
+  if( state != JsnPathFilter::kAll )
+  {
+    // The value does not match a path. Only an object or array can still contain a match.
+    if( state == JsnPathFilter::kNone || ( c != '{' && c != '[' ) )
+    {
+      IndexedSkipValue();
+      return;
+    }
+  }
+  switch( c )
+  {
+    case 't':
+      if( IndexedLiteral( "true", 4 ) )
+      {
+        AddProperty( reader, name, JsnFragment( kJsn_True ) );
+      }
+      break;
+
+    case 'f':
+      if( IndexedLiteral( "false", 5 ) )
+      {
+        AddProperty( reader, name, JsnFragment( kJsn_False ) );
+      }
+      break;
+
+    case 'n':
+      if( IndexedLiteral( "null", 4 ) )
+      {
+        AddProperty( reader, name, JsnFragment( kJsn_Null ) );
+      }
+      break;
+
+    case '"':
+    {
+      JsnFragment value = IndexedString();
+      AddProperty( reader, name, value );
+      break;
+    }
+
+    case '-':
+    case '.':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    {
+      JsnFragment value;
+      if( IndexedNumber( &value ) )
+      {
+        AddProperty( reader, name, value );
+      }
+      break;
+    }
+
+    case '[':
+    {
+      JSN_STATS( int64_t start = StatsClock(); )
+      auto child_reader = reader->BeginArray( name );
+      JSN_STATS( StatsHandler( start, kJsn_Array ); )
+      if( !child_reader )
+      {
+        if( !CheckStop( reader ) && !IndexedSkipContainer() )
+        {
+          IndexedError( "Unexpected end of input data" );
+        }
+        return;
+      }
+      if( !CheckStop( reader ) )
+      {
+        JSN_STATS( StatsEnter(); )
+        ParseIndexedArray( child_reader, state );
+        JSN_STATS( m_Depth -= 1; )
+      }
+      JSN_STATS( start = StatsClock(); )
+      reader->EndArray( child_reader );
+      JSN_STATS( StatsHandler( start, kJsn_Undefined ); )
+      break;
+    }
+
+    case '{':
+    {
+      JSN_STATS( int64_t start = StatsClock(); )
+      auto child_reader = reader->BeginObject( name );
+      JSN_STATS( StatsHandler( start, kJsn_Object ); )
+      if( !child_reader )
+      {
+        if( !CheckStop( reader ) && !IndexedSkipContainer() )
+        {
+          IndexedError( "Unexpected end of input data" );
+        }
+        return;
+      }
+      if( !CheckStop( reader ) )
+      {
+        JSN_STATS( StatsEnter(); )
+        ParseIndexedObject( child_reader, state );
+        JSN_STATS( m_Depth -= 1; )
+      }
+      JSN_STATS( start = StatsClock(); )
+      reader->EndObject( child_reader );
+      JSN_STATS( StatsHandler( start, kJsn_Undefined ); )
+      break;
+    }
+
+    default:
+      IndexedError( "Unexpected character" );
+      break;
+  }
+  CheckStop( reader );
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,430 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnPathFilter.h"
+#include "JsnBlock.h"
+#include "JsnNumber.h"
+#include "JsnReserve.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/****************************************************************************************************************/
+
+static inline bool TestBit( const uint64_t* set, int bit )
+{
+  return ( set[ bit >> 6 ] >> ( bit & 63 ) ) & 1;
+}
+
+static inline void SetBit( uint64_t* set, int bit )
+{
+  set[ bit >> 6 ] |= ( uint64_t )1 << ( bit & 63 );
+}
+
+/****************************************************************************************************************/
+
+JsnPathFilter::JsnPathFilter()
+: m_Text( NULL )
+, m_TextSize( 0 )
+, m_TextCapacity( 0 )
+, m_Segments( NULL )
+, m_SegmentCount( 0 )
+, m_SegmentCapacity( 0 )
+, m_States( NULL )
+, m_StateCount( 0 )
+, m_StateCapacity( 0 )
+, m_Keys( NULL )
+, m_KeyCount( 0 )
+, m_KeyCapacity( 0 )
+, m_Start( kNone )
+, m_Error( NULL )
+{}
+
+/****************************************************************************************************************/
+
+JsnPathFilter::~JsnPathFilter()
+{
+  delete[] m_Text;
+  delete[] m_Segments;
+  delete[] m_States;
+  delete[] m_Keys;
+}
+
+/****************************************************************************************************************/
+
+void JsnPathFilter::Clear()
+{
+  m_TextSize = 0;
+  m_SegmentCount = 0;
+  m_StateCount = 0;
+  m_KeyCount = 0;
+  m_Start = kNone;
+  m_Error = NULL;
+}
+
+/****************************************************************************************************************/
+
+void JsnPathFilter::AppendText( char c )
+{
+  JsnReserve( &m_Text, m_TextSize, &m_TextCapacity, m_TextSize + 1 );
+  m_Text[ m_TextSize++ ] = c;
+}
+
+/****************************************************************************************************************/
+
+void JsnPathFilter::AddSegment( const char* text, int64_t length, bool wildcard )
+{
+  JsnReserve( &m_Segments, m_SegmentCount, &m_SegmentCapacity, m_SegmentCount + 1 );
+  Segment& segment = m_Segments[ m_SegmentCount++ ];
+  segment.m_Offset = m_TextSize;
+  segment.m_Length = 0;
+  segment.m_Wildcard = wildcard;
+  for( int64_t i = 0; i < length; ++i )
+  {
+    AppendText( text[ i ] );
+  }
+  segment.m_Length = m_TextSize - segment.m_Offset;
+}
+
+/****************************************************************************************************************/
+
+bool JsnPathFilter::ParsePointer( const char* path )
+{
+  const char* p = path;
+  while( *p )
+  {
+    if( *p != '/' )
+    {
+      m_Error = "JSON Pointer must start with '/'";
+      return false;
+    }
+    p += 1;
+    const char* begin = p;
+    while( *p && *p != '/' )
+    {
+      p += 1;
+    }
+    if( p - begin == 1 && *begin == '*' )
+    {
+      AddSegment( NULL, 0, true );
+      continue;
+    }
+    AddSegment( NULL, 0, false );
+    for( const char* s = begin; s < p; ++s )
+    {
+      if( *s == '~' )
+      {
+        s += 1;
+        if( s == p || ( *s != '0' && *s != '1' ) )
+        {
+          m_Error = "Invalid escape in JSON Pointer";
+          return false;
+        }
+        AppendText( *s == '0' ? '~' : '/' );
+      }
+      else
+      {
+        AppendText( *s );
+      }
+    }
+    Segment& segment = m_Segments[ m_SegmentCount - 1 ];
+    segment.m_Length = m_TextSize - segment.m_Offset;
+  }
+  return true;
+}
+
+/****************************************************************************************************************/
+
+bool JsnPathFilter::ParseJsonPath( const char* path )
+{
+  const char* p = path + 1; // Skip '$'
+  while( *p )
+  {
+    if( p[ 0 ] == '.' && p[ 1 ] == '*' )
+    {
+      AddSegment( NULL, 0, true );
+      p += 2;
+    }
+    else if( *p == '.' )
+    {
+      const char* begin = ++p;
+      while( *p && *p != '.' && *p != '[' )
+      {
+        p += 1;
+      }
+      if( p == begin )
+      {
+        m_Error = "Empty name in JSONPath";
+        return false;
+      }
+      AddSegment( begin, p - begin, false );
+    }
+    else if( p[ 0 ] == '[' && p[ 1 ] == '*' && p[ 2 ] == ']' )
+    {
+      AddSegment( NULL, 0, true );
+      p += 3;
+    }
+    else if( p[ 0 ] == '[' && ( p[ 1 ] == '\'' || p[ 1 ] == '"' ) )
+    {
+      char quote = p[ 1 ];
+      p += 2;
+      AddSegment( NULL, 0, false );
+      while( *p && *p != quote )
+      {
+        if( *p == '\\' && p[ 1 ] )
+        {
+          p += 1;
+        }
+        AppendText( *p++ );
+      }
+      if( p[ 0 ] != quote || p[ 1 ] != ']' )
+      {
+        m_Error = "Unterminated name in JSONPath";
+        return false;
+      }
+      p += 2;
+      Segment& segment = m_Segments[ m_SegmentCount - 1 ];
+      segment.m_Length = m_TextSize - segment.m_Offset;
+    }
+    else if( *p == '[' )
+    {
+      const char* begin = ++p;
+      while( *p >= '0' && *p <= '9' )
+      {
+        p += 1;
+      }
+      if( p == begin || *p != ']' )
+      {
+        m_Error = "Invalid index in JSONPath";
+        return false;
+      }
+      AddSegment( begin, p - begin, false );
+      p += 1;
+    }
+    else
+    {
+      m_Error = "Syntax error in JSONPath";
+      return false;
+    }
+  }
+  return true;
+}
+
+/****************************************************************************************************************/
+
+// Return the state for a set of positions, adding it if it is new. A position is a path plus the number of
+// segments matched so far.
+int JsnPathFilter::Resolve( const uint64_t* set, uint64_t** sets, int words, const int* position_segments )
+{
+  bool empty = true;
+  for( int w = 0; w < words; ++w )
+  {
+    uint64_t bits = set[ w ];
+    while( bits )
+    {
+      int position = w * 64 + JsnCountTrailingZeros( bits );
+      bits &= bits - 1;
+      if( position_segments[ position ] < 0 )
+      {
+        return kAll; // A path is complete
+      }
+      empty = false;
+    }
+  }
+  if( empty )
+  {
+    return kNone;
+  }
+  for( int i = 0; i < m_StateCount; ++i )
+  {
+    if( memcmp( *sets + i * words, set, words * sizeof( uint64_t ) ) == 0 )
+    {
+      return i;
+    }
+  }
+  int capacity = m_StateCapacity;
+  JsnReserve( &m_States, m_StateCount, &m_StateCapacity, m_StateCount + 1 );
+  if( m_StateCapacity != capacity )
+  {
+    uint64_t* new_sets = new uint64_t[ m_StateCapacity * words ];
+    if( m_StateCount )
+    {
+      memcpy( new_sets, *sets, m_StateCount * words * sizeof( uint64_t ) );
+    }
+    delete[] *sets;
+    *sets = new_sets;
+  }
+  memcpy( *sets + m_StateCount * words, set, words * sizeof( uint64_t ) );
+  return m_StateCount++;
+}
+
+/****************************************************************************************************************/
+
+bool JsnPathFilter::Compile( const char* const* paths, int count )
+{
+  Clear();
+  JsnReserve( &m_Text, m_TextSize, &m_TextCapacity, ( int64_t )1 ); // Never NULL, even if all names are empty
+
+  // Parse the paths into segments. Each path takes its segments plus one position for being complete.
+  int* path_ends = new int[ count + 1 ];
+  for( int i = 0; i < count && !m_Error; ++i )
+  {
+    const char* path = paths[ i ];
+    if( path[ 0 ] == '$' )
+    {
+      ParseJsonPath( path );
+    }
+    else
+    {
+      ParsePointer( path );
+    }
+    path_ends[ i ] = m_SegmentCount;
+  }
+  if( m_Error )
+  {
+    const char* error = m_Error;
+    delete[] path_ends;
+    Clear();
+    m_Error = error;
+    return false;
+  }
+
+  int position_count = m_SegmentCount + count;
+  int* position_segments = new int[ position_count ];
+  int words = ( position_count + 63 ) / 64;
+  uint64_t* set = new uint64_t[ words ];
+  uint64_t* sets = new uint64_t[ ( m_StateCapacity ? m_StateCapacity : 1 ) * words ];
+  memset( set, 0, words * sizeof( uint64_t ) );
+  for( int i = 0, position = 0, segment = 0; i < count; ++i )
+  {
+    SetBit( set, position );
+    while( segment < path_ends[ i ] )
+    {
+      position_segments[ position++ ] = segment++;
+    }
+    position_segments[ position++ ] = -1;
+  }
+  delete[] path_ends;
+
+  // Build the state machine one state at a time. States are sets of positions. Each name that appears in
+  // the state's next segments gets its own transition, and every other name takes the default transition,
+  // made up of wildcards only.
+  m_Start = count ? Resolve( set, &sets, words, position_segments ) : kNone;
+  for( int i = 0; i < m_StateCount; ++i )
+  {
+    int first_key = m_KeyCount;
+    for( int position = 0; position < position_count; ++position )
+    {
+      if( !TestBit( sets + i * words, position ) || m_Segments[ position_segments[ position ] ].m_Wildcard )
+      {
+        continue;
+      }
+      const Segment& segment = m_Segments[ position_segments[ position ] ];
+      const char* name = m_Text + segment.m_Offset;
+      bool seen = false;
+      for( int k = first_key; k < m_KeyCount && !seen; ++k )
+      {
+        seen = m_Keys[ k ].m_Length == segment.m_Length && memcmp( m_Text + m_Keys[ k ].m_Offset, name,
+                                                                   segment.m_Length ) == 0;
+      }
+      if( seen )
+      {
+        continue;
+      }
+      memset( set, 0, words * sizeof( uint64_t ) );
+      for( int other = 0; other < position_count; ++other )
+      {
+        if( TestBit( sets + i * words, other ) )
+        {
+          const Segment& other_segment = m_Segments[ position_segments[ other ] ];
+          if( other_segment.m_Wildcard || ( other_segment.m_Length == segment.m_Length &&
+                                            memcmp( m_Text + other_segment.m_Offset, name, segment.m_Length ) == 0 ) )
+          {
+            SetBit( set, other + 1 );
+          }
+        }
+      }
+      int next = Resolve( set, &sets, words, position_segments );
+      JsnReserve( &m_Keys, m_KeyCount, &m_KeyCapacity, m_KeyCount + 1 );
+      m_Keys[ m_KeyCount ].m_Offset = segment.m_Offset;
+      m_Keys[ m_KeyCount ].m_Length = segment.m_Length;
+      m_Keys[ m_KeyCount ].m_Next = next;
+      m_KeyCount += 1;
+    }
+
+    memset( set, 0, words * sizeof( uint64_t ) );
+    for( int position = 0; position < position_count; ++position )
+    {
+      if( TestBit( sets + i * words, position ) && m_Segments[ position_segments[ position ] ].m_Wildcard )
+      {
+        SetBit( set, position + 1 );
+      }
+    }
+    int next = Resolve( set, &sets, words, position_segments );
+    m_States[ i ].m_FirstKey = first_key;
+    m_States[ i ].m_KeyCount = m_KeyCount - first_key;
+    m_States[ i ].m_Default = next;
+  }
+
+  delete[] position_segments;
+  delete[] set;
+  delete[] sets;
+  return true;
+}
+
+/****************************************************************************************************************/
+
+int JsnPathFilter::Next( int state, const char* name, int64_t length ) const
+{
+  if( state < 0 )
+  {
+    return state;
+  }
+  const State& s = m_States[ state ];
+  const Key* key = m_Keys + s.m_FirstKey;
+  for( int i = 0; i < s.m_KeyCount; ++i, ++key )
+  {
+    if( key->m_Length == length && memcmp( m_Text + key->m_Offset, name, ( size_t )length ) == 0 )
+    {
+      return key->m_Next;
+    }
+  }
+  return s.m_Default;
+}
+
+/****************************************************************************************************************/
+
+int JsnPathFilter::NextIndex( int state, int64_t index ) const
+{
+  if( state < 0 )
+  {
+    return state;
+  }
+  char buf[ kJsnMaxNumberLength ];
+  int length = JsnFormatInt( buf, index );
+  return Next( state, buf, length );
+}
+
+/****************************************************************************************************************/
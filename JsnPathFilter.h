@@ -0,0 +1,158 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \class JsnPathFilter
+ A set of paths into a JSON document, compiled into a small state machine. Pass it to JsnParse() with
+ JsnParseOptions::m_Filter, and the handler only sees the values that match one of the paths, and the
+ objects and arrays that lead to them. Everything else is skipped by the parser, without handler calls.
+
+ A path is either a JSON Pointer, or a simple JSONPath:
+ - JSON Pointer: "/events/0/user/id". Segments are separated by '/'. "~0" stands for '~' and "~1" for
+   '/'. A segment "*" matches any property name or array element. The empty path "" matches the whole
+   document.
+ - JSONPath: "$.events[*].user.id". Starts with '$', followed by any of .name, .*, [*], [3], ['name'] and
+   ["name"]. Inside quotes, a backslash takes the next character literally.
+
+ A number segment, like "3" or [3], matches array element 3, as well as a property named "3". When a value
+ matches, all of it is passed to the handler, including everything nested in it.
+
+ \code
+ const char* paths[] = { "$.events[*].user.id", "/meta/count" };
+ JsnPathFilter filter;
+ if( filter.Compile( paths, 2 ) )
+ {
+   JsnParseOptions options;
+   options.m_Filter = &filter;
+   JsnParse( &handler, &stream, options );
+ }
+ \endcode
+ */
+class JsnPathFilter
+{
+public:
+
+  /**
+   Special states returned by GetStart(), Next() and NextIndex().
+   */
+  enum
+  {
+    kAll  = -1, /**< The value matches a path. Everything nested in it matches too. */
+    kNone = -2  /**< The value can not lead to a match, and is skipped. */
+  };
+
+  JsnPathFilter();
+  ~JsnPathFilter();
+
+  /**
+   Compile a set of paths, replacing those compiled before.
+   \param[ in ] paths Array of zero terminated path strings.
+   \param[ in ] count Number of paths.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Compile( const char* const* paths, int count );
+
+  /**
+   Return error string.
+   \return Error string, or NULL if no error.
+   */
+  const char* GetError() const { return m_Error; }
+
+  /**
+   Return the state for the root value.
+   \return State, kAll, or kNone if no paths were compiled.
+   */
+  int GetStart() const { return m_Start; }
+
+  /**
+   Return the state for a property of an object.
+   \param[ in ] state State of the object.
+   \param[ in ] name Property name, decoded. Not necessarily zero terminated.
+   \param[ in ] length Length of name.
+   \return State of the property value, kAll or kNone.
+   */
+  int Next( int state, const char* name, int64_t length ) const;
+
+  /**
+   Return the state for an element of an array.
+   \param[ in ] state State of the array.
+   \param[ in ] index Index of the element.
+   \return State of the element, kAll or kNone.
+   */
+  int NextIndex( int state, int64_t index ) const;
+
+private:
+
+  struct Segment
+  {
+    int64_t m_Offset;   // Decoded text in m_Text
+    int64_t m_Length;
+    bool    m_Wildcard;
+  };
+
+  struct State
+  {
+    int     m_FirstKey; // Transitions for specific names in m_Keys
+    int     m_KeyCount;
+    int     m_Default;  // Transition for any other name
+  };
+
+  struct Key
+  {
+    int64_t m_Offset;   // Name in m_Text
+    int64_t m_Length;
+    int     m_Next;
+  };
+
+  char*       m_Text;
+  int64_t     m_TextSize;
+  int64_t     m_TextCapacity;
+  Segment*    m_Segments;
+  int         m_SegmentCount;
+  int         m_SegmentCapacity;
+  State*      m_States;
+  int         m_StateCount;
+  int         m_StateCapacity;
+  Key*        m_Keys;
+  int         m_KeyCount;
+  int         m_KeyCapacity;
+  int         m_Start;
+  const char* m_Error;
+
+  void        Clear();
+  bool        ParsePointer( const char* path );
+  bool        ParseJsonPath( const char* path );
+  void        AddSegment( const char* text, int64_t length, bool wildcard );
+  void        AppendText( char c );
+  int         Resolve( const uint64_t* set, uint64_t** sets, int words, const int* position_segments );
+
+  JsnPathFilter( const JsnPathFilter& other );
+  JsnPathFilter& operator=( const JsnPathFilter& other );
+};
+
+/****************************************************************************************************************/
@@ -0,0 +1,671 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnPushParse.h"
+#include "JsnNumber.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/****************************************************************************************************************/
+
+JsnPushParser::Buffer::Buffer()
+: m_Data( NULL )
+, m_Length( 0 )
+, m_Capacity( 0 )
+{}
+
+JsnPushParser::Buffer::~Buffer()
+{
+  delete[] m_Data;
+}
+
+void JsnPushParser::Buffer::Append( const char* text, int64_t length )
+{
+  if( m_Length + length > m_Capacity )
+  {
+    int64_t capacity = m_Capacity ? m_Capacity * 2 : 256;
+    while( capacity < m_Length + length )
+    {
+      capacity *= 2;
+    }
+    char* data = new char[ capacity ];
+    if( m_Length )
+    {
+      memcpy( data, m_Data, m_Length );
+    }
+    delete[] m_Data;
+    m_Data     = data;
+    m_Capacity = capacity;
+  }
+  if( length )
+  {
+    memcpy( m_Data + m_Length, text, length );
+    m_Length += length;
+  }
+}
+
+/****************************************************************************************************************/
+
+JsnPushParser::JsnPushParser( JsnHandler* reader )
+: m_Reader( NULL )
+, m_Frames( NULL )
+, m_Depth( 0 )
+, m_Capacity( 0 )
+{
+  Reset( reader );
+}
+
+JsnPushParser::~JsnPushParser()
+{
+  Reset( NULL );
+  delete[] m_Frames;
+}
+
+void JsnPushParser::Reset( JsnHandler* reader )
+{
+  while( m_Depth )
+  {
+    Pop();
+  }
+  m_Reader      = reader;
+  m_State       = kState_Value;
+  m_Error       = NULL;
+  m_Count       = 0;
+  m_Chunk       = NULL;
+  m_TokenBegin  = NULL;
+  m_Name        = JsnFragment();
+  m_NameInChunk = false;
+  m_Stop        = false;
+}
+
+/****************************************************************************************************************/
+
+JsnFragment JsnPushParser::CurrentName() const
+{
+  if( m_Depth && m_Frames[ m_Depth - 1 ].m_IsObject )
+  {
+    return m_Name;
+  }
+  return JsnFragment();
+}
+
+void JsnPushParser::SetError( const char* msg, const char* p )
+{
+  if( !m_Error )
+  {
+    m_Error = msg;
+    m_Count += p - m_Chunk;
+
+    // Let the handlers clean up, like JsnParse() does
+    while( m_Depth )
+    {
+      Pop();
+    }
+    m_Stop = false;
+  }
+}
+
+void JsnPushParser::Push( JsnHandler* handler, bool is_object )
+{
+  if( m_Depth == m_Capacity )
+  {
+    int capacity = m_Capacity ? m_Capacity * 2 : 32;
+    Frame* frames = new Frame[ capacity ];
+    if( m_Depth )
+    {
+      memcpy( frames, m_Frames, m_Depth * sizeof( Frame ) );
+    }
+    delete[] m_Frames;
+    m_Frames   = frames;
+    m_Capacity = capacity;
+  }
+  m_Frames[ m_Depth ].m_Handler  = handler;
+  m_Frames[ m_Depth ].m_IsObject = is_object;
+  m_Depth += 1;
+}
+
+void JsnPushParser::Pop()
+{
+  m_Depth -= 1;
+  const Frame& frame = m_Frames[ m_Depth ];
+  if( frame.m_IsObject )
+  {
+    Current()->EndObject( frame.m_Handler );
+  }
+  else
+  {
+    Current()->EndArray( frame.m_Handler );
+  }
+  CheckStop( Current() );
+}
+
+void JsnPushParser::EndValue()
+{
+  m_State = m_Depth ? kState_CommaOrEnd : kState_Done;
+}
+
+void JsnPushParser::CheckStop( JsnHandler* handler )
+{
+  if( handler && handler->IsStopRequested() )
+  {
+    handler->ClearStopRequest();
+    m_Stop = true;
+  }
+}
+
+void JsnPushParser::Stop()
+{
+  while( m_Depth )
+  {
+    Pop();
+  }
+  m_State      = kState_Stopped;
+  m_TokenBegin = NULL;
+  m_Stop       = false;
+}
+
+/****************************************************************************************************************/
+
+bool JsnPushParser::Feed( const char* text, int64_t length )
+{
+  if( m_Error )
+  {
+    return false;
+  }
+  if( m_State == kState_Stopped )
+  {
+    return true;
+  }
+
+  m_Chunk = text;
+  const char* p = text;
+  const char* end = text + length;
+  while( p < end && !m_Error )
+  {
+    switch( m_State )
+    {
+      case kState_String:
+        p = ParseString( p, end );
+        break;
+      case kState_Number:
+        p = ParseNumber( p, end );
+        break;
+      case kState_Literal:
+        p = ParseLiteral( p, end );
+        break;
+      case kState_Skip:
+        p = ParseSkip( p, end );
+        break;
+      default:
+        if( ( uint8_t )*p <= ' ' )
+        {
+          p += 1;
+        }
+        else
+        {
+          p = ParseStructural( p );
+        }
+        break;
+    }
+    if( m_Stop )
+    {
+      Stop();
+      m_Count += p - text;
+      m_Chunk = NULL;
+      return true;
+    }
+  }
+
+  if( m_Error )
+  {
+    return false;
+  }
+
+  // Anything that still points into this piece must be kept, because the piece will be gone by the
+  // time the next one arrives.
+  if( m_TokenBegin )
+  {
+    m_Token.m_Length = 0;
+    m_Token.Append( m_TokenBegin, end - m_TokenBegin );
+    m_TokenBegin = NULL;
+  }
+  if( m_NameInChunk )
+  {
+    m_NameBuffer.m_Length = 0;
+    m_NameBuffer.Append( m_Name.m_Text, m_Name.m_Length );
+    uint32_t flags = m_Name.m_Flags;
+    m_Name = JsnFragment( kJsn_String, m_NameBuffer.m_Data, m_NameBuffer.m_Length );
+    m_Name.m_Flags = flags;
+    m_NameInChunk = false;
+  }
+
+  m_Count += length;
+  m_Chunk = NULL;
+  return true;
+}
+
+bool JsnPushParser::Finish()
+{
+  if( m_Error )
+  {
+    return false;
+  }
+
+  m_Chunk = NULL;
+  if( m_State == kState_Number )
+  {
+    // Nothing follows the number to tell us it's complete, except the end of the text
+    AddNumber( JsnFragment( kJsn_Int, m_Token.m_Data, m_Token.m_Length ) );
+    if( m_Stop )
+    {
+      Stop();
+    }
+  }
+  if( m_State != kState_Done && m_State != kState_Stopped )
+  {
+    SetError( "Unexpected end of input data", NULL );
+  }
+  return !m_Error;
+}
+
+/****************************************************************************************************************/
+
+const char* JsnPushParser::ParseStructural( const char* p )
+{
+  int c = ( uint8_t )*p;
+  switch( m_State )
+  {
+    case kState_ValueOrEnd:
+      if( c == ']' )
+      {
+        Pop();
+        EndValue();
+        return p + 1;
+      }
+      return ParseValue( p );
+
+    case kState_Value:
+      return ParseValue( p );
+
+    case kState_NameOrEnd:
+      if( c == '}' )
+      {
+        Pop();
+        EndValue();
+        return p + 1;
+      }
+      if( c != '"' )
+      {
+        SetError( "String expected", p );
+        return p;
+      }
+      m_State       = kState_String;
+      m_TokenIsName = true;
+      m_TokenBegin  = p + 1;
+      m_Token.m_Length = 0;
+      m_Escape      = false;
+      m_Escaped     = false;
+      return p + 1;
+
+    case kState_Colon:
+      if( c != ':' )
+      {
+        SetError( "\":\" expected", p );
+        return p;
+      }
+      m_State = kState_Value;
+      return p + 1;
+
+    case kState_CommaOrEnd:
+    {
+      bool is_object = m_Frames[ m_Depth - 1 ].m_IsObject;
+      if( c == ',' )
+      {
+        // JsnParse() tolerates a trailing comma, so we do too
+        m_State = is_object ? kState_NameOrEnd : kState_ValueOrEnd;
+      }
+      else if( c == ( is_object ? '}' : ']' ) )
+      {
+        Pop();
+        EndValue();
+      }
+      else
+      {
+        SetError( is_object ? "\"}\" expected" : "\"]\" expected", p );
+        return p;
+      }
+      return p + 1;
+    }
+
+    default:
+      SetError( "Unexpected character after value", p );
+      return p;
+  }
+}
+
+const char* JsnPushParser::ParseValue( const char* p )
+{
+  switch( *p )
+  {
+    case '"':
+      m_State       = kState_String;
+      m_TokenIsName = false;
+      m_TokenBegin  = p + 1;
+      m_Token.m_Length = 0;
+      m_Escape      = false;
+      m_Escaped     = false;
+      return p + 1;
+
+    case '{':
+    case '[':
+    {
+      bool is_object = *p == '{';
+      JsnHandler* parent = Current();
+      JsnHandler* handler = is_object ? parent->BeginObject( CurrentName() ) : parent->BeginArray( CurrentName() );
+      CheckStop( parent );
+      if( handler )
+      {
+        Push( handler, is_object );
+        m_State = is_object ? kState_NameOrEnd : kState_ValueOrEnd;
+      }
+      else
+      {
+        m_State        = kState_Skip;
+        m_SkipDepth    = 1;
+        m_SkipInString = false;
+        m_Escape       = false;
+      }
+      return p + 1;
+    }
+
+    case 't':
+      m_State       = kState_Literal;
+      m_Literal     = "true";
+      m_LiteralType = kJsn_True;
+      return p;
+
+    case 'f':
+      m_State       = kState_Literal;
+      m_Literal     = "false";
+      m_LiteralType = kJsn_False;
+      return p;
+
+    case 'n':
+      m_State       = kState_Literal;
+      m_Literal     = "null";
+      m_LiteralType = kJsn_Null;
+      return p;
+
+    case '-':
+    case '.':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      m_State       = kState_Number;
+      m_TokenBegin  = p;
+      m_Token.m_Length = 0;
+      m_NumberPhase = 0;
+      return p;
+
+    default:
+      SetError( "Unexpected character", p );
+      return p;
+  }
+}
+
+const char* JsnPushParser::ParseString( const char* p, const char* end )
+{
+  const char* s = p;
+  bool escape = m_Escape;
+  while( s < end )
+  {
+    char c = *s;
+    if( escape )
+    {
+      escape = false;
+    }
+    else if( c == '\\' )
+    {
+      escape = true;
+      m_Escaped = true;
+    }
+    else if( c == '"' )
+    {
+      break;
+    }
+    s += 1;
+  }
+  m_Escape = escape;
+
+  if( s == end )
+  {
+    if( !m_TokenBegin )
+    {
+      m_Token.Append( p, s - p );
+    }
+    return end;
+  }
+
+  JsnFragment text;
+  if( m_TokenBegin )
+  {
+    text = JsnFragment( kJsn_String, m_TokenBegin, s );
+  }
+  else
+  {
+    m_Token.Append( p, s - p );
+    text = JsnFragment( kJsn_String, m_Token.m_Data, m_Token.m_Length );
+  }
+  text.m_Flags = m_Escaped ? kJsnFlag_Escaped : 0;
+  AddString( text );
+  return s + 1;
+}
+
+void JsnPushParser::AddString( const JsnFragment& text )
+{
+  if( m_TokenIsName )
+  {
+    if( m_TokenBegin )
+    {
+      m_Name = text;
+      m_NameInChunk = true;
+    }
+    else
+    {
+      m_NameBuffer.m_Length = 0;
+      m_NameBuffer.Append( text.m_Text, text.m_Length );
+      m_Name = JsnFragment( kJsn_String, m_NameBuffer.m_Data, m_NameBuffer.m_Length );
+      m_Name.m_Flags = text.m_Flags;
+      m_NameInChunk = false;
+    }
+    m_State = kState_Colon;
+  }
+  else
+  {
+    Current()->AddProperty( CurrentName(), text );
+    CheckStop( Current() );
+    EndValue();
+  }
+  m_TokenBegin = NULL;
+}
+
+const char* JsnPushParser::ParseNumber( const char* p, const char* end )
+{
+  // Accepts the same text as JsnParse(): optional minus, digits, optional fraction, optional exponent
+  const char* s = p;
+  for( ; s < end; ++s )
+  {
+    char c = *s;
+    bool digit = c >= '0' && c <= '9';
+    if( m_NumberPhase == 0 )
+    {
+      m_NumberPhase = 1;
+      if( c == '-' )
+      {
+        continue;
+      }
+    }
+    if( m_NumberPhase == 1 )
+    {
+      if( digit )
+      {
+        continue;
+      }
+      if( c == '.' )
+      {
+        m_NumberPhase = 2;
+        continue;
+      }
+    }
+    if( m_NumberPhase == 1 || m_NumberPhase == 2 )
+    {
+      if( digit )
+      {
+        continue;
+      }
+      if( c == 'e' || c == 'E' )
+      {
+        m_NumberPhase = 3;
+        continue;
+      }
+      break;
+    }
+    if( m_NumberPhase == 3 )
+    {
+      m_NumberPhase = 4;
+      if( c == '-' || c == '+' )
+      {
+        continue;
+      }
+    }
+    if( !digit )
+    {
+      break;
+    }
+  }
+
+  if( s == end )
+  {
+    if( !m_TokenBegin )
+    {
+      m_Token.Append( p, s - p );
+    }
+    return end;
+  }
+
+  if( m_TokenBegin )
+  {
+    AddNumber( JsnFragment( kJsn_Int, m_TokenBegin, s ) );
+  }
+  else
+  {
+    m_Token.Append( p, s - p );
+    AddNumber( JsnFragment( kJsn_Int, m_Token.m_Data, m_Token.m_Length ) );
+  }
+  return s;
+}
+
+void JsnPushParser::AddNumber( const JsnFragment& text )
+{
+  JsnFragment value;
+  JsnParseNumber( text.m_Text, text.m_Length, &value );
+  Current()->AddProperty( CurrentName(), value );
+  CheckStop( Current() );
+  EndValue();
+  m_TokenBegin = NULL;
+}
+
+const char* JsnPushParser::ParseLiteral( const char* p, const char* end )
+{
+  while( p < end && *m_Literal )
+  {
+    if( *p != *m_Literal )
+    {
+      SetError( "Syntax error", p );
+      return p;
+    }
+    p += 1;
+    m_Literal += 1;
+  }
+  if( !*m_Literal )
+  {
+    Current()->AddProperty( CurrentName(), JsnFragment( m_LiteralType ) );
+    CheckStop( Current() );
+    EndValue();
+  }
+  return p;
+}
+
+const char* JsnPushParser::ParseSkip( const char* p, const char* end )
+{
+  // Only quotes and brackets matter. The contents are not checked for errors.
+  bool in_string = m_SkipInString;
+  bool escape = m_Escape;
+  for( ; p < end; ++p )
+  {
+    char c = *p;
+    if( in_string )
+    {
+      if( escape )
+      {
+        escape = false;
+      }
+      else if( c == '\\' )
+      {
+        escape = true;
+      }
+      else if( c == '"' )
+      {
+        in_string = false;
+      }
+    }
+    else if( c == '"' )
+    {
+      in_string = true;
+    }
+    else if( c == '{' || c == '[' )
+    {
+      m_SkipDepth += 1;
+    }
+    else if( ( c == '}' || c == ']' ) && --m_SkipDepth == 0 )
+    {
+      EndValue();
+      return p + 1;
+    }
+  }
+  m_SkipInString = in_string;
+  m_Escape = escape;
+  return end;
+}
+
+/****************************************************************************************************************/
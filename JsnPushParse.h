@@ -0,0 +1,189 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \class JsnPushParser
+ Parse JSON text that arrives in pieces, for example from a socket. Feed() each piece as it arrives,
+ and call Finish() after the last one. The handler receives the same calls as it would from JsnParse()
+ on the complete text.
+
+ The parser keeps its nesting state in an explicit stack, so it can stop at the end of any piece,
+ including in the middle of a string or number, and pick up where it left off with the next piece.
+ Fragments point straight into the piece being fed. Only a string or number that is split between
+ two pieces, or a property name whose value is in a later piece, is copied into an internal buffer.
+ Fragments are valid only for the duration of the handler call.
+
+ Unlike JsnParse(), which ignores anything after the first value, the push parser treats anything but
+ whitespace after the value as an error.
+
+ Handlers can skip objects and arrays, and stop the parse, just like with JsnParse(). After a stop, Feed()
+ and Finish() ignore the rest of the text and return true.
+
+ \code
+ JsnPushParser parser( &handler );
+ while( int length = Receive( buf, sizeof( buf ) ) )
+ {
+   if( !parser.Feed( buf, length ) )
+   {
+     break;
+   }
+ }
+ if( !parser.Finish() )
+ {
+   printf( "ERROR: %s at offset %lld\n", parser.GetError(), ( long long )parser.GetCount() );
+ }
+ \endcode
+ */
+class JsnPushParser
+{
+public:
+
+  /**
+   Construct with a handler that will receive the top level value.
+   \param[ in ] reader Handler implementation.
+   */
+  JsnPushParser( JsnHandler* reader );
+  ~JsnPushParser();
+
+  /**
+   Get ready to parse a new text. Containers left open by an unfinished parse are ended first.
+   \param[ in ] reader Handler implementation.
+   */
+  void Reset( JsnHandler* reader );
+
+  /**
+   Parse the next piece of text.
+   \param[ in ] text Start of text, not necessarily zero terminated.
+   \param[ in ] length Length of text.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Feed( const char* text, int64_t length );
+
+  /**
+   Signal the end of the text. Completes a number at the very end of the text, and checks that the
+   top level value is complete.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Finish();
+
+  /**
+   Return error string.
+   \return Error string, or NULL if no error.
+   */
+  const char* GetError() const { return m_Error; }
+
+  /**
+   Return number of characters consumed. After an error, this is the offset of the offending
+   character.
+   \return Number of characters consumed.
+   */
+  int64_t GetCount() const { return m_Count; }
+
+private:
+
+  enum State
+  {
+    kState_Value,       // Expecting a value
+    kState_ValueOrEnd,  // Expecting a value or ']'
+    kState_NameOrEnd,   // Expecting a property name or '}'
+    kState_Colon,       // Expecting ':'
+    kState_CommaOrEnd,  // Expecting ',' or the closing bracket
+    kState_String,      // Inside a string
+    kState_Number,      // Inside a number
+    kState_Literal,     // Inside true, false or null
+    kState_Skip,        // Inside an object or array that the handler skips
+    kState_Done,        // Top level value complete
+    kState_Stopped      // A handler called RequestStop()
+  };
+
+  struct Frame
+  {
+    JsnHandler* m_Handler;
+    bool        m_IsObject;
+  };
+
+  struct Buffer
+  {
+    char*   m_Data;
+    int64_t m_Length;
+    int64_t m_Capacity;
+
+    Buffer();
+    ~Buffer();
+    void Append( const char* text, int64_t length );
+  };
+
+  JsnHandler*   m_Reader;
+  Frame*        m_Frames;
+  int           m_Depth;
+  int           m_Capacity;
+  State         m_State;
+  const char*   m_Error;
+  int64_t       m_Count;
+  const char*   m_Chunk;        // Piece currently being fed
+
+  const char*   m_TokenBegin;   // Start of string or number in current piece, or NULL if in m_Token
+  Buffer        m_Token;
+  bool          m_TokenIsName;
+  bool          m_Escape;
+  bool          m_Escaped;      // Current string contains escape sequences
+  int           m_NumberPhase;
+  const char*   m_Literal;
+  JsnType       m_LiteralType;
+  int64_t       m_SkipDepth;    // Bracket nesting inside skipped object or array
+  bool          m_SkipInString;
+  bool          m_Stop;         // A handler called RequestStop() during the current step
+
+  JsnFragment   m_Name;         // Name of next property
+  bool          m_NameInChunk;  // m_Name points into current piece, rather than m_NameBuffer
+  Buffer        m_NameBuffer;
+
+  JsnHandler*   Current() const { return m_Depth ? m_Frames[ m_Depth - 1 ].m_Handler : m_Reader; }
+  JsnFragment   CurrentName() const;
+  void          SetError( const char* msg, const char* p );
+  void          Push( JsnHandler* handler, bool is_object );
+  void          Pop();
+  void          EndValue();
+  void          CheckStop( JsnHandler* handler );
+  void          Stop();
+  const char*   ParseStructural( const char* p );
+  const char*   ParseValue( const char* p );
+  const char*   ParseString( const char* p, const char* end );
+  const char*   ParseNumber( const char* p, const char* end );
+  const char*   ParseLiteral( const char* p, const char* end );
+  const char*   ParseSkip( const char* p, const char* end );
+  void          AddString( const JsnFragment& text );
+  void          AddNumber( const JsnFragment& text );
+
+  JsnPushParser( const JsnPushParser& other );
+  JsnPushParser& operator=( const JsnPushParser& other );
+};
+
+/****************************************************************************************************************/
@@ -0,0 +1,115 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnReader.h"
+
+#include <string.h>
+#include <stdint.h>
+
+/****************************************************************************************************************/
+
+// Compare a property name with text. The hash rejects most other names without looking at the text.
+static bool NameEquals( const JsnFragment& name, const char* text, int64_t length, uint32_t hash )
+{
+  if( ( name.m_Flags & kJsnFlag_Hashed ) && name.m_Value.key.hash != hash )
+  {
+    return false;
+  }
+  return name.IsKey( text, length );
+}
+
+/****************************************************************************************************************/
+
+JsnReader::JsnReader( JsnStreamIn* stream, const JsnParseOptions& options )
+: m_Stream( stream )
+, m_Context( stream, options )
+, m_Pending( kJsn_Undefined )
+, m_HaveName( false )
+, m_AtEnd( false )
+, m_Started( false )
+, m_Depth( 0 )
+{
+  JsnParseContext::Validate( stream, options );
+}
+
+bool JsnReader::Enter( JsnType type )
+{
+  if( m_Pending != type || m_Stream->GetError() )
+  {
+    return false;
+  }
+  if( m_Depth >= JSN_READER_MAX_DEPTH )
+  {
+    m_Stream->SetError( "Nesting too deep for JsnReader" );
+    return false;
+  }
+  m_Stream->Read(); // Skip open bracket
+  m_Frames[ m_Depth ].m_IsObject = type == kJsn_Object;
+  m_Frames[ m_Depth ].m_First = true;
+  m_Depth += 1;
+  m_Pending = kJsn_Undefined;
+  return true;
+}
+
+void JsnReader::Leave()
+{
+  if( !m_Depth )
+  {
+    return;
+  }
+  while( NextMember() )
+  {
+    m_Context.SkipValue();
+  }
+  m_Depth -= 1;
+  m_AtEnd = false;
+}
+
+bool JsnReader::SkipValue()
+{
+  if( !NextMember() )
+  {
+    return false;
+  }
+  m_Context.SkipValue();
+  return !m_Stream->GetError();
+}
+
+bool JsnReader::FindKey( const char* name )
+{
+  int64_t length = ( int64_t )strlen( name );
+  uint32_t hash = m_Context.m_HashKeys ? JsnHashKey( name, length ) : 0;
+  while( NextKey() )
+  {
+    if( NameEquals( m_Name, name, length, hash ) )
+    {
+      return true;
+    }
+    SkipValue();
+  }
+  return false;
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,340 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+#include "JsnParseStatic.h"
+#include "JsnStream.h"
+
+#include <stdint.h>
+
+/**
+ Maximum nesting depth of objects and arrays that JsnReader can enter. Entering deeper sets an error on the
+ stream. Define before including this header to change it.
+ */
+#ifndef JSN_READER_MAX_DEPTH
+#define JSN_READER_MAX_DEPTH 256
+#endif
+
+/************************************************************************************************************/ /**
+ \class JsnReader
+ Read JSON text one value at a time, rather than having the parser call a handler. The code that consumes
+ the text drives the parse, so it can read nested data straight into its own structures, with ordinary
+ control flow instead of a handler per nesting level.
+
+ Next() returns the next value of the current object or array, with its name in GetName(). Strings and
+ numbers are returned as the parser passes them to JsnHandler::AddProperty(). For an object or array, Next()
+ returns a fragment of type kJsn_Object or kJsn_Array, and leaves the contents unread: call EnterObject() or
+ EnterArray() to read them, or just carry on to skip them. At the end of the object or array, Next() returns
+ a fragment of type kJsn_Undefined. Call Leave() to return to the parent, whether the end was reached or
+ not.
+
+ Nothing is allocated, and nesting is kept in a fixed size stack. Fragments point into the stream's text,
+ and stay valid as long as it does. The options work as for JsnParse(), except that m_Filter is not used.
+
+ \code
+ JsnReader reader( &stream );
+ if( reader.Next().m_Type == kJsn_Object && reader.EnterObject() )
+ {
+   if( reader.FindKey( "id" ) )
+   {
+     id = reader.Next().AsInt();
+   }
+   if( reader.FindKey( "tags" ) && reader.Next().m_Type == kJsn_Array && reader.EnterArray() )
+   {
+     for( JsnFragment tag = reader.Next(); tag.m_Type != kJsn_Undefined; tag = reader.Next() )
+     {
+       AddTag( tag );
+     }
+     reader.Leave();
+   }
+   reader.Leave();
+ }
+ if( reader.GetError() )
+ {
+   printf( "ERROR: %s at offset %lld\n", reader.GetError(), ( long long )stream.GetCount() );
+ }
+ \endcode
+ */
+class JsnReader
+{
+public:
+
+  /**
+   Construct at the read position of a stream. The stream should hold a single top level value.
+   \param[ in ] stream Input stream.
+   \param[ in ] options Settings.
+   */
+  JsnReader( JsnStreamIn* stream, const JsnParseOptions& options = JsnParseOptions() );
+
+  /**
+   Read the next value of the current object or array, or the top level value.
+   \return The value, kJsn_Object or kJsn_Array for the start of an object or array, or kJsn_Undefined at
+   the end of the current object or array, and on error.
+   */
+  JsnFragment Next();
+
+  /**
+   Return the name of the value last returned by Next().
+   \return Name, or an empty fragment of type kJsn_Undefined for array elements and the top level value.
+   */
+  const JsnFragment& GetName() const { return m_Name; }
+
+  /**
+   Step into the object that Next() just returned. Next() then returns its properties.
+   \return true if successful, false if the last value was not an object, or on error.
+   */
+  bool EnterObject() { return Enter( kJsn_Object ); }
+
+  /**
+   Step into the array that Next() just returned. Next() then returns its elements.
+   \return true if successful, false if the last value was not an array, or on error.
+   */
+  bool EnterArray() { return Enter( kJsn_Array ); }
+
+  /**
+   Skip what is left of the current object or array, and return to its parent. Next() then returns the
+   value after it.
+   */
+  void Leave();
+
+  /**
+   Skip the next value of the current object or array. Strings and numbers are not decoded, and objects
+   and arrays are skipped by their brackets.
+   \return true if a value was skipped, false at the end of the current object or array, and on error.
+   */
+  bool SkipValue();
+
+  /**
+   Read the name of the next property of the current object into GetName(), and leave its value unread. The
+   next call to Next() returns the value, and SkipValue() skips it. If the value is still unread when
+   NextKey() is called again, it is skipped.
+   \return true if there is another property, false at the end of the object, if the reader is not in an
+   object, and on error.
+   */
+  bool NextKey();
+
+  /**
+   Skip forward through the current object to the property with the given name. The next call to Next()
+   returns its value. Properties before it are skipped as with SkipValue(), so to find several properties,
+   look for them in the order they appear in the text. Names with escape sequences are compared decoded.
+   \param[ in ] name Zero terminated name, UTF-8.
+   \return true if found, false if the rest of the object does not have the property, or the reader is not
+   in an object.
+   */
+  bool FindKey( const char* name );
+
+  /**
+   Return the number of objects and arrays entered and not left.
+   \return Depth. Zero at the top level.
+   */
+  int GetDepth() const { return m_Depth; }
+
+  /**
+   Return error string.
+   \return Error string, or NULL if no error.
+   */
+  const char* GetError() const { return m_Stream->GetError(); }
+
+  /**
+   Set error string, and stop reading. Use to report values that the caller cannot accept.
+   \param[ in ] error Error string.
+   */
+  void SetError( const char* error ) { m_Stream->SetError( error ); }
+
+private:
+
+  struct Frame
+  {
+    bool          m_IsObject;
+    bool          m_First;      // No property or element read yet
+  };
+
+  JsnStreamIn*    m_Stream;
+  JsnParseContext m_Context;
+  JsnFragment     m_Name;
+  JsnType         m_Pending;    // Object or array returned by Next(), and not entered. Skipped if not entered.
+  bool            m_HaveName;   // NextKey() read the name of the next property
+  bool            m_AtEnd;      // Closing bracket of the current object or array read
+  bool            m_Started;    // Top level value read
+  int             m_Depth;
+  Frame           m_Frames[ JSN_READER_MAX_DEPTH ];
+
+  bool            NextMember();
+  JsnFragment     ReadValue();
+  bool            Enter( JsnType type );
+
+  JsnReader( const JsnReader& other );
+  JsnReader& operator=( const JsnReader& other );
+};
+
+/****************************************************************************************************************/
+
+// Move to the next property or element, and read the name of a property. Returns false at the end of the
+// current object or array, after reading its closing bracket.
+inline bool JsnReader::NextMember()
+{
+  JsnStreamIn* stream = m_Stream;
+  if( stream->GetError() || m_AtEnd )
+  {
+    return false;
+  }
+  if( m_Pending != kJsn_Undefined )
+  {
+    m_Context.SkipContainer();
+    m_Pending = kJsn_Undefined;
+  }
+  if( m_HaveName )
+  {
+    m_HaveName = false;
+    return !stream->GetError();
+  }
+  m_Context.EatSpace();
+  m_Name = JsnFragment();
+
+  if( !m_Depth )
+  {
+    m_AtEnd = m_Started;
+    m_Started = true;
+    return !m_AtEnd && !stream->GetError();
+  }
+
+  Frame* frame = &m_Frames[ m_Depth - 1 ];
+  int close = frame->m_IsObject ? '}' : ']';
+  if( !frame->m_First && stream->Peek() != close )
+  {
+    if( stream->Peek() != ',' )
+    {
+      stream->SetError( frame->m_IsObject ? "\"}\" expected" : "\"]\" expected" );
+      return false;
+    }
+    stream->Read();
+    m_Context.EatSpace();
+  }
+  // Like JsnParse(), accept a comma before the closing bracket
+  if( stream->Peek() == close )
+  {
+    stream->Read();
+    m_AtEnd = true;
+    return false;
+  }
+  frame->m_First = false;
+
+  if( frame->m_IsObject )
+  {
+    if( stream->Peek() != '"' )
+    {
+      stream->SetError( "String expected" );
+      return false;
+    }
+    m_Name = m_Context.ParseString();
+    if( m_Context.m_HashKeys )
+    {
+      m_Context.HashName( &m_Name );
+    }
+    m_Context.EatSpace();
+    if( stream->Peek() != ':' )
+    {
+      stream->SetError( "\":\" expected" );
+      return false;
+    }
+    stream->Read();
+    m_Context.EatSpace();
+  }
+  return !stream->GetError();
+}
+
+inline JsnFragment JsnReader::ReadValue()
+{
+  switch( m_Stream->Peek() )
+  {
+    case 't':
+      m_Context.ParseLiteral( "true" );
+      return JsnFragment( kJsn_True );
+
+    case 'f':
+      m_Context.ParseLiteral( "false" );
+      return JsnFragment( kJsn_False );
+
+    case 'n':
+      m_Context.ParseLiteral( "null" );
+      return JsnFragment( kJsn_Null );
+
+    case '"':
+      return m_Context.ParseString();
+
+    case '-':
+    case '.':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      return m_Context.ParseNumber();
+
+    case '{':
+      m_Pending = kJsn_Object;
+      return JsnFragment( kJsn_Object );
+
+    case '[':
+      m_Pending = kJsn_Array;
+      return JsnFragment( kJsn_Array );
+
+    default:
+      m_Stream->SetError( "Unexpected character" );
+      return JsnFragment();
+  }
+}
+
+inline JsnFragment JsnReader::Next()
+{
+  if( !NextMember() )
+  {
+    return JsnFragment();
+  }
+  JsnFragment value = ReadValue();
+  return m_Stream->GetError() ? JsnFragment() : value;
+}
+
+inline bool JsnReader::NextKey()
+{
+  if( m_HaveName )
+  {
+    SkipValue();
+  }
+  if( !m_Depth || !m_Frames[ m_Depth - 1 ].m_IsObject || !NextMember() )
+  {
+    return false;
+  }
+  m_HaveName = true;
+  return true;
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,411 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnReformat.h"
+#include "JsnBlock.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined( __SSSE3__ )
+#include <tmmintrin.h>
+#endif
+
+/****************************************************************************************************************/
+
+namespace
+{
+  static const int kBufferSize = 16384;
+
+#if defined( __SSSE3__ )
+
+  // For each combination of eight mask bits, the shuffle that moves the selected bytes of an eight byte lane
+  // to its start, and the number of bytes selected
+  struct ShuffleTable
+  {
+    uint64_t  m_Shuffle[ 256 ];
+    uint8_t   m_Count[ 256 ];
+
+    ShuffleTable()
+    {
+      for( int mask = 0; mask < 256; ++mask )
+      {
+        uint64_t shuffle = ~( uint64_t )0x7F7F7F7F7F7F7F7F; // High bit set: shuffle in a zero
+        int count = 0;
+        for( int i = 0; i < 8; ++i )
+        {
+          if( mask & ( 1 << i ) )
+          {
+            shuffle &= ~( ( uint64_t )0xFF << ( count * 8 ) );
+            shuffle |= ( uint64_t )i << ( count * 8 );
+            count += 1;
+          }
+        }
+        m_Shuffle[ mask ] = shuffle;
+        m_Count[ mask ]   = ( uint8_t )count;
+      }
+    }
+  };
+
+  static const ShuffleTable g_ShuffleTable;
+
+  // Copy the bytes of a 64 byte block whose bits are set in keep, in order. Each eight byte lane is compacted
+  // with a byte shuffle, and stored in full right after the previous one, so the result may be followed by up
+  // to eight bytes of garbage.
+  static inline char* Compact( char* out, const char* in, uint64_t keep )
+  {
+    if( keep == ~( uint64_t )0 )
+    {
+      memcpy( out, in, 64 );
+      return out + 64;
+    }
+    for( int i = 0; i < 64; i += 16, keep >>= 16 )
+    {
+      uint32_t lo = ( uint32_t )keep & 0xFF;
+      uint32_t hi = ( uint32_t )( keep >> 8 ) & 0xFF;
+      __m128i  shuffle = _mm_set_epi64x( ( int64_t )( g_ShuffleTable.m_Shuffle[ hi ] + 0x0808080808080808 ),
+                                         ( int64_t )g_ShuffleTable.m_Shuffle[ lo ] );
+      __m128i  v = _mm_shuffle_epi8( _mm_loadu_si128( ( const __m128i* )( in + i ) ), shuffle );
+      _mm_storel_epi64( ( __m128i* )out, v );
+      out += g_ShuffleTable.m_Count[ lo ];
+      _mm_storel_epi64( ( __m128i* )out, _mm_unpackhi_epi64( v, v ) );
+      out += g_ShuffleTable.m_Count[ hi ];
+    }
+    return out;
+  }
+
+#else
+
+  // Copy the bytes of a 64 byte block whose bits are set in keep, in order, one run of consecutive bytes at a
+  // time. Short runs are copied with a single 16 byte move where the block allows it, so the result may be
+  // followed by up to fifteen bytes of garbage.
+  static inline char* Compact( char* out, const char* in, uint64_t keep )
+  {
+    if( keep == ~( uint64_t )0 )
+    {
+      memcpy( out, in, 64 );
+      return out + 64;
+    }
+    while( keep )
+    {
+      int start  = JsnCountTrailingZeros( keep );
+      int length = JsnCountTrailingZeros( ~( keep >> start ) ); // Bits above 63 - start shift in as zero
+      if( length <= 16 && start <= 48 )
+      {
+        memcpy( out, in + start, 16 );
+      }
+      else
+      {
+        memcpy( out, in + start, ( size_t )length );
+      }
+      out += length;
+      keep &= keep + ( keep & ( ~keep + 1 ) ); // Clear the run: adding its lowest bit carries through it
+    }
+    return out;
+  }
+
+#endif
+
+  // Collects output in a local buffer, and passes it to the stream in large writes.
+  class Output
+  {
+  public:
+
+    Output( JsnStreamOut* stream )
+    : m_Stream( stream )
+    , m_End( m_Buffer )
+    {}
+
+    // Make room for at least one block
+    char* Reserve()
+    {
+      if( m_End - m_Buffer > kBufferSize )
+      {
+        Flush();
+      }
+      return m_End;
+    }
+
+    void Commit( char* end )
+    {
+      m_End = end;
+    }
+
+    void Write( const char* text, int64_t length )
+    {
+      if( m_End - m_Buffer + length > kBufferSize + 64 )
+      {
+        Flush();
+        if( length > kBufferSize )
+        {
+          m_Stream->Write( text, length );
+          return;
+        }
+      }
+      memcpy( m_End, text, ( size_t )length );
+      m_End += length;
+    }
+
+    void Write( char c )
+    {
+      if( m_End - m_Buffer >= kBufferSize + 64 )
+      {
+        Flush();
+      }
+      *m_End++ = c;
+    }
+
+    void Flush()
+    {
+      m_Stream->Write( m_Buffer, m_End - m_Buffer );
+      m_End = m_Buffer;
+    }
+
+  private:
+
+    JsnStreamOut* m_Stream;
+    char*         m_End;
+    char          m_Buffer[ kBufferSize + 64 + 16 ]; // Room for a full block after kBufferSize, plus overrun
+  };
+
+  // Newline followed by the indentation for each depth, precomputed as one string. The line for a depth is
+  // the start of the string, up to the indentation for that depth.
+  class Lines
+  {
+  public:
+
+    Lines( const JsnWriter::Style* style )
+    : m_Newline( style->m_NewlineString.m_Length )
+    , m_Indent( style->m_IndentString.m_Length )
+    , m_Style( style )
+    , m_Text( NULL )
+    , m_Depth( 0 )
+    {
+      Grow( 16 );
+    }
+
+    ~Lines()
+    {
+      delete[] m_Text;
+    }
+
+    void Write( Output* output, int depth )
+    {
+      if( depth > m_Depth )
+      {
+        Grow( depth * 2 );
+      }
+      output->Write( m_Text, m_Newline + m_Indent * depth );
+    }
+
+  private:
+
+    int64_t                 m_Newline;
+    int64_t                 m_Indent;
+    const JsnWriter::Style* m_Style;
+    char*                   m_Text;
+    int                     m_Depth;
+
+    Lines( const Lines& other );
+
+    void Grow( int depth )
+    {
+      delete[] m_Text;
+      m_Depth = depth;
+      m_Text  = new char[ m_Newline + m_Indent * depth + 1 ];
+      memcpy( m_Text, m_Style->m_NewlineString.m_Text, ( size_t )m_Newline );
+      for( int i = 0; i < depth; ++i )
+      {
+        memcpy( m_Text + m_Newline + m_Indent * i, m_Style->m_IndentString.m_Text, ( size_t )m_Indent );
+      }
+    }
+  };
+
+  // Classify the block at base. The last, partial block is copied to tail first, padded with whitespace, so
+  // that Compact() can read all 64 bytes. Returns the block's bytes.
+  static inline const char* Classify( const char* text, int64_t length, int64_t base, char* tail,
+                                      JsnBlock* block, uint64_t* valid )
+  {
+    int64_t remaining = length - base;
+    if( remaining >= 64 )
+    {
+      JsnClassifyBlock( ( const uint8_t* )text + base, block );
+      *valid = ~( uint64_t )0;
+      return text + base;
+    }
+    memset( tail, ' ', 64 );
+    memcpy( tail, text + base, ( size_t )remaining );
+    JsnClassifyBlock( ( const uint8_t* )tail, block );
+    *valid = ( ( uint64_t )1 << remaining ) - 1;
+    return tail;
+  }
+}
+
+/****************************************************************************************************************/
+
+bool JsnMinify( JsnStreamOut* out, JsnStreamIn* in )
+{
+  const char*   text = in->GetCurrent();
+  int64_t       length = in->GetRemaining();
+  JsnStringMask strings;
+  Output        output( out );
+  char          tail[ 64 ];
+
+  for( int64_t base = 0; base < length; base += 64 )
+  {
+    JsnBlock    block;
+    uint64_t    valid;
+    uint64_t    quotes;
+    const char* p = Classify( text, length, base, tail, &block, &valid );
+    uint64_t    in_string = strings.Next( block, &quotes );
+
+    // Closing quotes are not whitespace, so they need no special treatment
+    uint64_t keep = ( ~block.m_Whitespace | in_string ) & valid;
+    if( keep )
+    {
+      output.Commit( Compact( output.Reserve(), p, keep ) );
+    }
+  }
+  output.Flush();
+
+  if( strings.m_PrevInString )
+  {
+    in->SetError( "Unterminated string" );
+  }
+  in->Seek( in->GetCount() + length );
+  return !in->GetError() && !out->GetError();
+}
+
+/****************************************************************************************************************/
+
+bool JsnPrettify( JsnStreamOut* out, JsnStreamIn* in, const JsnWriter::Style* style )
+{
+  static const JsnWriter::Style default_style;
+
+  const char*   text = in->GetCurrent();
+  int64_t       length = in->GetRemaining();
+  JsnStringMask strings;
+  Output        output( out );
+  char          tail[ 64 ];
+  Lines         lines( style ? style : &default_style );
+  JsnFragment   colon = ( style ? style : &default_style )->m_SpaceAfterColonString;
+  int           depth = 0;
+  bool          new_item = false; // Set after '{', '[' and ',': a line break is due before what follows
+
+  for( int64_t base = 0; base < length; base += 64 )
+  {
+    JsnBlock    block;
+    uint64_t    valid;
+    uint64_t    quotes;
+    const char* p = Classify( text, length, base, tail, &block, &valid );
+    uint64_t    in_string = strings.Next( block, &quotes );
+
+    uint64_t structural = block.m_Structural & ~in_string & valid;
+    uint64_t keep = ( ~block.m_Whitespace | in_string ) & ~structural & valid;
+
+    // Copy the run of kept bytes before each structural character, then handle the character itself
+    while( structural )
+    {
+      uint64_t bit = structural & ( ~structural + 1 );
+      uint64_t run = keep & ( bit - 1 );
+      keep &= ~run;
+      structural ^= bit;
+
+      if( run )
+      {
+        if( new_item && depth )
+        {
+          lines.Write( &output, depth );
+        }
+        new_item = false;
+        output.Commit( Compact( output.Reserve(), p, run ) );
+      }
+
+      char c = p[ JsnCountTrailingZeros( bit ) ];
+      switch( c )
+      {
+        case '{':
+        case '[':
+          if( new_item && depth )
+          {
+            lines.Write( &output, depth );
+          }
+          output.Write( c );
+          ++depth;
+          new_item = true;
+          break;
+        case '}':
+        case ']':
+          if( depth == 0 )
+          {
+            in->Seek( in->GetCount() + base + JsnCountTrailingZeros( bit ) );
+            in->SetError( "Unexpected closing bracket" );
+            return false;
+          }
+          --depth;
+          new_item = false;
+          lines.Write( &output, depth );
+          output.Write( c );
+          if( c == '}' && depth == 0 )
+          {
+            lines.Write( &output, 0 );
+          }
+          break;
+        case ',':
+          output.Write( c );
+          new_item = true;
+          break;
+        default: // ':'
+          output.Write( c );
+          output.Write( colon.m_Text, colon.m_Length );
+          break;
+      }
+    }
+
+    if( keep )
+    {
+      if( new_item && depth )
+      {
+        lines.Write( &output, depth );
+      }
+      new_item = false;
+      output.Commit( Compact( output.Reserve(), p, keep ) );
+    }
+  }
+  output.Flush();
+
+  in->Seek( in->GetCount() + length );
+  if( strings.m_PrevInString )
+  {
+    in->SetError( "Unterminated string" );
+  }
+  else if( depth )
+  {
+    in->SetError( "Unexpected end of input data" );
+  }
+  return !in->GetError() && !out->GetError();
+}
+
+/****************************************************************************************************************/
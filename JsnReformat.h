@@ -0,0 +1,56 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnParse.h"
+#include "JsnStream.h"
+
+/************************************************************************************************************/ /**
+ Copy JSON text without insignificant whitespace. Strings, numbers and literals are copied as they are, and
+ are not decoded or checked. This is much faster than passing the text through JsnParse() to a compact
+ JsnWriter, but the text is not validated: the output is only valid JSON if the input was.
+
+ The text should hold a single value. Whitespace between top level values is removed as well, so for JSON
+ Lines, minify each line on its own.
+ \param[ in ] out Output stream.
+ \param[ in ] in Input stream. All remaining text is read.
+ \return true if successful, false if not. Call in->GetError() and out->GetError() for details. The only
+ error detected in the input is an unterminated string.
+ */
+bool JsnMinify( JsnStreamOut* out, JsnStreamIn* in );
+
+/************************************************************************************************************/ /**
+ Copy JSON text with newlines and indentation, in the same layout as JsnWriter. Existing whitespace outside
+ strings is replaced. Strings, numbers and literals are copied as they are, and are not decoded or checked,
+ so m_EscapeUTF8 in the style has no effect. Only strings and the balance of brackets are checked, so the
+ output is only valid JSON if the input was.
+ \param[ in ] out Output stream.
+ \param[ in ] in Input stream. All remaining text is read.
+ \param[ in ] style Indentation, newline and space after colon. NULL for the JsnWriter defaults.
+ \return true if successful, false if not. Call in->GetError() and out->GetError() for details.
+ */
+bool JsnPrettify( JsnStreamOut* out, JsnStreamIn* in, const JsnWriter::Style* style = NULL );
+
+/****************************************************************************************************************/
@@ -0,0 +1,56 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+
+ Internal helper to grow the arrays of JsnPathFilter and JsnKeyDictionary. Not part of the public interface.
+ */
+#pragma once
+
+#include <string.h>
+
+/****************************************************************************************************************/
+
+/**
+ Make room for needed elements in an array allocated with new[]. The capacity doubles, starting at 16, and the
+ first count elements are copied over, so T must be trivially copyable.
+ */
+template< typename T, typename N >
+void JsnReserve( T** array, N count, N* capacity, N needed )
+{
+  if( needed > *capacity )
+  {
+    N new_capacity = *capacity ? *capacity * 2 : 16;
+    while( new_capacity < needed )
+    {
+      new_capacity *= 2;
+    }
+    T* new_array = new T[ new_capacity ];
+    if( count )
+    {
+      memcpy( new_array, *array, count * sizeof( T ) );
+    }
+    delete[] *array;
+    *array = new_array;
+    *capacity = new_capacity;
+  }
+}
@@ -0,0 +1,145 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+#include "JsnSink.h"
+
+#include <string.h>
+
+#if defined( _WIN32 )
+#include <io.h>
+#else
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+/****************************************************************************************************************/
+
+JsnBufferSink::JsnBufferSink( int64_t initial_size )
+: m_Data( NULL )
+, m_Size( 0 )
+, m_Capacity( initial_size > 2 ? initial_size : 2 )
+{}
+
+JsnBufferSink::~JsnBufferSink()
+{
+  delete[] m_Data;
+}
+
+char* JsnBufferSink::Flush( char* buf, int64_t count, int64_t* buf_size )
+{
+  ( void )buf; // Always points into m_Data, right after the data flushed before
+  m_Size += count;
+  // Keep one character for the zero terminator
+  if( !m_Data || m_Size + 1 >= m_Capacity )
+  {
+    int64_t capacity = m_Data ? m_Capacity * 2 : m_Capacity;
+    char* data = new char[ capacity ];
+    if( m_Data )
+    {
+      memcpy( data, m_Data, ( size_t )m_Size );
+      delete[] m_Data;
+    }
+    m_Data = data;
+    m_Capacity = capacity;
+  }
+  m_Data[ m_Size ] = 0;
+  *buf_size = m_Capacity - m_Size - 1;
+  return m_Data + m_Size;
+}
+
+/****************************************************************************************************************/
+
+JsnCallbackSink::JsnCallbackSink( JsnSinkCallback callback, void* user_data, int64_t buf_size )
+: m_Callback( callback )
+, m_UserData( user_data )
+, m_Buffer( NULL )
+, m_BufSize( buf_size > 1 ? buf_size : 1 )
+{}
+
+JsnCallbackSink::~JsnCallbackSink()
+{
+  delete[] m_Buffer;
+}
+
+char* JsnCallbackSink::Flush( char* buf, int64_t count, int64_t* buf_size )
+{
+  if( count && !m_Callback( m_UserData, buf, count ) )
+  {
+    return NULL;
+  }
+  if( !m_Buffer )
+  {
+    m_Buffer = new char[ m_BufSize ];
+  }
+  *buf_size = m_BufSize;
+  return m_Buffer;
+}
+
+/****************************************************************************************************************/
+
+JsnFileSink::JsnFileSink( int fd, int64_t buf_size )
+: m_Fd( fd )
+, m_Buffer( NULL )
+, m_BufSize( buf_size > 1 ? buf_size : 1 )
+, m_Error( NULL )
+{}
+
+JsnFileSink::~JsnFileSink()
+{
+  delete[] m_Buffer;
+}
+
+char* JsnFileSink::Flush( char* buf, int64_t count, int64_t* buf_size )
+{
+  while( count > 0 )
+  {
+    // Write in pieces that fit any platform's write()
+    unsigned int piece = count < 0x40000000 ? ( unsigned int )count : 0x40000000;
+#if defined( _WIN32 )
+    int written = _write( m_Fd, buf, piece );
+#else
+    ssize_t written = write( m_Fd, buf, piece );
+    if( written < 0 && errno == EINTR )
+    {
+      continue;
+    }
+#endif
+    if( written <= 0 )
+    {
+      m_Error = "Cannot write to file";
+      return NULL;
+    }
+    buf += written;
+    count -= written;
+  }
+  if( !m_Buffer )
+  {
+    m_Buffer = new char[ m_BufSize ];
+  }
+  *buf_size = m_BufSize;
+  return m_Buffer;
+}
+
+/****************************************************************************************************************/
@@ -0,0 +1,154 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+#pragma once
+
+#include "JsnStream.h"
+
+#include <stdint.h>
+
+/************************************************************************************************************/ /**
+ \class JsnBufferSink
+ Sink that collects all output in one heap buffer, growing it as needed. The stream writes straight into
+ the buffer, so there is no extra copy.
+
+ \code
+ JsnBufferSink sink;
+ JsnStreamOut stream( &sink );
+ JsnWriter writer( &stream );
+ ...
+ stream.Flush();
+ puts( sink.GetData() );
+ \endcode
+ */
+class JsnBufferSink final : public JsnSink
+{
+public:
+
+  /**
+   Construct with an initial buffer size.
+   \param[ in ] initial_size Initial buffer size. The buffer doubles in size whenever it is full.
+   */
+  JsnBufferSink( int64_t initial_size = 4096 );
+  ~JsnBufferSink();
+
+  virtual char* Flush( char* buf, int64_t count, int64_t* buf_size ) override;
+
+  /**
+   Return everything flushed so far. Zero terminated.
+   \return Buffer contents, or NULL if no stream was constructed with this sink yet.
+   */
+  const char* GetData() const { return m_Data; }
+
+  /**
+   Return number of characters flushed so far.
+   \return Size, not counting the zero terminator.
+   */
+  int64_t GetSize() const { return m_Size; }
+
+private:
+
+  char*   m_Data;
+  int64_t m_Size;
+  int64_t m_Capacity;
+
+  JsnBufferSink( const JsnBufferSink& other );
+  JsnBufferSink& operator=( const JsnBufferSink& other );
+};
+
+/**
+ Callback for JsnCallbackSink.
+ \param[ in ] user_data User data that was passed to JsnCallbackSink.
+ \param[ in ] data Characters to consume.
+ \param[ in ] count Number of characters.
+ \return true if successful, false to fail the stream.
+ */
+typedef bool ( *JsnSinkCallback )( void* user_data, const char* data, int64_t count );
+
+/************************************************************************************************************/ /**
+ \class JsnCallbackSink
+ Sink that passes output to a callback, one buffer full at a time.
+ */
+class JsnCallbackSink final : public JsnSink
+{
+public:
+
+  /**
+   Construct with callback.
+   \param[ in ] callback Function to call with each buffer full of output.
+   \param[ in ] user_data Passed on to the callback.
+   \param[ in ] buf_size Size of the buffer.
+   */
+  JsnCallbackSink( JsnSinkCallback callback, void* user_data, int64_t buf_size = 65536 );
+  ~JsnCallbackSink();
+
+  virtual char* Flush( char* buf, int64_t count, int64_t* buf_size ) override;
+
+private:
+
+  JsnSinkCallback m_Callback;
+  void*           m_UserData;
+  char*           m_Buffer;
+  int64_t         m_BufSize;
+
+  JsnCallbackSink( const JsnCallbackSink& other );
+  JsnCallbackSink& operator=( const JsnCallbackSink& other );
+};
+
+/************************************************************************************************************/ /**
+ \class JsnFileSink
+ Sink that writes output to a file descriptor, one buffer full at a time. The descriptor is not closed.
+ */
+class JsnFileSink final : public JsnSink
+{
+public:
+
+  /**
+   Construct with file descriptor.
+   \param[ in ] fd Open file descriptor, for example 1 for standard output.
+   \param[ in ] buf_size Size of the buffer.
+   */
+  JsnFileSink( int fd, int64_t buf_size = 65536 );
+  ~JsnFileSink();
+
+  virtual char* Flush( char* buf, int64_t count, int64_t* buf_size ) override;
+
+  /**
+   Return error string.
+   \return Error string, or NULL if no error.
+   */
+  const char* GetError() const { return m_Error; }
+
+private:
+
+  int         m_Fd;
+  char*       m_Buffer;
+  int64_t     m_BufSize;
+  const char* m_Error;
+
+  JsnFileSink( const JsnFileSink& other );
+  JsnFileSink& operator=( const JsnFileSink& other );
+};
+
+/****************************************************************************************************************/
@@ -51,7 +51,13 @@ public:
    Return number of characters read.
    \return Number of characters read.
    */
-  int GetCount() const { return index; }
+  int64_t GetCount() const { return index; }
+
+  /**
+   Return number of characters left to read.
+   \return Number of characters left, or zero if an error occurred.
+   */
+  int64_t GetRemaining() const { return error ? 0 : index_end - index; }
 
   /**
    Construct from zero terminated string.
@@ -61,7 +67,7 @@ public:
   : data      ( text )
   , error     ( NULL )
   , index     ( 0 )
-  , index_end ( text ? ( int )strlen( text ) : 0 )
+  , index_end ( text ? ( int64_t )strlen( text ) : 0 )
   {}
 
   /**
@@ -69,11 +75,11 @@ public:
    \param[ in ] text Start of text.
    \param[ in ] text_length Length of text.
    */
-  JsnStreamIn( const char* text, int text_length )
+  JsnStreamIn( const char* text, int64_t text_length )
   : data      ( text )
   , error     ( NULL )
   , index     ( 0 )
-  , index_end ( ( int )text_length )
+  , index_end ( text_length )
   {}
 
   /**
@@ -85,7 +91,7 @@ public:
   : data      ( text )
   , error     ( NULL )
   , index     ( 0 )
-  , index_end ( ( int )( text_end - text ) )
+  , index_end ( ( int64_t )( text_end - text ) )
   {}
 
   /**
@@ -129,6 +135,18 @@ public:
     }
   }
 
+  /**
+   Move read position.
+   \param[ in ] position New read position. Will be limited to the end of the data.
+   */
+  void Seek( int64_t position )
+  {
+    if( !error )
+    {
+      index = position < index_end ? position : index_end;
+    }
+  }
+
   /**
    Read next character without moving read position.
    \param[ in ] offset Offset from read position.
@@ -160,21 +178,84 @@ public:
 private:
   const char* data;
   const char* error;
-  int         index;
-  int         index_end;
+  int64_t     index;
+  int64_t     index_end;
+};
+
+/************************************************************************************************************/ /**
+ \interface JsnSink
+ Destination for JsnStreamOut. The stream writes into a buffer provided by the sink, and hands it back
+ when it is full, or when JsnStreamOut::Flush() is called. See JsnSink.h for implementations.
+ */
+class JsnSink
+{
+public:
+
+  /**
+   Consume the characters written to the buffer, and provide a buffer for more.
+   \param[ in ] buf Buffer previously returned by this function, or NULL on the first call.
+   \param[ in ] count Number of characters written to buf.
+   \param[ out ] buf_size Size of the returned buffer. Must be at least 1.
+   \return Buffer to write to next, or NULL if the sink failed.
+   */
+  virtual char* Flush( char* buf, int64_t count, int64_t* buf_size ) = 0;
+
+  virtual ~JsnSink() {}
 };
 
 /************************************************************************************************************/ /**
  \class JsnStreamOut
- Simple in-memory byte stream writer.
+ Simple in-memory byte stream writer. Writes to a fixed buffer, or to a JsnSink. Without a buffer it
+ just counts.
  */
 class JsnStreamOut
 {
 private:
   char*       data;
   const char* error;
-  int         index;
-  int         index_end;
+  int64_t     index;
+  int64_t     index_end;
+  JsnSink*    sink;
+  int64_t     flushed;
+
+  bool Overflow()
+  {
+    if( !sink )
+    {
+      SetError( "Out of room in output buffer" );
+      return false;
+    }
+    flushed += index;
+    data = sink->Flush( data, index, &index_end );
+    index = 0;
+    if( !data )
+    {
+      index_end = 0;
+      SetError( "Could not write to output sink" );
+      return false;
+    }
+    return true;
+  }
+
+  void WriteSlow( int c )
+  {
+    if( !error )
+    {
+      if( !data )
+      {
+        index += 1; // Just counting
+      }
+      else if( c == -1 )
+      {
+        SetError( "Writing end-of-data marker" );
+      }
+      else if( index < index_end || Overflow() )
+      {
+        data[ index++ ] = ( char )c;
+      }
+    }
+  }
+
 public:
 
   /**
@@ -187,18 +268,20 @@ public:
    Return number of characters written.
    \return Number of characters written.
    */
-  int GetCount() const { return index; }
+  int64_t GetCount() const { return flushed + index; }
 
   /**
    Construct from buffer address and size.
    \param[ in ] buf Buffer
    \param[ in ] buf_size Buffer size
    */
-  JsnStreamOut( char* buf, int buf_size )
+  JsnStreamOut( char* buf, int64_t buf_size )
   : data      ( buf )
   , error     ( NULL )
   , index     ( 0 )
   , index_end ( buf_size )
+  , sink      ( NULL )
+  , flushed   ( 0 )
   {}
 
   /**
@@ -209,6 +292,8 @@ public:
   , error     ( NULL )
   , index     ( 0 )
   , index_end ( 0 )
+  , sink      ( NULL )
+  , flushed   ( 0 )
   {}
 
   /**
@@ -220,11 +305,34 @@ public:
   : data      ( buf )
   , error     ( NULL )
   , index     ( 0 )
-  , index_end ( ( int )( buf_end - buf ) )
+  , index_end ( ( int64_t )( buf_end - buf ) )
+  , sink      ( NULL )
+  , flushed   ( 0 )
   {}
 
   /**
-   Move read position to the beginning of the data.
+   Construct from a sink. Characters are written to a buffer provided by the sink, and passed on when it
+   is full. Call Flush() when done.
+   \param[ in ] out_sink Sink. Must remain valid for the life span of the stream.
+   */
+  JsnStreamOut( JsnSink* out_sink )
+  : data      ( NULL )
+  , error     ( NULL )
+  , index     ( 0 )
+  , index_end ( 0 )
+  , sink      ( out_sink )
+  , flushed   ( 0 )
+  {
+    data = sink->Flush( NULL, 0, &index_end );
+    if( !data )
+    {
+      index_end = 0;
+      SetError( "Could not write to output sink" );
+    }
+  }
+
+  /**
+   Move read position to the beginning of the data. Characters already flushed to a sink are not affected.
    */
   void Reset()
   {
@@ -232,30 +340,58 @@ public:
     error = NULL;
   }
 
+  /**
+   Pass everything written so far on to the sink. Does nothing without a sink.
+   \return true if successful, false if not. Call GetError() for details.
+   */
+  bool Flush()
+  {
+    if( sink && !error )
+    {
+      Overflow();
+    }
+    return !error;
+  }
+
   /**
    Write character to output data.
    \param[ in ] c Character to write.
    */
   void Write( int c )
   {
-    if( !error )
+    if( index < index_end && c != -1 && !error )
+    {
+      data[ index++ ] = ( char )c;
+    }
+    else
+    {
+      WriteSlow( c );
+    }
+  }
+
+  /**
+   Write multiple characters to output data.
+   \param[ in ] text Characters to write.
+   \param[ in ] length Number of characters to write.
+   */
+  void Write( const char* text, int64_t length )
+  {
+    while( length > 0 && !error )
     {
       if( !data )
       {
-        index += 1; // Just counting
-      }
-      else if( c == -1 )
-      {
-        SetError( "Writing end-of-data marker" );
+        index += length; // Just counting
+        return;
       }
-      else if( index >= index_end )
+      if( index >= index_end && !Overflow() )
       {
-        SetError( "Out of room in output buffer" );
-      }
-      else
-      {
-        data[ index++ ] = ( char )c;
+        return;
       }
+      int64_t count = index_end - index < length ? index_end - index : length;
+      memcpy( data + index, text, ( size_t )count );
+      index += count;
+      text += count;
+      length -= count;
     }
   }
 
@@ -265,10 +401,7 @@ public:
    */
   void WriteStr( const char* text )
   {
-    while( char c = *text++ )
-    {
-      Write( c );
-    }
+    Write( text, ( int64_t )strlen( text ) );
   }
 
   /**
@@ -25,8 +25,10 @@
 
 #include "JsnUTF8.h"
 #include "JsnStream.h"
+#include "JsnBlock.h"
 
 #include <stdint.h>
+#include <string.h>
 
 /****************************************************************************************************************/
 
@@ -69,17 +71,25 @@ static int ReadEscapedUTF8Hex4( JsnStreamIn* stream )
 
 /****************************************************************************************************************/
 
+// A lone surrogate, or a high surrogate that is not followed by a low one, is legal in JSON text. It is returned
+// as it is, so that it can be escaped again unchanged.
 static int JsnReadEscapedUTF8Char( JsnStreamIn* stream )
 {
   int result = ReadEscapedUTF8Hex4( stream );
-  if( result >= 0xD800 && result <= 0xDBFF )
+  if( result >= 0xD800 && result <= 0xDBFF && stream->Peek() == '\\' &&
+      ( stream->Peek( 1 ) == 'u' || stream->Peek( 1 ) == 'U' ) )
   {
     // UTF-16 surrogate pair. Go fetch other half
+    int64_t position = stream->GetCount();
     int temp = ReadEscapedUTF8Hex4( stream );
     if( temp >= 0xDC00 && temp <= 0xDFFF )
     {
       result = ( ( ( result - 0xD800 ) << 10 ) | ( temp - 0xDC00 ) ) + 0x10000;
     }
+    else if( !stream->GetError() )
+    {
+      stream->Seek( position ); // Not the other half. Leave it for the next read
+    }
   }
   return result;
 }
@@ -115,6 +125,10 @@ int JsnReadUTF8Char( JsnStreamIn* stream )
         return stream->SetError( "Multi-byte sequence error" );
       }
       result = ( result << 6 ) | ( c & 0x3f );
+      if( result < 0x80 )
+      {
+        return stream->SetError( "Overlong UTF-8 sequence" );
+      }
     }
     else if( ( c & 0xf0 ) == 0xe0 )
     {
@@ -132,8 +146,16 @@ int JsnReadUTF8Char( JsnStreamIn* stream )
         return stream->SetError( "Multi-byte sequence error" );
       }
       result = ( result << 6 ) | ( c & 0x3f );
+      if( result < 0x800 )
+      {
+        return stream->SetError( "Overlong UTF-8 sequence" );
+      }
+      if( result >= 0xD800 && result <= 0xDFFF )
+      {
+        return stream->SetError( "UTF-8 encoded surrogate" );
+      }
     }
-    else if( ( c & 0xf7 ) == 0xf0 )
+    else if( ( c & 0xf8 ) == 0xf0 )
     {
       // 21 bits
       result = c & 0x07;
@@ -155,6 +177,14 @@ int JsnReadUTF8Char( JsnStreamIn* stream )
         return stream->SetError( "Multi-byte sequence error" );
       }
       result = ( result << 6 ) | ( c & 0x3f );
+      if( result < 0x10000 )
+      {
+        return stream->SetError( "Overlong UTF-8 sequence" );
+      }
+      if( result > 0x10FFFF )
+      {
+        return stream->SetError( "Codepoint above U+10FFFF" );
+      }
     }
     else
     {
@@ -227,16 +257,84 @@ void JsnWriteUnescapedUTF8Char( JsnStreamOut* stream, int codepoint )
 
 /****************************************************************************************************************/
 
+// Length of the run of ASCII at text that can be copied as is: it stops at the first non-ASCII byte,
+// backslash or zero.
+static int64_t PlainRun( const char* text, int64_t length )
+{
+  const uint8_t* p = ( const uint8_t* )text;
+  int64_t i = 0;
+#if defined( JSN_AVX2 )
+  for( ; length - i >= 32; i += 32 )
+  {
+    __m256i v = _mm256_loadu_si256( ( const __m256i* )( p + i ) );
+    __m256i e = _mm256_or_si256( v, _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\\' ) ),
+                                                     _mm256_cmpeq_epi8( v, _mm256_setzero_si256() ) ) );
+    uint32_t mask = ( uint32_t )_mm256_movemask_epi8( e );
+    if( mask )
+    {
+      return i + JsnCountTrailingZeros( mask );
+    }
+  }
+#elif defined( JSN_SSE2 )
+  for( ; length - i >= 16; i += 16 )
+  {
+    __m128i v = _mm_loadu_si128( ( const __m128i* )( p + i ) );
+    __m128i e = _mm_or_si128( v, _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( '\\' ) ),
+                                               _mm_cmpeq_epi8( v, _mm_setzero_si128() ) ) );
+    uint32_t mask = ( uint32_t )_mm_movemask_epi8( e );
+    if( mask )
+    {
+      return i + JsnCountTrailingZeros( mask );
+    }
+  }
+#else
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t high = 0x8080808080808080ULL;
+  for( ; length - i >= 8; i += 8 )
+  {
+    uint64_t v;
+    memcpy( &v, p + i, sizeof( v ) );
+    uint64_t backslash = v ^ ( ones * '\\' );
+    if( ( ( ( backslash - ones ) & ~backslash ) | ( ( v - ones ) & ~v ) | v ) & high )
+    {
+      break;
+    }
+  }
+#endif
+  while( i < length && p[ i ] && p[ i ] < 0x80 && p[ i ] != '\\' )
+  {
+    i += 1;
+  }
+  return i;
+}
+
+/****************************************************************************************************************/
+
 void JsnUnescapeUTF8( JsnStreamOut* write_stream, JsnStreamIn* read_stream )
 {
-  while( !read_stream->GetError() && !write_stream->GetError() && read_stream->Peek() )
+  while( !read_stream->GetError() && !write_stream->GetError() && read_stream->Peek() > 0 )
   {
+    int64_t run = PlainRun( read_stream->GetCurrent(), read_stream->GetRemaining() );
+    if( run )
+    {
+      write_stream->Write( read_stream->GetCurrent(), run );
+      read_stream->Seek( read_stream->GetCount() + run );
+      continue;
+    }
     int codepoint = JsnReadUTF8Char( read_stream );
+    if( codepoint >= 0xD800 && codepoint <= 0xDFFF )
+    {
+      read_stream->SetError( "Unpaired UTF-16 surrogate" ); // Has no UTF-8 form
+    }
     if( !read_stream->GetError() )
     {
       JsnWriteUnescapedUTF8Char( write_stream, codepoint );
     }
   }
+  if( read_stream->GetError() )
+  {
+    write_stream->SetError( read_stream->GetError() );
+  }
   write_stream->Write( 0 );
 }
 
@@ -244,8 +342,15 @@ void JsnUnescapeUTF8( JsnStreamOut* write_stream, JsnStreamIn* read_stream )
 
 void JsnEscapeUTF8( JsnStreamOut* write_stream, JsnStreamIn* read_stream )
 {
-  while( !read_stream->GetError() && !write_stream->GetError() && read_stream->Peek() )
+  while( !read_stream->GetError() && !write_stream->GetError() && read_stream->Peek() > 0 )
   {
+    int64_t run = PlainRun( read_stream->GetCurrent(), read_stream->GetRemaining() );
+    if( run )
+    {
+      write_stream->Write( read_stream->GetCurrent(), run );
+      read_stream->Seek( read_stream->GetCount() + run );
+      continue;
+    }
     int codepoint = JsnReadUTF8Char( read_stream );
     if( !read_stream->GetError() )
     {
@@ -259,7 +364,627 @@ void JsnEscapeUTF8( JsnStreamOut* write_stream, JsnStreamIn* read_stream )
       }
     }
   }
+  if( read_stream->GetError() )
+  {
+    write_stream->SetError( read_stream->GetError() );
+  }
   write_stream->Write( 0 );
 }
 
 /****************************************************************************************************************/
+
+// Strict UTF-8, as in RFC 3629: no overlong forms, no surrogates, nothing above U+10FFFF.
+static int64_t ValidateUTF8Scalar( const uint8_t* text, int64_t begin, int64_t length )
+{
+  int64_t i = begin;
+  while( i < length )
+  {
+    uint8_t c = text[ i ];
+    if( c < 0x80 )
+    {
+      i += 1;
+      continue;
+    }
+    int count;
+    uint8_t lo = 0x80;
+    uint8_t hi = 0xBF;
+    if( c >= 0xC2 && c <= 0xDF )
+    {
+      count = 1;
+    }
+    else if( c >= 0xE0 && c <= 0xEF )
+    {
+      count = 2;
+      lo = c == 0xE0 ? 0xA0 : 0x80; // Overlong
+      hi = c == 0xED ? 0x9F : 0xBF; // Surrogate
+    }
+    else if( c >= 0xF0 && c <= 0xF4 )
+    {
+      count = 3;
+      lo = c == 0xF0 ? 0x90 : 0x80; // Overlong
+      hi = c == 0xF4 ? 0x8F : 0xBF; // Above U+10FFFF
+    }
+    else
+    {
+      return i;
+    }
+    if( length - i <= count || text[ i + 1 ] < lo || text[ i + 1 ] > hi )
+    {
+      return i;
+    }
+    for( int k = 2; k <= count; ++k )
+    {
+      if( ( text[ i + k ] & 0xC0 ) != 0x80 )
+      {
+        return i;
+      }
+    }
+    i += count + 1;
+  }
+  return -1;
+}
+
+#if defined( JSN_AVX2 )
+
+// Lookup table validation after Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per
+// Byte". Each pair of adjacent bytes is classified by three table lookups, on the high and low nibble of
+// the first byte, and the high nibble of the second. A bit that survives all three is an error.
+enum
+{
+  kTooShort     = 1 << 0, // Lead byte not followed by enough continuation bytes
+  kTooLong      = 1 << 1, // ASCII followed by continuation byte
+  kOverlong3    = 1 << 2,
+  kTooLarge     = 1 << 3,
+  kSurrogate    = 1 << 4,
+  kOverlong2    = 1 << 5,
+  kTooLarge1000 = 1 << 6,
+  kOverlong4    = 1 << 6,
+  kTwoConts     = 1 << 7, // Continuation byte that no lead byte asked for
+  kCarry        = kTooShort | kTooLong | kTwoConts
+};
+
+static inline __m256i Table16( char a0, char a1, char a2, char a3, char a4, char a5, char a6, char a7,
+                               char a8, char a9, char aa, char ab, char ac, char ad, char ae, char af )
+{
+  return _mm256_setr_epi8( a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, aa, ab, ac, ad, ae, af,
+                           a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, aa, ab, ac, ad, ae, af );
+}
+
+static inline __m256i HighNibble( __m256i v )
+{
+  return _mm256_and_si256( _mm256_srli_epi16( v, 4 ), _mm256_set1_epi8( 0x0F ) );
+}
+
+// Bytes of the previous 32 byte block, shifted in from the left
+template< int N >
+static inline __m256i Prev( __m256i input, __m256i prev_input )
+{
+  return _mm256_alignr_epi8( input, _mm256_permute2x128_si256( prev_input, input, 0x21 ), 16 - N );
+}
+
+static inline __m256i CheckBlock( __m256i input, __m256i prev_input )
+{
+  const __m256i byte_1_high_table = Table16(
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+    kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+    kTooShort | kOverlong2,
+    kTooShort,
+    kTooShort | kOverlong3 | kSurrogate,
+    ( char )( kTooShort | kTooLarge | kTooLarge1000 | kOverlong4 ) );
+  const __m256i byte_1_low_table = Table16(
+    ( char )( kCarry | kOverlong3 | kOverlong2 | kOverlong4 ),
+    ( char )( kCarry | kOverlong2 ),
+    ( char )kCarry,
+    ( char )kCarry,
+    ( char )( kCarry | kTooLarge ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 | kSurrogate ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ),
+    ( char )( kCarry | kTooLarge | kTooLarge1000 ) );
+  const __m256i byte_2_high_table = Table16(
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+    ( char )( kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4 ),
+    ( char )( kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge ),
+    ( char )( kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge ),
+    ( char )( kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge ),
+    kTooShort, kTooShort, kTooShort, kTooShort );
+
+  __m256i prev1 = Prev< 1 >( input, prev_input );
+  __m256i special_cases = _mm256_and_si256(
+                          _mm256_and_si256( _mm256_shuffle_epi8( byte_1_high_table, HighNibble( prev1 ) ),
+                                            _mm256_shuffle_epi8( byte_1_low_table,
+                                                                 _mm256_and_si256( prev1, _mm256_set1_epi8( 0x0F ) ) ) ),
+                          _mm256_shuffle_epi8( byte_2_high_table, HighNibble( input ) ) );
+
+  // Third and fourth bytes of a sequence must be continuation bytes. kTwoConts is the bit that says so.
+  __m256i is_third_byte  = _mm256_subs_epu8( Prev< 2 >( input, prev_input ), _mm256_set1_epi8( ( char )( 0xE0 - 0x80 ) ) );
+  __m256i is_fourth_byte = _mm256_subs_epu8( Prev< 3 >( input, prev_input ), _mm256_set1_epi8( ( char )( 0xF0 - 0x80 ) ) );
+  __m256i must_be_cont   = _mm256_and_si256( _mm256_or_si256( is_third_byte, is_fourth_byte ), _mm256_set1_epi8( ( char )0x80 ) );
+  return _mm256_xor_si256( must_be_cont, special_cases );
+}
+
+// Back up to the start of the character that contains offset.
+static int64_t CharacterStart( const uint8_t* text, int64_t offset )
+{
+  for( int i = 0; i < 3 && offset > 0 && ( text[ offset ] & 0xC0 ) == 0x80; ++i )
+  {
+    offset -= 1;
+  }
+  return offset;
+}
+
+#endif
+
+int64_t JsnValidateUTF8( const char* text, int64_t length )
+{
+  const uint8_t* p = ( const uint8_t* )text;
+  int64_t i = 0;
+#if defined( JSN_AVX2 )
+  __m256i prev_input = _mm256_setzero_si256();
+  int64_t checked = 0; // Validation can restart here
+  while( i < length )
+  {
+    __m256i input;
+    if( length - i >= 32 )
+    {
+      input = _mm256_loadu_si256( ( const __m256i* )( p + i ) );
+    }
+    else
+    {
+      uint8_t buf[ 32 ];
+      memset( buf, 0, sizeof( buf ) );
+      memcpy( buf, p + i, ( size_t )( length - i ) );
+      input = _mm256_loadu_si256( ( const __m256i* )buf );
+    }
+    if( !_mm256_movemask_epi8( _mm256_or_si256( input, prev_input ) ) )
+    {
+      // All ASCII, and nothing pending from the previous block
+      checked = i + 32;
+    }
+    else
+    {
+      __m256i error = CheckBlock( input, prev_input );
+      if( !_mm256_testz_si256( error, error ) )
+      {
+        // Find the exact offset
+        return ValidateUTF8Scalar( p, CharacterStart( p, checked ), length );
+      }
+      checked = i;
+    }
+    prev_input = input;
+    i += 32;
+  }
+  if( length & 31 )
+  {
+    // The zero padding of the last block caught any sequence cut short at the end
+    return -1;
+  }
+  // Check for a sequence cut short at the very end
+  return ValidateUTF8Scalar( p, CharacterStart( p, length > 3 ? length - 3 : 0 ), length );
+#else
+  while( i < length )
+  {
+    // Skip ASCII quickly, then check one character at a time
+#if defined( JSN_SSE2 )
+    while( length - i >= 16 && !_mm_movemask_epi8( _mm_loadu_si128( ( const __m128i* )( p + i ) ) ) )
+    {
+      i += 16;
+    }
+#else
+    while( length - i >= 8 )
+    {
+      uint64_t v;
+      memcpy( &v, p + i, sizeof( v ) );
+      if( v & 0x8080808080808080ULL )
+      {
+        break;
+      }
+      i += 8;
+    }
+#endif
+    if( i >= length )
+    {
+      break;
+    }
+    int64_t next = i + 1;
+    while( next < length && p[ next ] >= 0x80 )
+    {
+      next += 1;
+    }
+    // Validate up to the next ASCII byte
+    int64_t result = ValidateUTF8Scalar( p, i, next );
+    if( result >= 0 )
+    {
+      return result;
+    }
+    i = next;
+  }
+  return -1;
+#endif
+}
+
+/****************************************************************************************************************/
+
+// Value of each character as a hex digit, or -1
+struct HexDigits
+{
+  int8_t m_Value[ 256 ];
+
+  HexDigits()
+  {
+    for( int c = 0; c < 256; ++c )
+    {
+      m_Value[ c ] = ( int8_t )( c >= '0' && c <= '9' ? c - '0' :
+                                 c >= 'a' && c <= 'f' ? c + 10 - 'a' :
+                                 c >= 'A' && c <= 'F' ? c + 10 - 'A' : -1 );
+    }
+  }
+};
+
+static const HexDigits g_HexDigits;
+
+static int ReadHex4( const char* p )
+{
+  int a = g_HexDigits.m_Value[ ( uint8_t )p[ 0 ] ];
+  int b = g_HexDigits.m_Value[ ( uint8_t )p[ 1 ] ];
+  int c = g_HexDigits.m_Value[ ( uint8_t )p[ 2 ] ];
+  int d = g_HexDigits.m_Value[ ( uint8_t )p[ 3 ] ];
+  return ( a | b | c | d ) < 0 ? -1 : ( a << 12 ) | ( b << 8 ) | ( c << 4 ) | d;
+}
+
+static char* EncodeUTF8( char* out, int codepoint )
+{
+  if( codepoint < 0x80 )
+  {
+    *out++ = ( char )codepoint;
+  }
+  else if( codepoint < 0x800 )
+  {
+    *out++ = ( char )( 0xc0 | ( codepoint >> 6 ) );
+    *out++ = ( char )( 0x80 | ( codepoint & 0x3f ) );
+  }
+  else if( codepoint < 0x10000 )
+  {
+    *out++ = ( char )( 0xe0 | ( codepoint >> 12 ) );
+    *out++ = ( char )( 0x80 | ( ( codepoint >> 6 ) & 0x3f ) );
+    *out++ = ( char )( 0x80 | ( codepoint & 0x3f ) );
+  }
+  else
+  {
+    *out++ = ( char )( 0xf0 | ( codepoint >> 18 ) );
+    *out++ = ( char )( 0x80 | ( ( codepoint >> 12 ) & 0x3f ) );
+    *out++ = ( char )( 0x80 | ( ( codepoint >> 6 ) & 0x3f ) );
+    *out++ = ( char )( 0x80 | ( codepoint & 0x3f ) );
+  }
+  return out;
+}
+
+int64_t JsnUnescapeInPlace( char* text, int64_t length )
+{
+  char* end = text + length;
+  char* in = length > 0 ? ( char* )memchr( text, '\\', ( size_t )length ) : NULL;
+  if( !in )
+  {
+    return length;
+  }
+  char* out = in;
+  while( in < end )
+  {
+    // in points at a backslash
+    if( end - in < 2 )
+    {
+      return -1;
+    }
+    char c = in[ 1 ];
+    in += 2;
+    switch( c )
+    {
+      case '"':
+      case '\\':
+      case '/':
+        *out++ = c;
+        break;
+      case 'b':
+        *out++ = '\b';
+        break;
+      case 'f':
+        *out++ = '\f';
+        break;
+      case 'n':
+        *out++ = '\n';
+        break;
+      case 'r':
+        *out++ = '\r';
+        break;
+      case 't':
+        *out++ = '\t';
+        break;
+      case 'u':
+      {
+        int codepoint = end - in >= 4 ? ReadHex4( in ) : -1;
+        if( codepoint < 0 )
+        {
+          return -1;
+        }
+        in += 4;
+        if( codepoint >= 0xD800 && codepoint <= 0xDBFF )
+        {
+          // UTF-16 surrogate pair. Other half must follow.
+          int low = end - in >= 6 && in[ 0 ] == '\\' && in[ 1 ] == 'u' ? ReadHex4( in + 2 ) : -1;
+          if( low < 0xDC00 || low > 0xDFFF )
+          {
+            return -1;
+          }
+          in += 6;
+          codepoint = ( ( ( codepoint - 0xD800 ) << 10 ) | ( low - 0xDC00 ) ) + 0x10000;
+        }
+        else if( codepoint >= 0xDC00 && codepoint <= 0xDFFF )
+        {
+          return -1;
+        }
+        out = EncodeUTF8( out, codepoint );
+        break;
+      }
+      default:
+        return -1;
+    }
+    // Move the run up to the next escape sequence
+    char* next = ( char* )memchr( in, '\\', ( size_t )( end - in ) );
+    if( !next )
+    {
+      next = end;
+    }
+    memmove( out, in, ( size_t )( next - in ) );
+    out += next - in;
+    in = next;
+  }
+  return out - text;
+}
+
+/****************************************************************************************************************/
+
+// Decode the "\uXXXX" escape at text, and the second half if it is a surrogate pair. Returns the codepoint and
+// sets size to the length of the escape, or returns -1 if the escape is not valid. An unpaired surrogate is
+// returned as it is, as JsnReadUTF8Char() does.
+static int ReadEscape( const char* text, const char* end, int* size )
+{
+  int codepoint = end - text >= 6 ? ReadHex4( text + 2 ) : -1;
+  *size = 6;
+  if( codepoint >= 0xD800 && codepoint <= 0xDBFF )
+  {
+    int low = end - text >= 12 && text[ 6 ] == '\\' && ( text[ 7 ] == 'u' || text[ 7 ] == 'U' ) ?
+              ReadHex4( text + 8 ) : -1;
+    if( low >= 0xDC00 && low <= 0xDFFF )
+    {
+      *size = 12;
+      return ( ( ( codepoint - 0xD800 ) << 10 ) | ( low - 0xDC00 ) ) + 0x10000;
+    }
+  }
+  return codepoint;
+}
+
+static inline bool IsEscape( const char* text, const char* end )
+{
+  return end - text >= 2 && text[ 0 ] == '\\' && ( text[ 1 ] == 'u' || text[ 1 ] == 'U' );
+}
+
+// Decode a multi-byte sequence, with the same checks as ValidateUTF8Scalar(). Returns the codepoint and sets
+// size to the length of the sequence, or returns -1 if the sequence is not valid.
+static inline int DecodeUTF8( const uint8_t* p, const uint8_t* end, int* size )
+{
+  uint8_t c = p[ 0 ];
+  if( c >= 0xC2 && c <= 0xDF )
+  {
+    if( end - p < 2 || ( p[ 1 ] & 0xC0 ) != 0x80 )
+    {
+      return -1;
+    }
+    *size = 2;
+    return ( ( c & 0x1f ) << 6 ) | ( p[ 1 ] & 0x3f );
+  }
+  if( c >= 0xE0 && c <= 0xEF )
+  {
+    uint8_t lo = c == 0xE0 ? 0xA0 : 0x80; // Overlong
+    uint8_t hi = c == 0xED ? 0x9F : 0xBF; // Surrogate
+    if( end - p < 3 || p[ 1 ] < lo || p[ 1 ] > hi || ( p[ 2 ] & 0xC0 ) != 0x80 )
+    {
+      return -1;
+    }
+    *size = 3;
+    return ( ( c & 0x0f ) << 12 ) | ( ( p[ 1 ] & 0x3f ) << 6 ) | ( p[ 2 ] & 0x3f );
+  }
+  if( c >= 0xF0 && c <= 0xF4 )
+  {
+    uint8_t lo = c == 0xF0 ? 0x90 : 0x80; // Overlong
+    uint8_t hi = c == 0xF4 ? 0x8F : 0xBF; // Above U+10FFFF
+    if( end - p < 4 || p[ 1 ] < lo || p[ 1 ] > hi || ( p[ 2 ] & 0xC0 ) != 0x80 || ( p[ 3 ] & 0xC0 ) != 0x80 )
+    {
+      return -1;
+    }
+    *size = 4;
+    return ( ( c & 0x07 ) << 18 ) | ( ( p[ 1 ] & 0x3f ) << 12 ) | ( ( p[ 2 ] & 0x3f ) << 6 ) | ( p[ 3 ] & 0x3f );
+  }
+  return -1;
+}
+
+// Two hex digits for each byte value, so that an escape is written with two stores
+struct HexPairs
+{
+  char m_Digits[ 256 ][ 2 ];
+
+  HexPairs()
+  {
+    static const char digits[] = "0123456789ABCDEF";
+    for( int c = 0; c < 256; ++c )
+    {
+      m_Digits[ c ][ 0 ] = digits[ c >> 4 ];
+      m_Digits[ c ][ 1 ] = digits[ c & 0x0f ];
+    }
+  }
+};
+
+static const HexPairs g_HexPairs;
+
+static inline char* EncodeHex4( char* out, int code16 )
+{
+  out[ 0 ] = '\\';
+  out[ 1 ] = 'u';
+  memcpy( out + 2, g_HexPairs.m_Digits[ ( code16 >> 8 ) & 0xff ], 2 );
+  memcpy( out + 4, g_HexPairs.m_Digits[ code16 & 0xff ], 2 );
+  return out + 6;
+}
+
+static inline char* EncodeEscaped( char* out, int codepoint )
+{
+  if( codepoint < 0x80 )
+  {
+    *out++ = ( char )codepoint;
+    return out;
+  }
+  if( codepoint >= 0x10000 )
+  {
+    codepoint -= 0x10000;
+    out = EncodeHex4( out, ( codepoint >> 10 ) + 0xd800 );
+    codepoint = ( codepoint & 0x03ff ) + 0xdc00;
+  }
+  return EncodeHex4( out, codepoint );
+}
+
+// Copy the run of ASCII at p, up to the first backslash or non-ASCII byte, and return its length. Zero bytes
+// are copied too. Stores sixteen bytes at a time where SSE2 is available, so the output buffer must not be
+// shorter than what is left of the input, and must not overlap it.
+static inline int64_t CopyRun( char* out, const uint8_t* p, int64_t length )
+{
+  int64_t i = 0;
+#if defined( JSN_SSE2 )
+  for( ; length - i >= 16; i += 16 )
+  {
+    __m128i v = _mm_loadu_si128( ( const __m128i* )( p + i ) );
+    _mm_storeu_si128( ( __m128i* )( out + i ), v ); // Whole block, even if only part of it is a run
+    uint32_t mask = ( uint32_t )_mm_movemask_epi8( _mm_or_si128( v, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\\' ) ) ) );
+    if( mask )
+    {
+      return i + JsnCountTrailingZeros( mask );
+    }
+  }
+#endif
+  for( ; i < length && p[ i ] < 0x80 && p[ i ] != '\\'; ++i )
+  {
+    out[ i ] = ( char )p[ i ];
+  }
+  return i;
+}
+
+/****************************************************************************************************************/
+
+int64_t JsnEscapeUTF8( char* out, const char* text, int64_t length )
+{
+  const uint8_t* p = ( const uint8_t* )text;
+  const uint8_t* end = p + length;
+  char* o = out;
+  while( p < end )
+  {
+    int64_t run = CopyRun( o, p, end - p );
+    o += run;
+    p += run;
+    if( p >= end )
+    {
+      break;
+    }
+    if( *p >= 0x80 )
+    {
+      // Stay in the loop for a run of non-ASCII characters. Decoding checks them, so no separate pass is
+      // needed to validate the text.
+      do
+      {
+        int size;
+        int codepoint = DecodeUTF8( p, end, &size );
+        if( codepoint < 0 )
+        {
+          return -1;
+        }
+        o = EncodeEscaped( o, codepoint );
+        p += size;
+      }
+      while( p < end && *p >= 0x80 );
+    }
+    else if( IsEscape( ( const char* )p, ( const char* )end ) )
+    {
+      int size;
+      int codepoint = ReadEscape( ( const char* )p, ( const char* )end, &size );
+      if( codepoint < 0 )
+      {
+        return -1;
+      }
+      o = EncodeEscaped( o, codepoint );
+      p += size;
+    }
+    else
+    {
+      *o++ = '\\'; // Not an escape sequence
+      p += 1;
+    }
+  }
+  return o - out;
+}
+
+/****************************************************************************************************************/
+
+int64_t JsnUnescapeUTF8( char* out, const char* text, int64_t length )
+{
+  const uint8_t* p = ( const uint8_t* )text;
+  const uint8_t* end = p + length;
+  char* o = out;
+  while( p < end )
+  {
+    int64_t run = CopyRun( o, p, end - p );
+    o += run;
+    p += run;
+    if( p >= end )
+    {
+      break;
+    }
+    if( *p >= 0x80 )
+    {
+      // Copied as it is, but checked on the way, so no separate pass is needed to validate the text
+      do
+      {
+        int size;
+        if( DecodeUTF8( p, end, &size ) < 0 )
+        {
+          return -1;
+        }
+        memcpy( o, p, ( size_t )size );
+        o += size;
+        p += size;
+      }
+      while( p < end && *p >= 0x80 );
+    }
+    else if( IsEscape( ( const char* )p, ( const char* )end ) )
+    {
+      int size;
+      int codepoint = ReadEscape( ( const char* )p, ( const char* )end, &size );
+      if( codepoint < 0 || ( codepoint >= 0xD800 && codepoint <= 0xDFFF ) )
+      {
+        return -1; // An unpaired surrogate has no UTF-8 form
+      }
+      o = EncodeUTF8( o, codepoint );
+      p += size;
+    }
+    else
+    {
+      *o++ = '\\'; // Not an escape sequence
+      p += 1;
+    }
+  }
+  return o - out;
+}
+
+/****************************************************************************************************************/
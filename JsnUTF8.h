@@ -24,22 +24,28 @@
  */
 #pragma once
 
+#include <stdint.h>
+
 struct JsnStreamIn;
 struct JsnStreamOut;
 
 /************************************************************************************************************/ /**
  Read input stream, convert to multi-byte sequences where necessary, and write result to output stream.
+ An unpaired UTF-16 surrogate escape has no UTF-8 form, and is an error. An error in the input stream is
+ also set on the output stream.
  */
 void JsnUnescapeUTF8( JsnStreamOut* write_stream, JsnStreamIn* read_stream );
 
 /************************************************************************************************************/ /**
- Read input stream, apply "\uXXXX" escaping where necessary, and write result to output stream.
+ Read input stream, apply "\uXXXX" escaping where necessary, and write result to output stream. An unpaired
+ UTF-16 surrogate escape is copied as it is. An error in the input stream is also set on the output stream.
  */
 void JsnEscapeUTF8( JsnStreamOut* write_stream, JsnStreamIn* read_stream );
 
 /************************************************************************************************************/ /**
  Read a single (possibly multi-byte or escaped) codepoint from the input stream. Will recognize UTF-8 bit
- pattern, or "\uXXXX" escape code and convert accordingly.
+ pattern, or "\uXXXX" escape code and convert accordingly. An unpaired UTF-16 surrogate escape is returned
+ as it is, in the range 0xD800 to 0xDFFF.
  \param[ in ] stream Input stream
  \returns Codepoint
  */
@@ -58,3 +64,51 @@ void JsnWriteEscapedUTF8Char( JsnStreamOut* stream, int codepoint );
  \param[ in ] stream Output stream to write to
  */
 void JsnWriteUnescapedUTF8Char( JsnStreamOut* stream, int codepoint );
+
+/************************************************************************************************************/ /**
+ Check that text is valid UTF-8, as defined by RFC 3629. Overlong encodings, encoded surrogates, codepoints
+ above U+10FFFF and sequences cut short are all rejected. Uses AVX2 table lookups where available, and
+ skips ASCII runs in bulk otherwise.
+ \param[ in ] text Start of text.
+ \param[ in ] length Length of text.
+ \return Byte offset of the first invalid character, or -1 if the text is valid.
+ */
+int64_t JsnValidateUTF8( const char* text, int64_t length );
+
+/************************************************************************************************************/ /**
+ Decode escape sequences in place. The decoded text is never longer than the escaped text.
+ \param[ in ] text Text of a JSON string, without the quotes. Will be overwritten with the decoded text.
+ \param[ in ] length Length of text.
+ \return Length of the decoded text, or -1 if an escape sequence is not valid.
+ */
+int64_t JsnUnescapeInPlace( char* text, int64_t length );
+
+/************************************************************************************************************/ /**
+ Apply "\uXXXX" escaping where necessary, as the stream version does, but to a buffer. Runs of ASCII are
+ copied in bulk, and the text is checked as it is escaped. No terminator is written.
+ \param[ out ] out Output buffer. Must hold at least JSN_ESCAPED_UTF8_MAX_LENGTH( length ) bytes, and must
+ not overlap the text.
+ \param[ in ] text Start of text. May contain "\uXXXX" escapes, and zero bytes.
+ \param[ in ] length Length of text.
+ \return Length of the escaped text, or -1 if the text is not valid UTF-8, or has an invalid escape. The
+ output buffer is left partly written in that case.
+ */
+int64_t JsnEscapeUTF8( char* out, const char* text, int64_t length );
+
+/**
+ Size of output buffer that JsnEscapeUTF8() needs for text of the given length. A character grows at most
+ three times: a two byte sequence becomes one six byte escape, a four byte sequence becomes two.
+ */
+#define JSN_ESCAPED_UTF8_MAX_LENGTH( length ) ( ( length ) * 3 )
+
+/************************************************************************************************************/ /**
+ Convert "\uXXXX" escapes to multi-byte sequences, as the stream version does, but to a buffer. Runs of
+ ASCII are copied in bulk, and the text is checked as it is copied. No terminator is written.
+ \param[ out ] out Output buffer. Must hold at least length bytes: the result is never longer than the text.
+ Must not overlap the text. Use JsnUnescapeInPlace() to convert in place.
+ \param[ in ] text Start of text. May contain "\uXXXX" escapes, and zero bytes.
+ \param[ in ] length Length of text.
+ \return Length of the unescaped text, or -1 if the text is not valid UTF-8, or has an invalid escape or an
+ unpaired surrogate escape. The output buffer is left partly written in that case.
+ */
+int64_t JsnUnescapeUTF8( char* out, const char* text, int64_t length );
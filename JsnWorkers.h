@@ -0,0 +1,75 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+
+ Internal helpers to run a parse on worker threads, shared by JsnParseLines() and JsnParseParallel(). Not
+ part of the public interface.
+ */
+#pragma once
+
+#include "JsnParse.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <thread>
+
+/****************************************************************************************************************/
+
+/**
+ The parse options for one worker. Statistics are gathered per worker, and added up at the end. The context
+ holds the caller's options in m_ParseOptions, and one JsnStats per worker in m_WorkerStats, or NULL.
+ */
+template< typename Context >
+JsnParseOptions JsnWorkerOptions( const Context* context, int worker )
+{
+  JsnParseOptions options = context->m_ParseOptions;
+  if( context->m_WorkerStats )
+  {
+    options.m_Stats = context->m_WorkerStats + worker;
+  }
+  return options;
+}
+
+/**
+ Call work on worker_count threads, and return when all of them have. Workers take their items from the
+ counter next, which is reset to zero first. The calling thread is worker zero, so only worker_count - 1
+ threads are started.
+ */
+template< typename Context >
+void JsnRunWorkers( Context* context, std::atomic< int64_t >* next, int worker_count,
+                    void ( *work )( Context*, int ) )
+{
+  *next = 0;
+  std::thread* threads = new std::thread[ worker_count - 1 ];
+  for( int i = 1; i < worker_count; ++i )
+  {
+    threads[ i - 1 ] = std::thread( work, context, i );
+  }
+  work( context, 0 );
+  for( int i = 1; i < worker_count; ++i )
+  {
+    threads[ i - 1 ].join();
+  }
+  delete[] threads;
+}
@@ -0,0 +1,1066 @@
+/*
+ Copyright (c) 2013, Insomniac Games
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+ following conditions are met:
+ - Redistributions of source code must retain the above copyright notice, this list of conditions and the
+ following disclaimer.
+ - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+ following disclaimer in the documentation and/or other materials provided with the distribution.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED
+ WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ \file
+ \author Ron Pieket \n<http://www.ItShouldJustWorkTM.com> \n<http://twitter.com/RonPieket>
+ */
+
+/*
+ Throughput benchmark for the library. Generates corpora of typical shapes, and times parsing, writing,
+ escaping and unescaping of each. All numbers are measured against the corpus text: MB/s is corpus bytes per
+ second, where 1 MB = 2^20 bytes.
+
+ Build from this directory:
+   g++ -std=c++11 -O2 -pthread -I.. ../Jsn*.cpp JsnBench.cpp -o JsnBench
+
+ Usage:
+   JsnBench [-size <MB>] [-runs <n>] [-warmup <n>] [-seed <n>] [-corpus <name>] [-bench <name>]
+
+ -corpus and -bench select by substring. The corpora are the same for the same seed and size, so runs can be
+ compared between builds.
+ */
+
+#include "JsnBind.h"
+#include "JsnDocument.h"
+#include "JsnIndex.h"
+#include "JsnLines.h"
+#include "JsnParse.h"
+#include "JsnParseStatic.h"
+#include "JsnReader.h"
+#include "JsnReformat.h"
+#include "JsnSink.h"
+#include "JsnStream.h"
+#include "JsnUTF8.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+/****************************************************************************************************************/
+
+// xorshift64*. Small, fast, and the same everywhere.
+class Random
+{
+public:
+
+  Random( uint64_t seed )
+  : m_State( seed * 0x9E3779B97F4A7C15ULL + 1 )
+  {}
+
+  uint64_t Next()
+  {
+    m_State ^= m_State >> 12;
+    m_State ^= m_State << 25;
+    m_State ^= m_State >> 27;
+    return m_State * 0x2545F4914F6CDD1DULL;
+  }
+
+  int Range( int count ) { return ( int )( Next() % ( uint64_t )count ); }
+  bool Chance( int percent ) { return Range( 100 ) < percent; }
+  double Float() { return ( double )( Next() >> 11 ) * ( 1.0 / 9007199254740992.0 ); }
+
+private:
+
+  uint64_t m_State;
+};
+
+/****************************************************************************************************************/
+
+// Builds strings for the generators. Fragments point into it until the next Clear().
+class Text
+{
+public:
+
+  Text() : m_Length( 0 ) {}
+
+  void Clear() { m_Length = 0; }
+
+  void Append( const char* text )
+  {
+    int64_t length = ( int64_t )strlen( text );
+    if( length > kCapacity - 1 - m_Length )
+    {
+      length = kCapacity - 1 - m_Length;
+    }
+    memcpy( m_Data + m_Length, text, ( size_t )length );
+    m_Length += length;
+    m_Data[ m_Length ] = 0;
+  }
+
+  void Format( const char* format, int64_t value )
+  {
+    char buf[ 64 ];
+    snprintf( buf, sizeof( buf ), format, ( long long )value );
+    Append( buf );
+  }
+
+  JsnFragment Get() const { return JsnFragment( kJsn_String, m_Data, m_Length ); }
+
+private:
+
+  enum { kCapacity = 4096 };
+  char    m_Data[ kCapacity ];
+  int64_t m_Length;
+};
+
+static const char* const g_Words[] =
+{
+  "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "json", "parser", "stream", "token", "value",
+  "array", "object", "string", "number", "fast", "memory", "cache", "branch", "vector", "index", "record",
+  "update", "server", "client", "request", "response", "latency", "today", "really", "great", "launch"
+};
+
+static const char* const g_UnicodeWords[] =
+{
+  "日本語", "テキスト", "中文", "数据", "한국어", "Ελληνικά", "русский", "текст",
+  "العربية", "עברית", "हिन्दी", "ภาษาไทย", "café", "naïve", "Größe",
+  "😀", "🚀", "🎉", "✓", "→", "€", "♫", "𝄞"
+};
+
+static const char* const g_Levels[] = { "DEBUG", "INFO", "INFO", "INFO", "WARN", "ERROR" };
+static const char* const g_Services[] = { "api", "auth", "billing", "search", "gateway", "worker" };
+static const char* const g_Methods[] = { "GET", "GET", "GET", "POST", "PUT", "DELETE" };
+
+#define COUNT_OF( a ) ( int )( sizeof( a ) / sizeof( a[ 0 ] ) )
+
+static void AppendWords( Text* text, Random* random, const char* const* words, int word_count, int count )
+{
+  for( int i = 0; i < count; ++i )
+  {
+    if( i )
+    {
+      text->Append( " " );
+    }
+    text->Append( words[ random->Range( word_count ) ] );
+  }
+}
+
+static void AddString( JsnHandler* handler, const char* name, const Text& text )
+{
+  handler->AddProperty( name, text.Get() );
+}
+
+static void AddString( JsnHandler* handler, const char* name, const char* text )
+{
+  handler->AddProperty( name, JsnFragment( kJsn_String, text ) );
+}
+
+static void AddInt( JsnHandler* handler, const char* name, int64_t value )
+{
+  handler->AddProperty( name, JsnFragment::FromInt( value ) );
+}
+
+static void AddFloat( JsnHandler* handler, const char* name, double value )
+{
+  handler->AddProperty( name, JsnFragment::FromFloat( value ) );
+}
+
+static void AddBool( JsnHandler* handler, const char* name, bool value )
+{
+  handler->AddProperty( name, JsnFragment( value ? kJsn_True : kJsn_False ) );
+}
+
+/****************************************************************************************************************/
+// Corpus generators. Each writes one document.
+
+// Search results from a social network: mostly short strings, some HTML, ids and flags.
+static void WriteTweets( JsnHandler* writer, Random* random )
+{
+  Text text;
+  JsnHandler* doc = writer->BeginObject( JsnFragment() );
+  JsnHandler* statuses = doc->BeginArray( "statuses" );
+  for( int i = 0; i < 20; ++i )
+  {
+    JsnHandler* status = statuses->BeginObject( JsnFragment() );
+    int64_t id = 250000000000000000LL + ( int64_t )( random->Next() % 1000000000000000LL );
+    AddString( status, "created_at", "Mon Sep 24 03:35:21 +0000 2012" );
+    AddInt( status, "id", id );
+    text.Clear();
+    text.Format( "%lld", id );
+    AddString( status, "id_str", text );
+    text.Clear();
+    AppendWords( &text, random, g_Words, COUNT_OF( g_Words ), 8 + random->Range( 16 ) );
+    AddString( status, "text", text );
+    AddString( status, "source", "<a href=\"http://twitter.com/download/iphone\" rel=\"nofollow\">iPhone</a>" );
+    AddBool( status, "truncated", false );
+    JsnHandler* user = status->BeginObject( "user" );
+    AddInt( user, "id", ( int64_t )( random->Next() % 2000000000 ) );
+    text.Clear();
+    AppendWords( &text, random, g_Words, COUNT_OF( g_Words ), 2 );
+    AddString( user, "name", text );
+    text.Clear();
+    text.Append( "@" );
+    text.Append( g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+    text.Format( "%lld", random->Range( 10000 ) );
+    AddString( user, "screen_name", text );
+    text.Clear();
+    AppendWords( &text, random, g_Words, COUNT_OF( g_Words ), 5 + random->Range( 12 ) );
+    AddString( user, "description", text );
+    AddInt( user, "followers_count", random->Range( 100000 ) );
+    AddInt( user, "friends_count", random->Range( 5000 ) );
+    AddBool( user, "verified", random->Chance( 5 ) );
+    AddString( user, "profile_image_url", "http://a0.twimg.com/profile_images/1777569006/image_normal.png" );
+    status->EndObject( user );
+    JsnHandler* entities = status->BeginObject( "entities" );
+    JsnHandler* hashtags = entities->BeginArray( "hashtags" );
+    for( int j = random->Range( 4 ); j > 0; --j )
+    {
+      JsnHandler* hashtag = hashtags->BeginObject( JsnFragment() );
+      AddString( hashtag, "text", g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+      JsnHandler* indices = hashtag->BeginArray( "indices" );
+      AddInt( indices, NULL, random->Range( 100 ) );
+      AddInt( indices, NULL, random->Range( 140 ) );
+      hashtag->EndArray( indices );
+      hashtags->EndObject( hashtag );
+    }
+    entities->EndArray( hashtags );
+    JsnHandler* urls = entities->BeginArray( "urls" );
+    entities->EndArray( urls );
+    status->EndObject( entities );
+    AddInt( status, "retweet_count", random->Chance( 70 ) ? 0 : random->Range( 500 ) );
+    AddInt( status, "favorite_count", random->Range( 50 ) );
+    status->AddProperty( "in_reply_to_status_id", JsnFragment( kJsn_Null ) );
+    AddString( status, "lang", "en" );
+    statuses->EndObject( status );
+  }
+  doc->EndArray( statuses );
+  JsnHandler* metadata = doc->BeginObject( "search_metadata" );
+  AddFloat( metadata, "completed_in", random->Float() * 0.1 );
+  AddInt( metadata, "count", 20 );
+  AddString( metadata, "query", "%23json" );
+  doc->EndObject( metadata );
+  writer->EndObject( doc );
+}
+
+// Map data: polygons with long arrays of coordinates, almost all floating point numbers.
+static void WriteGeoJSON( JsnHandler* writer, Random* random )
+{
+  Text text;
+  JsnHandler* doc = writer->BeginObject( JsnFragment() );
+  AddString( doc, "type", "FeatureCollection" );
+  JsnHandler* features = doc->BeginArray( "features" );
+  for( int i = 0; i < 4; ++i )
+  {
+    JsnHandler* feature = features->BeginObject( JsnFragment() );
+    AddString( feature, "type", "Feature" );
+    JsnHandler* properties = feature->BeginObject( "properties" );
+    text.Clear();
+    AppendWords( &text, random, g_Words, COUNT_OF( g_Words ), 2 );
+    AddString( properties, "name", text );
+    feature->EndObject( properties );
+    JsnHandler* geometry = feature->BeginObject( "geometry" );
+    AddString( geometry, "type", "Polygon" );
+    JsnHandler* coordinates = geometry->BeginArray( "coordinates" );
+    JsnHandler* ring = coordinates->BeginArray( JsnFragment() );
+    double lon = -140.0 + random->Float() * 90.0;
+    double lat = 42.0 + random->Float() * 30.0;
+    for( int j = 200 + random->Range( 400 ); j > 0; --j )
+    {
+      JsnHandler* point = ring->BeginArray( JsnFragment() );
+      lon += ( random->Float() - 0.5 ) * 0.01;
+      lat += ( random->Float() - 0.5 ) * 0.01;
+      AddFloat( point, NULL, lon );
+      AddFloat( point, NULL, lat );
+      ring->EndArray( point );
+    }
+    coordinates->EndArray( ring );
+    geometry->EndArray( coordinates );
+    feature->EndObject( geometry );
+    features->EndObject( feature );
+  }
+  doc->EndArray( features );
+  writer->EndObject( doc );
+}
+
+static void WriteConfigLevel( JsnHandler* handler, Random* random, int depth )
+{
+  Text text;
+  for( int i = 2 + random->Range( 4 ); i > 0; --i )
+  {
+    text.Clear();
+    text.Append( g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+    text.Append( "_" );
+    text.Append( g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+    switch( random->Range( 4 ) )
+    {
+      case 0:
+        AddInt( handler, text.Get().m_Text, random->Range( 65536 ) );
+        break;
+      case 1:
+        AddBool( handler, text.Get().m_Text, random->Chance( 50 ) );
+        break;
+      default:
+        AddString( handler, text.Get().m_Text, g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+        break;
+    }
+  }
+  if( depth > 0 )
+  {
+    // Mostly one branch that goes deep, sometimes a short side branch
+    JsnHandler* child = handler->BeginObject( g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+    WriteConfigLevel( child, random, depth - 1 );
+    handler->EndObject( child );
+    if( random->Chance( 30 ) )
+    {
+      JsnHandler* list = handler->BeginArray( "items" );
+      for( int i = random->Range( 4 ); i > 0; --i )
+      {
+        JsnHandler* item = list->BeginObject( JsnFragment() );
+        WriteConfigLevel( item, random, random->Range( depth < 3 ? depth : 3 ) );
+        list->EndObject( item );
+      }
+      handler->EndArray( list );
+    }
+  }
+}
+
+// Configuration files: pretty printed, deeply nested objects with short keys and values.
+static void WriteConfig( JsnHandler* writer, Random* random )
+{
+  JsnHandler* doc = writer->BeginObject( JsnFragment() );
+  WriteConfigLevel( doc, random, 16 + random->Range( 48 ) );
+  writer->EndObject( doc );
+}
+
+// Strings full of quotes, backslashes and control characters. Non-ASCII is written as \u escapes.
+static void WriteEscapes( JsnHandler* writer, Random* random )
+{
+  static const char* const pieces[] =
+  {
+    "\"quoted\"", "C:\\Program Files\\", "line\n", "\ttab", "\r\n", "\\n", "back\\slash", "\b\f",
+    "path/to/file", "ü", "日本", "😀", "plain words here"
+  };
+  Text text;
+  JsnHandler* doc = writer->BeginArray( JsnFragment() );
+  for( int i = 0; i < 32; ++i )
+  {
+    text.Clear();
+    for( int j = 4 + random->Range( 12 ); j > 0; --j )
+    {
+      text.Append( pieces[ random->Range( COUNT_OF( pieces ) ) ] );
+    }
+    doc->AddProperty( JsnFragment(), text.Get() );
+  }
+  writer->EndArray( doc );
+}
+
+// Text in many scripts, written as raw UTF-8.
+static void WriteUnicode( JsnHandler* writer, Random* random )
+{
+  Text text;
+  JsnHandler* doc = writer->BeginArray( JsnFragment() );
+  for( int i = 0; i < 16; ++i )
+  {
+    JsnHandler* entry = doc->BeginObject( JsnFragment() );
+    text.Clear();
+    AppendWords( &text, random, g_UnicodeWords, COUNT_OF( g_UnicodeWords ), 2 );
+    AddString( entry, "title", text );
+    text.Clear();
+    AppendWords( &text, random, g_UnicodeWords, COUNT_OF( g_UnicodeWords ), 10 + random->Range( 30 ) );
+    AddString( entry, "body", text );
+    AddString( entry, "lang", random->Chance( 50 ) ? "ja" : "ru" );
+    doc->EndObject( entry );
+  }
+  writer->EndArray( doc );
+}
+
+// Log records, one small object per line.
+static void WriteLog( JsnHandler* writer, Random* random )
+{
+  Text text;
+  JsnHandler* doc = writer->BeginObject( JsnFragment() );
+  text.Format( "2024-03-%02lld", 1 + random->Range( 28 ) );
+  text.Format( "T%02lld:", random->Range( 24 ) );
+  text.Format( "%02lld:", random->Range( 60 ) );
+  text.Format( "%02lld.", random->Range( 60 ) );
+  text.Format( "%03lldZ", random->Range( 1000 ) );
+  AddString( doc, "ts", text );
+  AddString( doc, "level", g_Levels[ random->Range( COUNT_OF( g_Levels ) ) ] );
+  AddString( doc, "service", g_Services[ random->Range( COUNT_OF( g_Services ) ) ] );
+  AddString( doc, "method", g_Methods[ random->Range( COUNT_OF( g_Methods ) ) ] );
+  text.Clear();
+  text.Append( "/v1/" );
+  text.Append( g_Words[ random->Range( COUNT_OF( g_Words ) ) ] );
+  text.Format( "/%lld", random->Range( 100000 ) );
+  AddString( doc, "path", text );
+  AddInt( doc, "status", random->Chance( 95 ) ? 200 : 500 );
+  AddFloat( doc, "latency_ms", random->Float() * 250.0 );
+  text.Clear();
+  AppendWords( &text, random, g_Words, COUNT_OF( g_Words ), 3 + random->Range( 8 ) );
+  AddString( doc, "msg", text );
+  text.Clear();
+  text.Format( "%016llx", ( int64_t )( random->Next() >> 1 ) );
+  AddString( doc, "trace_id", text );
+  writer->EndObject( doc );
+}
+
+/****************************************************************************************************************/
+
+typedef void ( *WriteDocument )( JsnHandler* writer, Random* random );
+
+struct CorpusInfo
+{
+  const char*   m_Name;
+  WriteDocument m_Write;
+  bool          m_Pretty;
+  bool          m_EscapeUTF8;
+};
+
+static const CorpusInfo g_Corpora[] =
+{
+  { "tweets",  WriteTweets,  false, false },
+  { "geojson", WriteGeoJSON, false, false },
+  { "config",  WriteConfig,  true,  false },
+  { "escapes", WriteEscapes, false, true  },
+  { "unicode", WriteUnicode, false, false },
+  { "ndjson",  WriteLog,     false, false },
+};
+
+// Documents, one per line. Document i runs from m_Offsets[ i ] to m_Offsets[ i + 1 ] - 1, where the line
+// end is. The whole text is zero terminated.
+class Corpus
+{
+public:
+
+  Corpus( const CorpusInfo& info, int64_t size, uint64_t seed )
+  : m_Name( info.m_Name )
+  , m_Count( 0 )
+  {
+    JsnWriter::Style style;
+    if( !info.m_Pretty )
+    {
+      style.m_IndentString = "";
+      style.m_NewlineString = "";
+      style.m_SpaceAfterColonString = "";
+    }
+    style.m_EscapeUTF8 = info.m_EscapeUTF8;
+
+    Random random( seed );
+    JsnBufferSink sink( size + size / 4 + 4096 );
+    JsnStreamOut stream( &sink );
+    int64_t capacity = 1024;
+    m_Offsets = new int64_t[ capacity ];
+    while( stream.GetCount() < size )
+    {
+      if( m_Count + 1 == capacity )
+      {
+        int64_t* offsets = new int64_t[ capacity * 2 ];
+        memcpy( offsets, m_Offsets, ( size_t )capacity * sizeof( int64_t ) );
+        delete[] m_Offsets;
+        m_Offsets = offsets;
+        capacity *= 2;
+      }
+      m_Offsets[ m_Count++ ] = stream.GetCount();
+      JsnWriter writer( &stream, &style );
+      info.m_Write( &writer, &random );
+      stream.Write( '\n' );
+    }
+    m_Offsets[ m_Count ] = stream.GetCount();
+    stream.Flush();
+
+    m_Size = sink.GetSize();
+    m_Text = new char[ m_Size + 1 ];
+    memcpy( m_Text, sink.GetData(), ( size_t )m_Size + 1 );
+  }
+
+  ~Corpus()
+  {
+    delete[] m_Text;
+    delete[] m_Offsets;
+  }
+
+  const char* GetName() const { return m_Name; }
+  char*       GetText() const { return m_Text; }
+  int64_t     GetSize() const { return m_Size; }
+  int64_t     GetCount() const { return m_Count; }
+  int64_t     GetBegin( int64_t i ) const { return m_Offsets[ i ]; }
+  int64_t     GetEnd( int64_t i ) const { return m_Offsets[ i + 1 ] - 1; }
+
+private:
+
+  const char* m_Name;
+  char*       m_Text;
+  int64_t     m_Size;
+  int64_t*    m_Offsets;
+  int64_t     m_Count;
+
+  Corpus( const Corpus& other );
+  Corpus& operator=( const Corpus& other );
+};
+
+/****************************************************************************************************************/
+// Handlers
+
+// Does nothing. Measures the parser alone.
+class NullHandler final : public JsnHandler
+{
+public:
+
+  virtual void         AddProperty( const JsnFragment&, const JsnFragment& ) override {}
+  virtual NullHandler* BeginObject( const JsnFragment& ) override { return this; }
+  virtual void         EndObject( JsnHandler* ) override {}
+  virtual NullHandler* BeginArray( const JsnFragment& ) override { return this; }
+  virtual void         EndArray( JsnHandler* ) override {}
+};
+
+// Counts values by type, and decodes numbers. A typical small handler.
+class CountHandler final : public JsnHandler
+{
+public:
+
+  CountHandler()
+  : m_Sum( 0.0 )
+  {
+    memset( m_Counts, 0, sizeof( m_Counts ) );
+  }
+
+  virtual void AddProperty( const JsnFragment&, const JsnFragment& value ) override
+  {
+    m_Counts[ value.m_Type ] += 1;
+    if( value.m_Type == kJsn_Int || value.m_Type == kJsn_Float )
+    {
+      m_Sum += value.AsFloat();
+    }
+  }
+  virtual CountHandler* BeginObject( const JsnFragment& ) override { m_Counts[ kJsn_Object ] += 1; return this; }
+  virtual void          EndObject( JsnHandler* ) override {}
+  virtual CountHandler* BeginArray( const JsnFragment& ) override { m_Counts[ kJsn_Array ] += 1; return this; }
+  virtual void          EndArray( JsnHandler* ) override {}
+
+  int64_t m_Counts[ kJsn_Array + 1 ];
+  double  m_Sum;
+};
+
+/****************************************************************************************************************/
+// Benchmarks. Each processes the whole corpus once, and returns false on failure.
+
+struct Context
+{
+  Corpus*      m_Corpus;
+  JsnDocument  m_Document;      // Whole corpus, for the writer
+  JsnIndex     m_Index;         // Structural index of the whole corpus
+  int64_t*     m_Roots;         // Root of each document in m_Document
+  char*        m_Terminated;    // Corpus with zeros for line ends. Escape and unescape stop at a zero.
+  char*        m_Escaped;       // Same with non-ASCII escaped, for unescape
+  int64_t*     m_EscapedOffsets;
+  char*        m_Output;
+  int64_t      m_OutputSize;
+};
+
+template< class Handler >
+static bool ParseAll( Context* context, Handler* handler, const JsnParseOptions& options = JsnParseOptions() )
+{
+  Corpus* corpus = context->m_Corpus;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn stream( corpus->GetText() + corpus->GetBegin( i ), corpus->GetText() + corpus->GetEnd( i ) );
+    if( !JsnParse( handler, &stream, options ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchParseNull( Context* context )
+{
+  NullHandler handler;
+  return ParseAll< JsnHandler >( context, &handler );
+}
+
+static bool BenchParseNullStatic( Context* context )
+{
+  NullHandler handler;
+  return ParseAll< NullHandler >( context, &handler );
+}
+
+static bool BenchParseCount( Context* context )
+{
+  CountHandler handler;
+  return ParseAll< JsnHandler >( context, &handler );
+}
+
+static bool BenchParseCountStatic( Context* context )
+{
+  CountHandler handler;
+  return ParseAll< CountHandler >( context, &handler );
+}
+
+static bool BenchParseHashed( Context* context )
+{
+  CountHandler handler;
+  JsnParseOptions options;
+  options.m_HashKeys = true;
+  return ParseAll< CountHandler >( context, &handler, options );
+}
+
+static bool BenchParseIndexed( Context* context )
+{
+  // The index covers the whole corpus, so each stream starts at its document's offset in the corpus
+  Corpus* corpus = context->m_Corpus;
+  NullHandler handler;
+  JsnParseOptions options;
+  options.m_Index = &context->m_Index;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn stream( corpus->GetText(), corpus->GetText() + corpus->GetEnd( i ) );
+    stream.Seek( corpus->GetBegin( i ) );
+    if( !JsnParse( &handler, &stream, options ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchIndexBuild( Context* context )
+{
+  return context->m_Index.Build( context->m_Corpus->GetText(), context->m_Corpus->GetSize() );
+}
+
+static bool BenchParseDocument( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  JsnDocument document;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn stream( corpus->GetText() + corpus->GetBegin( i ), corpus->GetText() + corpus->GetEnd( i ) );
+    if( !document.Parse( &stream ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Read every value with a JsnReader, and count them as CountHandler does
+static void ReadAll( JsnReader* reader, CountHandler* counts )
+{
+  for( JsnFragment value = reader->Next(); value.m_Type != kJsn_Undefined; value = reader->Next() )
+  {
+    counts->m_Counts[ value.m_Type ] += 1;
+    if( ( value.m_Type == kJsn_Object && reader->EnterObject() ) ||
+        ( value.m_Type == kJsn_Array && reader->EnterArray() ) )
+    {
+      ReadAll( reader, counts );
+      reader->Leave();
+    }
+    else if( value.m_Type == kJsn_Int || value.m_Type == kJsn_Float )
+    {
+      counts->m_Sum += value.AsFloat();
+    }
+  }
+}
+
+static bool BenchParseReader( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  CountHandler counts;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn stream( corpus->GetText() + corpus->GetBegin( i ), corpus->GetText() + corpus->GetEnd( i ) );
+    JsnReader reader( &stream );
+    ReadAll( &reader, &counts );
+    if( reader.GetError() )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The parts of the tweets corpus that a client would use. Everything else is skipped.
+struct TweetUser
+{
+  int64_t id;
+  char    name[ 64 ];
+  int     followers_count;
+  bool    verified;
+};
+JSN_BIND( TweetUser,
+  JSN_FIELD( id ),
+  JSN_FIELD( name ),
+  JSN_FIELD( followers_count ),
+  JSN_FIELD( verified ) )
+
+struct Tweet
+{
+  int64_t   id;
+  char      text[ 256 ];
+  TweetUser user;
+  int       retweet_count;
+  int       favorite_count;
+  char      lang[ 8 ];
+};
+JSN_BIND( Tweet,
+  JSN_FIELD( id ),
+  JSN_FIELD( text ),
+  JSN_FIELD( user ),
+  JSN_FIELD( retweet_count ),
+  JSN_FIELD( favorite_count ),
+  JSN_FIELD( lang ) )
+
+struct TweetSearch
+{
+  Tweet statuses[ 20 ];
+};
+JSN_BIND( TweetSearch,
+  JSN_FIELD( statuses ) )
+
+static bool BenchParseBind( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  JsnParseOptions options;
+  options.m_HashKeys = true;
+  TweetSearch search;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn stream( corpus->GetText() + corpus->GetBegin( i ), corpus->GetText() + corpus->GetEnd( i ) );
+    if( !JsnRead( &search, &stream, options ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+class NullLineHandler final : public JsnLineHandler
+{
+public:
+
+  NullLineHandler() : m_Handlers( NULL ), m_Failed( false ) {}
+  ~NullLineHandler() { delete[] m_Handlers; }
+
+  virtual void BeginLines( int worker_count ) override { m_Handlers = new NullHandler[ worker_count ]; }
+  virtual JsnHandler* BeginLine( int worker, int64_t ) override { return m_Handlers + worker; }
+  virtual void EndLine( int, int64_t, JsnHandler*, const char* error ) override
+  {
+    if( error )
+    {
+      m_Failed = true;
+    }
+  }
+
+  NullHandler* m_Handlers;
+  bool         m_Failed;
+};
+
+static bool BenchParseLines( Context* context )
+{
+  NullLineHandler handler;
+  return JsnParseLines( &handler, context->m_Corpus->GetText(), context->m_Corpus->GetSize() ) && !handler.m_Failed;
+}
+
+static bool BenchWrite( Context* context )
+{
+  JsnWriter::Style style;
+  style.m_IndentString = "";
+  style.m_NewlineString = "";
+  style.m_SpaceAfterColonString = "";
+  JsnStreamOut stream( context->m_Output, context->m_OutputSize );
+  for( int64_t i = 0; i < context->m_Corpus->GetCount(); ++i )
+  {
+    JsnWriter writer( &stream, &style );
+    context->m_Document.Write( &writer, context->m_Roots[ i ] );
+    stream.Write( '\n' );
+  }
+  return !stream.GetError();
+}
+
+static bool BenchMinify( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn in( corpus->GetText() + corpus->GetBegin( i ), corpus->GetText() + corpus->GetEnd( i ) );
+    JsnStreamOut out( context->m_Output, context->m_OutputSize );
+    if( !JsnMinify( &out, &in ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchPrettify( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn in( corpus->GetText() + corpus->GetBegin( i ), corpus->GetText() + corpus->GetEnd( i ) );
+    JsnStreamOut out( context->m_Output, context->m_OutputSize );
+    if( !JsnPrettify( &out, &in ) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchEscape( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn in( context->m_Terminated + corpus->GetBegin( i ), context->m_Terminated + corpus->GetEnd( i ) + 1 );
+    JsnStreamOut out( context->m_Output, context->m_OutputSize );
+    JsnEscapeUTF8( &out, &in );
+    if( in.GetError() || out.GetError() )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchUnescape( Context* context )
+{
+  for( int64_t i = 0; i < context->m_Corpus->GetCount(); ++i )
+  {
+    JsnStreamIn in( context->m_Escaped + context->m_EscapedOffsets[ i ],
+                    context->m_Escaped + context->m_EscapedOffsets[ i + 1 ] );
+    JsnStreamOut out( context->m_Output, context->m_OutputSize );
+    JsnUnescapeUTF8( &out, &in );
+    if( in.GetError() || out.GetError() )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchEscapeBulk( Context* context )
+{
+  Corpus* corpus = context->m_Corpus;
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    const char* text = corpus->GetText() + corpus->GetBegin( i );
+    int64_t length = corpus->GetEnd( i ) - corpus->GetBegin( i );
+    if( JSN_ESCAPED_UTF8_MAX_LENGTH( length ) > context->m_OutputSize ||
+        JsnEscapeUTF8( context->m_Output, text, length ) < 0 )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool BenchUnescapeBulk( Context* context )
+{
+  for( int64_t i = 0; i < context->m_Corpus->GetCount(); ++i )
+  {
+    const char* text = context->m_Escaped + context->m_EscapedOffsets[ i ];
+    int64_t length = context->m_EscapedOffsets[ i + 1 ] - context->m_EscapedOffsets[ i ] - 1; // No terminator
+    if( JsnUnescapeUTF8( context->m_Output, text, length ) < 0 )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+typedef bool ( *Bench )( Context* context );
+
+struct BenchInfo
+{
+  const char* m_Name;
+  Bench       m_Bench;
+  const char* m_Corpus;   // Only run on this corpus, or NULL for all
+};
+
+static const BenchInfo g_Benches[] =
+{
+  { "parse/null",           BenchParseNull,         NULL     },
+  { "parse/null/static",    BenchParseNullStatic,   NULL     },
+  { "parse/count",          BenchParseCount,        NULL     },
+  { "parse/count/static",   BenchParseCountStatic,  NULL     },
+  { "parse/hashed/static",  BenchParseHashed,       NULL     },
+  { "parse/indexed",        BenchParseIndexed,      NULL     },
+  { "parse/document",       BenchParseDocument,     NULL     },
+  { "parse/reader",         BenchParseReader,       NULL     },
+  { "parse/bind",           BenchParseBind,         "tweets" },
+  { "parse/lines",          BenchParseLines,        "ndjson" },
+  { "index/build",          BenchIndexBuild,        NULL     },
+  { "write",                BenchWrite,             NULL     },
+  { "minify",               BenchMinify,            NULL     },
+  { "prettify",             BenchPrettify,          NULL     },
+  { "escape",               BenchEscape,            NULL     },
+  { "unescape",             BenchUnescape,          NULL     },
+  { "escape/bulk",          BenchEscapeBulk,        NULL     },
+  { "unescape/bulk",        BenchUnescapeBulk,      NULL     },
+};
+
+/****************************************************************************************************************/
+
+static void Prepare( Context* context, Corpus* corpus )
+{
+  context->m_Corpus = corpus;
+  context->m_Roots = new int64_t[ corpus->GetCount() ];
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    JsnStreamIn stream( corpus->GetText(), corpus->GetText() + corpus->GetEnd( i ) );
+    stream.Seek( corpus->GetBegin( i ) );
+    context->m_Roots[ i ] = context->m_Document.GetCount();
+    context->m_Document.Append( &stream );
+  }
+
+  // Escaping writes at most three times as many bytes: six for a two byte sequence, twelve for four
+  context->m_OutputSize = corpus->GetSize() * 3 + 16;
+  context->m_Output = new char[ context->m_OutputSize ];
+  context->m_Terminated = new char[ corpus->GetSize() + 1 ];
+  memcpy( context->m_Terminated, corpus->GetText(), ( size_t )corpus->GetSize() + 1 );
+  context->m_Escaped = new char[ context->m_OutputSize ];
+  context->m_EscapedOffsets = new int64_t[ corpus->GetCount() + 1 ];
+  JsnStreamOut escaped( context->m_Escaped, context->m_OutputSize );
+  for( int64_t i = 0; i < corpus->GetCount(); ++i )
+  {
+    context->m_Terminated[ corpus->GetEnd( i ) ] = 0;
+    context->m_EscapedOffsets[ i ] = escaped.GetCount();
+    JsnStreamIn in( context->m_Terminated + corpus->GetBegin( i ), context->m_Terminated + corpus->GetEnd( i ) + 1 );
+    JsnEscapeUTF8( &escaped, &in ); // Writes the zero terminator too
+  }
+  context->m_EscapedOffsets[ corpus->GetCount() ] = escaped.GetCount();
+  context->m_Index.Build( corpus->GetText(), corpus->GetSize() );
+}
+
+static void Release( Context* context )
+{
+  delete[] context->m_Roots;
+  delete[] context->m_Output;
+  delete[] context->m_Terminated;
+  delete[] context->m_Escaped;
+  delete[] context->m_EscapedOffsets;
+  context->m_Document.Clear();
+}
+
+static double Percentile( const double* sorted, int count, int percent )
+{
+  return sorted[ ( count - 1 ) * percent / 100 ];
+}
+
+static void Run( Context* context, const BenchInfo& bench, int warmup, int runs )
+{
+  double* seconds = new double[ runs ];
+  bool ok = true;
+  for( int i = 0; i < warmup; ++i )
+  {
+    ok = bench.m_Bench( context ) && ok;
+  }
+  for( int i = 0; i < runs; ++i )
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ok = bench.m_Bench( context ) && ok;
+    seconds[ i ] = std::chrono::duration< double >( std::chrono::steady_clock::now() - start ).count();
+  }
+  std::sort( seconds, seconds + runs );
+
+  // Fastest run first. Throughput at the 90th percentile of run time is the slow end.
+  double mb = ( double )context->m_Corpus->GetSize() / ( 1024.0 * 1024.0 );
+  double docs = ( double )context->m_Corpus->GetCount();
+  double best = seconds[ 0 ];
+  double p50 = Percentile( seconds, runs, 50 );
+  double p90 = Percentile( seconds, runs, 90 );
+  printf( "%-8s %-20s %9.1f %9.1f %9.1f %12.0f%s\n", context->m_Corpus->GetName(), bench.m_Name,
+          mb / best, mb / p50, mb / p90, docs / p50, ok ? "" : "  FAILED" );
+  delete[] seconds;
+}
+
+static bool Matches( const char* name, const char* filter )
+{
+  return !filter || strstr( name, filter ) != NULL;
+}
+
+int main( int argc, const char* argv[] )
+{
+  double size_mb = 8.0;
+  int runs = 15;
+  int warmup = 3;
+  uint64_t seed = 1;
+  const char* corpus_filter = NULL;
+  const char* bench_filter = NULL;
+  for( int i = 1; i < argc; ++i )
+  {
+    const char* value = i + 1 < argc ? argv[ i + 1 ] : NULL;
+    if( !strcmp( argv[ i ], "-size" ) && value )
+    {
+      size_mb = atof( value );
+    }
+    else if( !strcmp( argv[ i ], "-runs" ) && value )
+    {
+      runs = atoi( value );
+    }
+    else if( !strcmp( argv[ i ], "-warmup" ) && value )
+    {
+      warmup = atoi( value );
+    }
+    else if( !strcmp( argv[ i ], "-seed" ) && value )
+    {
+      seed = ( uint64_t )strtoull( value, NULL, 10 );
+    }
+    else if( !strcmp( argv[ i ], "-corpus" ) && value )
+    {
+      corpus_filter = value;
+    }
+    else if( !strcmp( argv[ i ], "-bench" ) && value )
+    {
+      bench_filter = value;
+    }
+    else
+    {
+      printf( "Usage: %s [-size <MB>] [-runs <n>] [-warmup <n>] [-seed <n>] [-corpus <name>] [-bench <name>]\n",
+              argv[ 0 ] );
+      return 1;
+    }
+    i += 1;
+  }
+  if( runs < 1 )
+  {
+    runs = 1;
+  }
+
+  printf( "%-8s %-20s %9s %9s %9s %12s\n", "corpus", "bench", "MB/s best", "MB/s p50", "MB/s p90", "docs/s p50" );
+  for( int c = 0; c < COUNT_OF( g_Corpora ); ++c )
+  {
+    if( !Matches( g_Corpora[ c ].m_Name, corpus_filter ) )
+    {
+      continue;
+    }
+    Corpus corpus( g_Corpora[ c ], ( int64_t )( size_mb * 1024.0 * 1024.0 ), seed + c );
+    Context context;
+    Prepare( &context, &corpus );
+    for( int b = 0; b < COUNT_OF( g_Benches ); ++b )
+    {
+      const BenchInfo& bench = g_Benches[ b ];
+      if( Matches( bench.m_Name, bench_filter ) && ( !bench.m_Corpus || !strcmp( bench.m_Corpus, corpus.GetName() ) ) )
+      {
+        Run( &context, bench, warmup, runs );
+      }
+    }
+    Release( &context );
+  }
+  return 0;
+}
+
+/****************************************************************************************************************/
@@ -29,6 +29,8 @@
 
 #include "JsnStream.h"
 #include "JsnParse.h"
+#include "JsnSink.h"
+#include "JsnBind.h"
 
 /****************************************************************************************************************/
 
@@ -135,18 +137,12 @@ void JsnExample::Node::Write( JsnHandler* writer ) const
       break;
 
     case kJsn_Int:
-    {
-      char buf[ 25 ];
-      writer->AddProperty( m_Name, JsnFragment::FromInt( buf, sizeof( buf ), m_Value.i ) );
+      writer->AddProperty( m_Name, JsnFragment::FromInt( m_Value.i ) );
       break;
-    }
 
     case kJsn_Float:
-    {
-      char buf[ 25 ];
-      writer->AddProperty( m_Name, JsnFragment::FromFloat( buf, sizeof( buf ), m_Value.f ) );
+      writer->AddProperty( m_Name, JsnFragment::FromFloat( m_Value.f ) );
       break;
-    }
 
     case kJsn_Object:
     {
@@ -179,7 +175,7 @@ void JsnExample::Node::Write( JsnHandler* writer ) const
 
 static const char* NewCString( const JsnFragment& fragment )
 {
-  int len = fragment.m_Length;
+  int64_t len = fragment.m_Length;
   char* s = NULL;
   if( len )
   {
@@ -240,6 +236,7 @@ char json_text[] =
   " \"escaped_illegal_ctrl_chars\": \" \\\\x \\\\y \\\\z \"," \
   " \"unicode_escaped\": \"Copyright:\\u00A9 Notes:\\u266B Clef:\\uD834\\uDD1E\"," \
   " \"unicode_unescaped\": \"Copyright:© Notes:♫ Clef:𝄞\"," \
+  " \"unpaired_surrogates\": \"x\\uDC00yz \\uD800 \\uD800\\u0041 \\uDD1E\\uD834\"," \
   " \"array_of_string\": [ \"first\", \"second\" ]," \
   " \"array_of_number\": [ 100, 200, 300 ]," \
   " \"array_of_bool\": [ false, true ]," \
@@ -248,6 +245,35 @@ char json_text[] =
   " \"empty_array\": []" \
   "}";
 
+// Property names that are empty. The example format above drops them, JsnWriter does not. Also escaped
+// backslashes, which JsnWriter must copy as they are, even when a 'u' follows.
+char empty_names_text[] =
+  "{ \"\": 1, \"object\": { \"\": [ \"\", {} ] }," \
+  " \"path\": \"C:\\\\Users\\\\bob\", \"not_an_escape\": \"\\\\u0041\" }";
+
+// Integer members, read with JsnRead(). A number that does not fit its member is an error.
+struct Counters
+{
+  unsigned char      small;
+  unsigned int       count;
+  unsigned long long big;
+  long long          offset;
+};
+JSN_BIND( Counters,
+  JSN_FIELD( small ),
+  JSN_FIELD( count ),
+  JSN_FIELD( big ),
+  JSN_FIELD( offset ) )
+
+const char* counters_texts[] =
+{
+  "{ \"small\": 255, \"count\": 4294967295, \"big\": 18446744073709551615, \"offset\": -9223372036854775808 }",
+  "{ \"small\": 300 }",
+  "{ \"count\": -1 }",
+  "{ \"big\": 18446744073709551616 }",
+  "{ \"offset\": -9223372036854775809 }"
+};
+
 /****************************************************************************************************************/
 
 int main(int argc, const char * argv[])
@@ -269,18 +295,52 @@ int main(int argc, const char * argv[])
   }
   else
   {
-    JsnStreamOut write_stream;
+    JsnBufferSink sink;
+    JsnStreamOut write_stream( &sink );
 
     JsnWriter writer( &write_stream, NULL );
     example_reader.GetNode()->Write( &writer );
+    write_stream.Flush();
 
-    int count = write_stream.GetCount();
-    char* buffer = new char[ count + 1 ]; // +1 for zero termination
-    buffer[ count ] = '\0';
-    write_stream = JsnStreamOut( buffer, count );
-    example_reader.GetNode()->Write( &writer );
-    printf( "%s\n", buffer );
-    delete[] buffer;
+    printf( "%s\n", sink.GetData() );
+  }
+
+  printf( "\n\n--------- write while reading, with empty property names\n\n" );
+  printf( "%s\n", empty_names_text );
+  {
+    JsnStreamIn empty_names_stream( empty_names_text );
+    JsnBufferSink sink;
+    JsnStreamOut write_stream( &sink );
+
+    JsnWriter writer( &write_stream, NULL );
+    if( !JsnParse( &writer, &empty_names_stream ) )
+    {
+      printf( "ERROR: %s\n", empty_names_stream.GetError() );
+    }
+    write_stream.Flush();
+    if( write_stream.GetError() )
+    {
+      printf( "ERROR: %s\n", write_stream.GetError() );
+    }
+
+    printf( "%s\n", sink.GetData() );
+  }
+
+  printf( "\n\n--------- read integers into a struct\n\n" );
+  for( size_t i = 0; i < sizeof( counters_texts ) / sizeof( counters_texts[ 0 ] ); ++i )
+  {
+    Counters counters = { 0, 0, 0, 0 };
+    JsnStreamIn counters_stream( counters_texts[ i ] );
+    printf( "%s\n", counters_texts[ i ] );
+    if( !JsnRead( &counters, &counters_stream ) )
+    {
+      printf( "  ERROR: %s\n", counters_stream.GetError() );
+    }
+    else
+    {
+      printf( "  small %u, count %u, big %llu, offset %lld\n", counters.small, counters.count, counters.big,
+              counters.offset );
+    }
   }
 
   return 0;